@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "ChunkedGrid.h"
+#include "SnakeCore.h"
+
+// Арена: много змеек (игроки и боты) на общем поле. Столкновения и подбор
+// предметов идут через общую сетку клеток, без попарного обхода тел, так что
+// тик стоит O(число сдвинутых голов). Сетка разреженная (ChunkedGrid), поэтому
+// поле может быть огромным: память занимают только чанки со змейками и предметами.
+// Клетка - 4 байта; всё, что нужно лишь изредка (заявки голов на тик, место еды
+// в списке), хранится в хэш-таблицах по номеру клетки, а не в каждой клетке.
+// Клетка кодируется как (y << 16) | x, чтобы обходиться без деления.
+class Arena {
+public:
+    struct ArenaSnake {
+        std::deque<int32_t> body; // клетки, голова спереди
+        Direction direction = RIGHT;
+        bool alive = false;
+        bool bot = true;
+        int score = 0;
+        int growPending = 0;
+        uint32_t spawns = 0;      // номер появления: меняется при каждом возрождении
+    };
+
+    struct TickStats {
+        int moved = 0;
+        int died = 0;
+        int pickups = 0;
+    };
+
+    struct CellState {
+        uint16_t occupancy = 0;  // сегменты (после роста бывают дубликаты)
+        uint8_t item = 0;
+    };
+
+    static const uint8_t ITEM_NONE = 0;
+    static const uint8_t ITEM_FOOD = 1;
+    static const uint8_t ITEM_BONUS = 2;
+    static const uint8_t ITEM_ANTIBONUS = 3;
+
+    static int32_t cellId(int x, int y) { return (y << 16) | x; }
+    static int cellX(int32_t cell) { return cell & 0xFFFF; }
+    static int cellY(int32_t cell) { return cell >> 16; }
+
+private:
+    GameRules rules;
+    int cols;
+    int rows;
+    int spawnRadius;                    // 0 - предметы по всему полю, иначе рядом со змейками
+    int clusterRadius;                  // 0 - змейки по всему полю, иначе в квадрате у центра
+    Rng rng;
+    std::vector<ArenaSnake> snakes;
+    ChunkedGrid<CellState> grid;
+    std::vector<int32_t> foods;         // клетки с едой, для ботов
+    std::unordered_map<int32_t, int32_t> foodSlots; // клетка -> позиция в foods, чтобы удалять за O(1)
+    std::unordered_map<int32_t, int32_t> claims;    // заявки голов текущего тика: клетка -> змейка
+    int foodTarget;
+    float stepSeconds;
+    float elapsed = 0.f;
+    float bonusTimer = 0.f;
+    float antiBonusTimer = 0.f;
+    uint32_t tick = 0;
+    std::vector<int32_t> nextHead;
+    int itemCount = 0;
+    int kindCount[ITEM_ANTIBONUS + 1] = {}; // живые предметы по видам
+    int bonusCap;                       // бонусов и антибонусов одновременно - не больше
+    uint64_t itemHash = 0;              // XOR itemKey по всем предметам, для stateHash
+    std::vector<int32_t>* itemLog = nullptr; // клетки, где менялись предметы (для репликации)
+
+    const CellState& cellAt(int32_t cell) const { return grid.get(cellX(cell), cellY(cell)); }
+
+    // Клетка удерживает чанк, пока в ней есть сегмент или предмет
+    static bool isUsed(const CellState& state) { return state.occupancy != 0 || state.item != ITEM_NONE; }
+
+    void occupy(int32_t cell) {
+        int x = cellX(cell), y = cellY(cell);
+        CellState& state = grid.at(x, y);
+        bool wasUsed = isUsed(state);
+        ++state.occupancy;
+        if (!wasUsed) grid.retain(x, y);
+    }
+
+    void vacate(int32_t cell) {
+        int x = cellX(cell), y = cellY(cell);
+        CellState& state = grid.at(x, y);
+        --state.occupancy;
+        if (!isUsed(state)) grid.release(x, y);
+    }
+
+    void setItem(int32_t cell, uint8_t item) {
+        int x = cellX(cell), y = cellY(cell);
+        CellState& state = grid.at(x, y);
+        bool wasUsed = isUsed(state);
+        if (state.item != ITEM_NONE) --itemCount;
+        if (item != ITEM_NONE) ++itemCount;
+        --kindCount[state.item];
+        ++kindCount[item];
+        if (state.item != ITEM_NONE) itemHash ^= itemKey(cell, state.item);
+        if (item != ITEM_NONE) itemHash ^= itemKey(cell, item);
+        state.item = item;
+        if (itemLog) itemLog->push_back(cell);
+        if (wasUsed && !isUsed(state)) grid.release(x, y);
+        else if (!wasUsed && isUsed(state)) grid.retain(x, y);
+    }
+
+    bool isFree(int32_t cell) const { return !isUsed(cellAt(cell)); }
+
+    // Ключ предмета для itemHash (splitmix64): XOR ключей не зависит от порядка,
+    // так что хэш обновляется за O(1) при каждой смене предмета
+    static uint64_t itemKey(int32_t cell, uint8_t item) {
+        uint64_t z = (static_cast<uint64_t>(static_cast<uint32_t>(cell)) << 8 | item) + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    int32_t randomCell() {
+        if (spawnRadius > 0) {
+            // Рядом с головой случайной живой змейки, чтобы мир оставался разреженным
+            const ArenaSnake& near = snakes[rng.nextInt(static_cast<int>(snakes.size()))];
+            if (near.alive) {
+                int x = cellX(near.body.front()) + rng.nextInt(2 * spawnRadius + 1) - spawnRadius;
+                int y = cellY(near.body.front()) + rng.nextInt(2 * spawnRadius + 1) - spawnRadius;
+                return cellId(std::min(std::max(x, 0), cols - 1), std::min(std::max(y, 0), rows - 1));
+            }
+        }
+        return cellId(rng.nextInt(cols), rng.nextInt(rows));
+    }
+
+    int32_t randomFreeCell() {
+        for (int attempt = 0; attempt < 64; ++attempt) {
+            int32_t cell = randomCell();
+            if (isFree(cell)) return cell;
+        }
+        return -1;
+    }
+
+    // false - свободной клетки не нашлось
+    bool placeItem(uint8_t kind) {
+        int32_t cell = randomFreeCell();
+        if (cell < 0) return false;
+        setItem(cell, kind);
+        if (kind == ITEM_FOOD) {
+            foodSlots[cell] = static_cast<int32_t>(foods.size());
+            foods.push_back(cell);
+        }
+        return true;
+    }
+
+    void removeFood(int32_t cell) {
+        auto found = foodSlots.find(cell);
+        int32_t slot = found->second;
+        foodSlots.erase(found);
+        foods[slot] = foods.back();
+        foods.pop_back();
+        if (slot < static_cast<int32_t>(foods.size())) foodSlots[foods[slot]] = slot;
+    }
+
+    void clearBody(ArenaSnake& snake) {
+        for (int32_t cell : snake.body) vacate(cell);
+        snake.body.clear();
+    }
+
+    int32_t neighbour(int32_t cell, Direction dir) const {
+        int x = cellX(cell);
+        int y = cellY(cell);
+        switch (dir) {
+        case UP: --y; break;
+        case DOWN: ++y; break;
+        case LEFT: --x; break;
+        case RIGHT: ++x; break;
+        }
+        if (x < 0 || x >= cols || y < 0 || y >= rows) return -1;
+        return cellId(x, y);
+    }
+
+    static bool isOpposite(Direction a, Direction b) {
+        return (a == UP && b == DOWN) || (a == DOWN && b == UP) ||
+            (a == LEFT && b == RIGHT) || (a == RIGHT && b == LEFT);
+    }
+
+public:
+    // В одиночной игре на поле один бонус и один антибонус; на арене - по одному на столько змеек
+    static const int BONUS_SNAKES = 8;
+    // Плотность скопления змеек в разреженном мире - как у обычной арены
+    static constexpr double CELLS_PER_SNAKE = 300.0;
+
+    Arena(int cols, int rows, int snakeCount, uint64_t seed = 1,
+        const GameRules& rules = GameRules(), int spawnRadius = 0)
+        : rules(rules), cols(cols), rows(rows), spawnRadius(spawnRadius),
+        clusterRadius(spawnRadius > 0 ? std::max(spawnRadius, static_cast<int>(std::sqrt(snakeCount * CELLS_PER_SNAKE) / 2)) : 0),
+        snakes(snakeCount),
+        grid(cols, rows), foodTarget(std::max(1, snakeCount / 2)),
+        stepSeconds(rules.normalSpeed), nextHead(snakeCount, -1), bonusCap(std::max(1, snakeCount / BONUS_SNAKES)) {
+        rng.seed(seed);
+        for (int id = 0; id < snakeCount; ++id) spawnSnake(id);
+        while (static_cast<int>(foods.size()) < foodTarget && randomFreeCell() >= 0) placeItem(ITEM_FOOD);
+    }
+
+    void setDifficulty(Difficulty difficulty) { stepSeconds = rules.speedFor(difficulty); }
+    float getSpeed() const { return stepSeconds; }
+
+    void setBot(int id, bool bot) { snakes[id].bot = bot; }
+
+    // Ищет горизонтальный отрезок из трёх клеток без змеек и предметов (и клетку
+    // перед ним без змеек); false, если поле забито. В разреженном мире
+    // (spawnRadius > 0) - в квадрате clusterRadius у центра поля: змейки держатся
+    // скоплением с плотностью обычной арены, и чанки за его пределами не выделяются
+    bool spawnSnake(int id) {
+        ArenaSnake& snake = snakes[id];
+        clearBody(snake);
+        for (int attempt = 0; attempt < 64; ++attempt) {
+            int x = 2 + rng.nextInt(cols - 4);
+            int y = rng.nextInt(rows);
+            if (clusterRadius > 0 && attempt < 48) {
+                x = std::min(std::max(cols / 2 + rng.nextInt(2 * clusterRadius + 1) - clusterRadius, 2), cols - 3);
+                y = std::min(std::max(rows / 2 + rng.nextInt(2 * clusterRadius + 1) - clusterRadius, 0), rows - 1);
+            }
+            if (!isFree(cellId(x, y)) || !isFree(cellId(x - 1, y)) || !isFree(cellId(x - 2, y)) ||
+                cellAt(cellId(x + 1, y)).occupancy) continue;
+            for (int i = 0; i < 3; ++i) {
+                snake.body.push_back(cellId(x - i, y));
+                occupy(cellId(x - i, y));
+            }
+            snake.direction = RIGHT;
+            snake.alive = true;
+            snake.score = 0;
+            snake.growPending = 0;
+            ++snake.spawns;
+            return true;
+        }
+        snake.alive = false;
+        return false;
+    }
+
+    // Жадный выбор направления бота; в сетевой игре им же ходят локальные боты
+    Direction botDirection(int id) const {
+        const ArenaSnake& snake = snakes[id];
+        int32_t head = snake.body.front();
+        // Каждый бот держит свою цель, чтобы не искать ближайшую еду по всему полю
+        int32_t target = foods.empty() ? head : foods[id % foods.size()];
+        int tx = cellX(target), ty = cellY(target);
+
+        static const Direction directions[] = { UP, DOWN, LEFT, RIGHT };
+        Direction best = snake.direction;
+        int bestCost = 1 << 30;
+        for (Direction dir : directions) {
+            if (isOpposite(dir, snake.direction)) continue;
+            int32_t next = neighbour(head, dir);
+            int cost = 1 << 20;
+            if (next >= 0) {
+                const CellState& state = cellAt(next);
+                if (state.occupancy == 0) {
+                    cost = std::abs(cellX(next) - tx) + std::abs(cellY(next) - ty);
+                    if (state.item == ITEM_ANTIBONUS) cost += 1 << 10;
+                }
+            }
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = dir;
+            }
+        }
+        return best;
+    }
+
+    void changeDirection(int id, Direction dir) {
+        if (!isOpposite(dir, snakes[id].direction)) snakes[id].direction = dir;
+    }
+
+    // respawnBots - погибшие боты сразу возрождаются (для бенчмарка и фона)
+    TickStats step(bool respawnBots = true) {
+        TickStats stats;
+        ++tick;
+        int count = static_cast<int>(snakes.size());
+
+        // 1. Цели голов: проверка по сетке на начало тика, заявки для лобовых столкновений
+        claims.clear();
+        for (int id = 0; id < count; ++id) {
+            ArenaSnake& snake = snakes[id];
+            nextHead[id] = -1;
+            if (!snake.alive) continue;
+            if (snake.bot) snake.direction = botDirection(id);
+            int32_t next = neighbour(snake.body.front(), snake.direction);
+            if (next < 0 || cellAt(next).occupancy != 0) {
+                snake.alive = false;
+                continue;
+            }
+            auto claim = claims.emplace(next, id);
+            if (!claim.second) {
+                snake.alive = false;
+                snakes[claim.first->second].alive = false;
+                continue;
+            }
+            nextHead[id] = next;
+        }
+
+        // 2. Применение ходов и подборов
+        for (int id = 0; id < count; ++id) {
+            ArenaSnake& snake = snakes[id];
+            if (!snake.alive) {
+                if (!snake.body.empty()) {
+                    clearBody(snake);
+                    ++stats.died;
+                }
+                continue;
+            }
+            int32_t head = nextHead[id];
+            snake.body.push_front(head);
+            occupy(head);
+            ++stats.moved;
+
+            // Правила одиночной игры (SnakeBoards::move): с предметом хвост остаётся
+            // на месте - еда +1, бонус +1 и ещё bonusGrow потом, антибонус
+            // вместе с новой головой -antiBonusShrink + 1
+            uint8_t item = cellAt(head).item;
+            if (item != ITEM_NONE) {
+                if (item == ITEM_FOOD) removeFood(head);
+                setItem(head, ITEM_NONE);
+                ++stats.pickups;
+                if (item == ITEM_FOOD) {
+                    snake.score += 1;
+                }
+                else if (item == ITEM_BONUS) {
+                    snake.score += 3;
+                    snake.growPending += rules.bonusGrow;
+                }
+                else {
+                    snake.score = snake.score > 3 ? snake.score - 3 : 0;
+                    for (int i = 0; i < rules.antiBonusShrink && snake.body.size() > 3; ++i) {
+                        vacate(snake.body.back());
+                        snake.body.pop_back();
+                    }
+                }
+            }
+            else if (snake.growPending > 0) {
+                --snake.growPending;
+            }
+            else {
+                vacate(snake.body.back());
+                snake.body.pop_back();
+            }
+        }
+
+        if (respawnBots) {
+            for (int id = 0; id < count; ++id) {
+                if (!snakes[id].alive && snakes[id].bot) spawnSnake(id);
+            }
+        }
+
+        for (int attempt = 0; static_cast<int>(foods.size()) < foodTarget && attempt < 16; ++attempt) {
+            placeItem(ITEM_FOOD);
+        }
+
+        elapsed += stepSeconds;
+        bonusTimer += stepSeconds;
+        antiBonusTimer += stepSeconds;
+        if (elapsed > rules.bonusDelay) {
+            if (kindCount[ITEM_BONUS] < bonusCap && bonusTimer > rules.bonusInterval && placeItem(ITEM_BONUS)) {
+                bonusTimer = 0.f;
+            }
+            if (kindCount[ITEM_ANTIBONUS] < bonusCap && antiBonusTimer > rules.antiBonusInterval && placeItem(ITEM_ANTIBONUS)) {
+                antiBonusTimer = 0.f;
+            }
+        }
+        return stats;
+    }
+
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+    int getSnakeCount() const { return static_cast<int>(snakes.size()); }
+    const ArenaSnake& getSnake(int id) const { return snakes[id]; }
+    const CellState& getCell(int x, int y) const { return grid.get(x, y); }
+    const ChunkedGrid<CellState>& getGrid() const { return grid; }
+    int getItemCount() const { return itemCount; }
+
+    // Журнал изменённых клеток с предметами; владелец журнала его и очищает.
+    // Указатель не переносится осмысленно при копировании арены - задавайте заново.
+    void setItemLog(std::vector<int32_t>* log) { itemLog = log; }
+    uint32_t getTick() const { return tick; }
+
+    // Хэш всего состояния (FNV-1a) для сверки симуляций между узлами сетевой игры
+    uint64_t stateHash() const {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        auto mix = [&hash](uint64_t value) {
+            for (int i = 0; i < 8; ++i) {
+                hash ^= (value >> (i * 8)) & 0xFF;
+                hash *= 0x100000001B3ull;
+            }
+        };
+        mix(tick);
+        mix(rng.state);
+        for (const ArenaSnake& snake : snakes) {
+            mix((static_cast<uint64_t>(snake.alive) << 40) | (static_cast<uint64_t>(snake.direction) << 32) |
+                static_cast<uint32_t>(snake.score));
+            mix(static_cast<uint64_t>(snake.growPending) << 32 | snake.body.size());
+            for (int32_t cell : snake.body) mix(static_cast<uint32_t>(cell));
+        }
+        for (int32_t cell : foods) mix(static_cast<uint32_t>(cell));
+        // Бонусы и антибонусы в foods не попадают - их покрывает itemHash
+        mix(itemHash);
+        return hash;
+    }
+};
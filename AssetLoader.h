@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ThreadPool.h"
+
+// Ресурсы по экранам: каждому состоянию игры (int - значение GameState)
+// приписан набор ресурсов, он загружается при первом входе в состояние, а
+// наборы вероятных следующих состояний подгружаются заранее в фоне. Чтение
+// и декодирование файлов идёт на пуле потоков, шаг, которому нужен главный
+// поток (выгрузка текстуры в видеопамять), выполняет update() раз в кадр.
+// Если занятая ресурсами память больше бюджета, выгружаются давно не нужные
+// ресурсы, не входящие в набор текущего состояния. Для каждого ресурса
+// замеряется время на рабочем потоке и на главном.
+class AssetLoader {
+private:
+    enum Status { UNLOADED, LOADING, RESIDENT, FAILED };
+
+    struct Asset {
+        std::string name;
+        std::function<bool()> load;     // рабочий поток
+        std::function<bool()> finish;   // главный поток, может быть пустым
+        std::function<void()> unload;   // главный поток; пустой - ресурс не выгружается
+        std::function<size_t()> bytes;  // занятая память после загрузки
+        bool required = true;
+        Status status = UNLOADED;
+        bool ok = false;                // итог load (из Loaded) и finish
+        size_t residentBytes = 0;
+        uint64_t lastUse = 0;
+        int loads = 0;
+        double startMs = 0.0;           // первая загрузка, от создания загрузчика
+        double loadMs = 0.0;
+        double finishMs = 0.0;
+    };
+
+    std::vector<Asset> assets;
+    std::map<int, std::vector<size_t>> stateAssets;
+    std::map<int, std::vector<int>> nextStates;
+    std::mutex mutex;
+    // Итог загрузки с рабочего потока. Поля Asset он не трогает: их читает
+    // printReport, пока ресурс грузится заново после вытеснения
+    struct Loaded {
+        size_t index;
+        bool ok;
+        double startMs;
+        double loadMs;
+    };
+
+    std::vector<Loaded> loaded;         // ждут главный поток
+    size_t budget = 0;                  // 0 - без ограничения
+    size_t residentBytes = 0;
+    size_t evictions = 0;
+    uint64_t useClock = 0;
+    int currentState = -1;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    ThreadPool pool;                    // последним: разрушается первым, дождавшись задач
+
+    double sinceStart() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    const std::vector<size_t>& setOf(int state) const {
+        static const std::vector<size_t> empty;
+        auto it = stateAssets.find(state);
+        return it == stateAssets.end() ? empty : it->second;
+    }
+
+    void request(size_t index) {
+        Asset& asset = assets[index];
+        asset.lastUse = ++useClock;
+        if (asset.status != UNLOADED) return;
+        asset.status = LOADING;
+        pool.submit([this, index, load = asset.load] {
+            double start = sinceStart();
+            bool ok = load();
+            double loadMs = sinceStart() - start;
+            std::lock_guard<std::mutex> lock(mutex);
+            loaded.push_back(Loaded{ index, ok, start, loadMs });
+        });
+    }
+
+    // Давно не нужные ресурсы вне текущего набора, пока не уложимся в бюджет
+    void evict() {
+        if (budget == 0 || residentBytes <= budget) return;
+        const std::vector<size_t>& keep = setOf(currentState);
+        std::vector<size_t> candidates;
+        for (size_t i = 0; i < assets.size(); ++i) {
+            if (assets[i].status == RESIDENT && assets[i].unload && std::find(keep.begin(), keep.end(), i) == keep.end()) {
+                candidates.push_back(i);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+            [this](size_t a, size_t b) { return assets[a].lastUse < assets[b].lastUse; });
+        for (size_t i : candidates) {
+            if (residentBytes <= budget) break;
+            Asset& asset = assets[i];
+            asset.unload();
+            residentBytes -= asset.residentBytes;
+            asset.residentBytes = 0;
+            asset.status = UNLOADED;
+            ++evictions;
+        }
+    }
+
+public:
+    // threads = 0 - по числу ядер
+    explicit AssetLoader(unsigned threads = 0) : pool(threads) {}
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Всё, что захватывают функции, должно жить дольше загрузчика.
+    // required = false - без ресурса игра идёт дальше (музыка, звуки)
+    size_t add(const std::string& name, std::function<bool()> load, std::function<bool()> finish = nullptr,
+        std::function<void()> unload = nullptr, std::function<size_t()> bytes = nullptr, bool required = true) {
+        Asset asset;
+        asset.name = name;
+        asset.load = std::move(load);
+        asset.finish = std::move(finish);
+        asset.unload = std::move(unload);
+        asset.bytes = std::move(bytes);
+        asset.required = required;
+        assets.push_back(std::move(asset));
+        return assets.size() - 1;
+    }
+
+    void declare(int state, std::vector<size_t> indices) { stateAssets[state] = std::move(indices); }
+    void prefetchAfter(int state, std::vector<int> likely) { nextStates[state] = std::move(likely); }
+    void setBudget(size_t bytes) { budget = bytes; }
+
+    // Переход в состояние: его набор - немедленно, наборы следующих - в фоне
+    void enter(int state) {
+        currentState = state;
+        for (size_t index : setOf(state)) request(index);
+        auto next = nextStates.find(state);
+        if (next != nextStates.end()) {
+            for (int likely : next->second) {
+                for (size_t index : setOf(likely)) {
+                    if (assets[index].status == UNLOADED) request(index);
+                }
+            }
+        }
+        evict();
+    }
+
+    // Главный поток, раз в кадр: доводит загруженные ресурсы
+    void update() {
+        std::vector<Loaded> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batch.swap(loaded);
+        }
+        for (const Loaded& result : batch) {
+            Asset& asset = assets[result.index];
+            if (asset.loads == 0) asset.startMs = result.startMs;
+            asset.loadMs = result.loadMs;
+            asset.ok = result.ok;
+            if (asset.ok && asset.finish) {
+                auto start = std::chrono::steady_clock::now();
+                asset.ok = asset.finish();
+                asset.finishMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            ++asset.loads;
+            asset.status = asset.ok ? RESIDENT : FAILED;
+            asset.residentBytes = asset.ok && asset.bytes ? asset.bytes() : 0;
+            residentBytes += asset.residentBytes;
+        }
+        if (!batch.empty()) evict();
+    }
+
+    bool isReady(size_t index) const { return assets[index].status == RESIDENT; }
+
+    // Набор состояния догружен (неудачные необязательные ресурсы не ждём)
+    bool isStateReady(int state) const { return getStateProgress(state) >= 1.0f; }
+
+    float getStateProgress(int state) const {
+        const std::vector<size_t>& indices = setOf(state);
+        size_t done = 0;
+        for (size_t index : indices) done += assets[index].status == RESIDENT || assets[index].status == FAILED ? 1 : 0;
+        return indices.empty() ? 1.0f : static_cast<float>(done) / indices.size();
+    }
+
+    // Первый обязательный ресурс, который не загрузился; пусто - всё в порядке
+    std::string getFailure() const {
+        for (const Asset& asset : assets) {
+            if (asset.required && asset.status == FAILED) return asset.name;
+        }
+        return std::string();
+    }
+
+    size_t getResidentBytes() const { return residentBytes; }
+    size_t getEvictions() const { return evictions; }
+
+    void printReport(std::ostream& out) const {
+        out << std::left << std::setw(30) << "asset" << std::right << std::setw(10) << "start ms"
+            << std::setw(10) << "load ms" << std::setw(10) << "main ms" << std::setw(10) << "KB" << std::setw(7) << "loads" << "\n";
+        for (const Asset& asset : assets) {
+            out << std::left << std::setw(30) << asset.name << std::right << std::fixed << std::setprecision(1);
+            if (asset.loads == 0) {
+                out << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(10) << "-"
+                    << std::setw(7) << 0 << (asset.status == LOADING ? "  loading" : "") << "\n";
+                continue;
+            }
+            out << std::setw(10) << asset.startMs << std::setw(10) << asset.loadMs << std::setw(10) << asset.finishMs
+                << std::setw(10) << asset.residentBytes / 1024 << std::setw(7) << asset.loads
+                << (asset.status == FAILED ? (asset.required ? "  FAILED" : "  missing") : "") << "\n";
+        }
+        out << "resident " << residentBytes / 1024 << " KB";
+        if (budget > 0) out << " of " << budget / 1024 << " KB budget";
+        out << ", " << evictions << " evictions\n";
+    }
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <SFML/System/InputStream.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "MappedFile.h"
+
+// Все ресурсы игры одним файлом assets.pack: на сетевых дисках время старта
+// съедает открытие десятка мелких файлов, а не чтение. Пакет отображается в
+// память один раз, openStream() отдаёт ресурс SFML (loadFromStream /
+// openFromStream) потоком прямо из отображения, без промежуточной копии файла.
+//
+// Формат: AssetPackHeader, count записей AssetPackEntry по возрастанию имени,
+// затем данные, каждый блок выровнен на alignment байт. Собирает SnakeTool pack.
+
+struct AssetPackHeader {
+    char magic[4];          // "SNKP"
+    uint32_t version;
+    uint32_t count;
+    uint32_t alignment;
+};
+
+struct AssetPackEntry {
+    char name[48];          // путь как в коде игры, "assets/sounds/bonus.wav"; с нулём в конце
+    uint64_t offset;        // от начала файла
+    uint64_t size;
+};
+
+static_assert(sizeof(AssetPackHeader) == 16, "asset pack header layout is part of the file format");
+static_assert(sizeof(AssetPackEntry) == 64, "asset pack entry layout is part of the file format");
+
+// sf::InputStream поверх куска отображённого пакета
+class AssetStream : public sf::InputStream {
+private:
+    const uint8_t* data;
+    sf::Int64 length;
+    sf::Int64 position = 0;
+
+public:
+    AssetStream(const uint8_t* data, uint64_t size) : data(data), length(static_cast<sf::Int64>(size)) {}
+
+    sf::Int64 read(void* buffer, sf::Int64 size) override {
+        sf::Int64 count = std::min(size, length - position);
+        if (count <= 0) return 0;
+        std::memcpy(buffer, data + position, static_cast<size_t>(count));
+        position += count;
+        return count;
+    }
+
+    sf::Int64 seek(sf::Int64 target) override {
+        if (target < 0 || target > length) return -1;
+        position = target;
+        return position;
+    }
+
+    sf::Int64 tell() override { return position; }
+    sf::Int64 getSize() override { return length; }
+};
+
+class AssetPack {
+private:
+    static const uint32_t VERSION = 1;
+
+    MappedFile file;
+    const AssetPackEntry* entries = nullptr;
+    uint32_t count = 0;
+
+    const AssetPackEntry* find(const std::string& name) const {
+        const AssetPackEntry* end = entries + count;
+        const AssetPackEntry* found = std::lower_bound(entries, end, name,
+            [](const AssetPackEntry& entry, const std::string& key) { return std::strcmp(entry.name, key.c_str()) < 0; });
+        return found != end && name == found->name ? found : nullptr;
+    }
+
+public:
+    AssetPack() = default;
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // false - пакета нет или он испорчен; тогда игра читает отдельные файлы
+    bool open(const std::string& path) {
+        entries = nullptr;
+        count = 0;
+        if (!file.open(path) || file.size() < sizeof(AssetPackHeader)) {
+            file.close();
+            return false;
+        }
+        const AssetPackHeader* header = reinterpret_cast<const AssetPackHeader*>(file.data());
+        bool valid = std::memcmp(header->magic, "SNKP", 4) == 0 && header->version == VERSION &&
+            sizeof(AssetPackHeader) + static_cast<uint64_t>(header->count) * sizeof(AssetPackEntry) <= file.size();
+        const AssetPackEntry* table = reinterpret_cast<const AssetPackEntry*>(file.data() + sizeof(AssetPackHeader));
+        for (uint32_t i = 0; valid && i < header->count; ++i) {
+            valid = std::memchr(table[i].name, 0, sizeof(table[i].name)) != nullptr &&
+                table[i].offset <= file.size() && table[i].size <= file.size() - table[i].offset &&
+                (i == 0 || std::strcmp(table[i - 1].name, table[i].name) < 0);
+        }
+        if (!valid) {
+            file.close();
+            return false;
+        }
+        entries = table;
+        count = header->count;
+        return true;
+    }
+
+    bool isOpen() const { return entries != nullptr; }
+    bool contains(const std::string& name) const { return entries && find(name) != nullptr; }
+    uint32_t size() const { return count; }
+    const AssetPackEntry& entry(uint32_t index) const { return entries[index]; }
+    const uint8_t* data(const AssetPackEntry& entry) const { return file.data() + entry.offset; }
+
+    // Байты ресурса прямо в отображении; false - его нет в пакете
+    bool view(const std::string& name, const uint8_t*& bytes, uint64_t& size) const {
+        const AssetPackEntry* entry = entries ? find(name) : nullptr;
+        if (!entry) return false;
+        bytes = file.data() + entry->offset;
+        size = entry->size;
+        return true;
+    }
+
+    // Новый поток на ресурс; nullptr - его нет в пакете. Можно звать из разных
+    // потоков. Потоком владеет вызывающий: Font и Music читают его по ходу, так
+    // что он должен жить, пока жив ресурс, но не дольше пакета
+    std::unique_ptr<AssetStream> openStream(const std::string& name) const {
+        const AssetPackEntry* entry = entries ? find(name) : nullptr;
+        if (!entry) return nullptr;
+        return std::make_unique<AssetStream>(file.data() + entry->offset, entry->size);
+    }
+
+    // Сборка пакета: files - пары (имя в пакете, путь на диске). false и error - что не так
+    static bool build(const std::string& path, std::vector<std::pair<std::string, std::string>> files,
+        uint32_t alignment, std::string& error) {
+        std::sort(files.begin(), files.end());
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (files[i].first.empty() || files[i].first.size() >= sizeof(AssetPackEntry::name)) {
+                error = "bad name length: " + files[i].first;
+                return false;
+            }
+            if (i > 0 && files[i].first == files[i - 1].first) {
+                error = "duplicate name: " + files[i].first;
+                return false;
+            }
+        }
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            error = "alignment must be a power of two";
+            return false;
+        }
+
+        std::vector<AssetPackEntry> table(files.size());
+        std::vector<std::string> blobs(files.size());
+        uint64_t offset = sizeof(AssetPackHeader) + files.size() * sizeof(AssetPackEntry);
+        for (size_t i = 0; i < files.size(); ++i) {
+            std::ifstream in(files[i].second, std::ios::binary);
+            if (!in.is_open()) {
+                error = "cannot open " + files[i].second;
+                return false;
+            }
+            blobs[i].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            offset = (offset + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
+            std::memset(&table[i], 0, sizeof(AssetPackEntry));
+            std::memcpy(table[i].name, files[i].first.c_str(), files[i].first.size());
+            table[i].offset = offset;
+            table[i].size = blobs[i].size();
+            offset += blobs[i].size();
+        }
+
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            AssetPackHeader header = { { 'S', 'N', 'K', 'P' }, VERSION, static_cast<uint32_t>(files.size()), alignment };
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(AssetPackEntry));
+            uint64_t written = sizeof(AssetPackHeader) + table.size() * sizeof(AssetPackEntry);
+            for (size_t i = 0; i < files.size(); ++i) {
+                out.write(std::string(static_cast<size_t>(table[i].offset - written), '\0').data(), table[i].offset - written);
+                out.write(blobs[i].data(), blobs[i].size());
+                written = table[i].offset + table[i].size;
+            }
+            out.flush();
+            if (!out) {
+                error = "cannot write " + temporary;
+                return false;
+            }
+        }
+        // filesystem::rename заменяет существующий файл и на Windows
+        std::error_code renameError;
+        std::filesystem::rename(temporary, path, renameError);
+        if (renameError) {
+            error = "cannot rename " + temporary + ": " + renameError.message();
+            return false;
+        }
+        return true;
+    }
+};
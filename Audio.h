@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AudioBackend.h"
+
+// Дорожки музыки. Новая дорожка - значение перед MUSIC_TRACK_COUNT и строка в MUSIC_TRACKS
+enum MusicTrack { MUSIC_NONE = -1, MUSIC_MENU, MUSIC_GAME, MUSIC_GAMEOVER, MUSIC_SETTINGS, MUSIC_TRACK_COUNT };
+
+struct MusicTrackInfo {
+    const char* name;       // для отчёта загрузчика
+    const char* path;
+    bool loop;
+    float volume;           // громкость, до которой дорожка сводится, 0..100
+};
+
+const MusicTrackInfo MUSIC_TRACKS[MUSIC_TRACK_COUNT] = {
+    { "menu", "assets/sounds/background.ogg", true, 100.0f },
+    { "game", "assets/sounds/GameMode.ogg", true, 100.0f },
+    { "gameover", "assets/sounds/GameOver.ogg", false, 100.0f },
+    { "settings", "assets/sounds/Settings.ogg", true, 100.0f }
+};
+
+// Музыка: главный поток только называет дорожку, которая должна звучать
+// (play/stop), всё остальное делает свой поток управления звуком: запускает
+// дорожку и за setCrossfade() миллисекунд сводит громкость новой вверх, а старой
+// вниз, затихшие останавливает - stop() потоковой дорожки ждёт поток декодера, и
+// главный поток на этом больше не стоит. Вероятные следующие дорожки (setNext)
+// держатся заряженными: запущены на нулевой громкости и сразу поставлены на
+// паузу, так что буферы уже заполнены и переход не ждёт декодер. Задержка
+// перехода - от play() до первой проигранной выборки новой дорожки.
+// Дорожки открываются лениво загрузчиком ресурсов и закрываются при
+// вытеснении; play() незагруженной дорожки срабатывает, когда её откроют
+class MusicManager {
+private:
+    static const int TICK_MS = 5;
+
+    struct Track {
+        std::unique_ptr<AudioStream> music;
+        float volume = 0.0f;        // 0..MUSIC_TRACKS[].volume, меняет только поток звука
+        bool primed = false;        // заряжена и стоит на паузе
+    };
+
+    Track tracks[MUSIC_TRACK_COUNT];
+    std::vector<MusicTrack> next[MUSIC_TRACK_COUNT];
+    std::vector<std::unique_ptr<AudioStream>> retired; // закрытые, разрушит поток звука
+    std::mutex tracksMutex;
+
+    // Команда главного потока и замеры - под своим мьютексом, чтобы play() не
+    // ждал, пока поток звука останавливает дорожку
+    MusicTrack target = MUSIC_NONE; // что должно звучать
+    bool started = false;           // цель уже запущена потоком звука
+    bool finished = false;          // цель доиграла до конца (gameover не зациклена)
+    bool measuring = false;
+    std::chrono::steady_clock::time_point requested;
+    int crossfadeMs = 400;
+    bool quit = false;
+    size_t transitions = 0;
+    double lastLatencyMs = 0.0;
+    double totalLatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+    std::mutex commandMutex;
+    std::condition_variable wake;
+    AudioBackend& backend;
+    bool enabled = true;            // только главный поток
+    std::thread thread;             // последним: запускается, когда всё остальное готово
+
+    void run() {
+        auto last = std::chrono::steady_clock::now();
+        while (true) {
+            MusicTrack current;
+            bool start;
+            int fadeMs;
+            {
+                std::unique_lock<std::mutex> lock(commandMutex);
+                wake.wait_for(lock, std::chrono::milliseconds(TICK_MS));
+                if (quit) return;
+                current = target;
+                start = !started;
+                fadeMs = crossfadeMs;
+            }
+            auto now = std::chrono::steady_clock::now();
+            float step = fadeMs <= 0 ? 100.0f :
+                100.0f * std::chrono::duration<float, std::milli>(now - last).count() / fadeMs;
+            last = now;
+
+            std::vector<std::unique_ptr<AudioStream>> closed;
+            bool startedNow = false;
+            bool audible = false;
+            bool ended = false;
+            {
+                std::lock_guard<std::mutex> lock(tracksMutex);
+                closed.swap(retired);
+                for (int i = 0; i < MUSIC_TRACK_COUNT; ++i) {
+                    Track& track = tracks[i];
+                    if (!track.music) continue;
+                    AudioStream& music = *track.music;
+                    if (i == current) {
+                        if (start) {
+                            // Заряженная дорожка продолжает с паузы, затихающая - набирает громкость обратно
+                            if (music.getStatus() != AUDIO_PLAYING) music.play();
+                            track.primed = false;
+                            startedNow = true;
+                        }
+                        audible = music.getStatus() == AUDIO_PLAYING && music.getOffsetMs() > 0.0;
+                        ended = !start && music.getStatus() == AUDIO_STOPPED;
+                        track.volume = std::min(MUSIC_TRACKS[i].volume, track.volume + step);
+                    }
+                    else if (music.getStatus() == AUDIO_PLAYING) {
+                        track.volume = std::max(0.0f, track.volume - step);
+                        if (track.volume == 0.0f) music.stop();
+                    }
+                    music.setVolume(track.volume);
+                }
+                if (current != MUSIC_NONE) {
+                    for (MusicTrack likely : next[current]) {
+                        Track& track = tracks[likely];
+                        if (!track.music || track.primed || likely == current || track.music->getStatus() != AUDIO_STOPPED) continue;
+                        track.volume = 0.0f;
+                        track.music->setVolume(0.0f);
+                        track.music->play();
+                        track.music->pause();
+                        track.primed = true;
+                    }
+                }
+            }
+            closed.clear(); // деструктор дорожки ждёт поток декодера - уже без мьютекса
+
+            std::lock_guard<std::mutex> lock(commandMutex);
+            if (target != current) continue; // пока работали, цель сменилась
+            if (startedNow) started = true;
+            finished = ended;
+            if (measuring && audible) {
+                measuring = false;
+                lastLatencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - requested).count();
+                totalLatencyMs += lastLatencyMs;
+                maxLatencyMs = std::max(maxLatencyMs, lastLatencyMs);
+                ++transitions;
+            }
+        }
+    }
+
+    // Сменить цель; MUSIC_NONE - тишина
+    void request(MusicTrack type) {
+        {
+            std::lock_guard<std::mutex> lock(commandMutex);
+            target = type;
+            started = false;
+            finished = false;
+            measuring = type != MUSIC_NONE;
+            requested = std::chrono::steady_clock::now();
+        }
+        wake.notify_one();
+    }
+
+public:
+    explicit MusicManager(AudioBackend& backend) : backend(backend) {
+        thread = std::thread(&MusicManager::run, this);
+    }
+
+    ~MusicManager() {
+        {
+            std::lock_guard<std::mutex> lock(commandMutex);
+            quit = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    MusicManager(const MusicManager&) = delete;
+    MusicManager& operator=(const MusicManager&) = delete;
+
+    // Открывает поток дорожки; зовётся из потоков загрузчика
+    std::unique_ptr<AudioStream> openTrack(MusicTrack type) {
+        std::unique_ptr<AudioStream> music = backend.openStream(MUSIC_TRACKS[type].path);
+        if (!music) return nullptr;
+        music->setLoop(MUSIC_TRACKS[type].loop);
+        return music;
+    }
+
+    // Какие дорожки вероятно зазвучат после этой - их держим заряженными
+    void setNext(MusicTrack type, std::vector<MusicTrack> likely) {
+        std::lock_guard<std::mutex> lock(tracksMutex);
+        next[type] = std::move(likely);
+    }
+
+    void setCrossfade(int milliseconds) {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        crossfadeMs = std::max(0, milliseconds);
+    }
+
+    // Главный поток: открытая дорожка занимает своё место
+    void install(MusicTrack type, std::unique_ptr<AudioStream> music) {
+        std::lock_guard<std::mutex> lock(tracksMutex);
+        Track& track = tracks[type];
+        if (track.music) retired.push_back(std::move(track.music));
+        track.music = std::move(music);
+        track.volume = 0.0f;
+        track.primed = false;
+    }
+
+    void close(MusicTrack type) {
+        std::lock_guard<std::mutex> lock(tracksMutex);
+        Track& track = tracks[type];
+        if (track.music) retired.push_back(std::move(track.music));
+        track.primed = false;
+    }
+
+    size_t getTrackBytes(MusicTrack type) {
+        std::lock_guard<std::mutex> lock(tracksMutex);
+        const std::unique_ptr<AudioStream>& music = tracks[type].music;
+        return music ? music->getBufferBytes() : 0;
+    }
+
+    bool isPlaying(MusicTrack type) {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        return target == type;
+    }
+
+    void play(MusicTrack type) {
+        if (!enabled) return;
+        {
+            // Уже звучит или набирает громкость; доигравшую (gameover) - заново
+            std::lock_guard<std::mutex> lock(commandMutex);
+            if (target == type && !finished) return;
+        }
+        request(type);
+    }
+
+    void stop() {
+        request(MUSIC_NONE);
+    }
+
+    void printReport(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        out << "Music: " << transitions << " transitions";
+        if (transitions > 0) {
+            out << ", latency last " << lastLatencyMs << " ms, average " << totalLatencyMs / transitions
+                << " ms, max " << maxLatencyMs << " ms";
+        }
+        out << std::endl;
+    }
+
+    size_t getTransitions() {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        return transitions;
+    }
+
+    double getMaxLatencyMs() {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        return maxLatencyMs;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        transitions = 0;
+        lastLatencyMs = totalLatencyMs = maxLatencyMs = 0.0;
+    }
+
+    // Выключенная музыка молчит и не начинается по play()
+    void setEnabled(bool on) {
+        enabled = on;
+        if (enabled) {
+            // Если включаем, то продолжаем играть текущую фоновую музыку (или начинаем меню, если ничего не играло)
+            if (!isPlaying(MUSIC_MENU) && !isPlaying(MUSIC_GAME) && !isPlaying(MUSIC_SETTINGS)) {
+                play(MUSIC_MENU);
+            }
+        }
+        else {
+            stop();
+        }
+    }
+};
+
+// Каналы одного звука; клип общий, его загружает загрузчик ресурсов
+class SoundManager {
+private:
+    static const int MAX_CHANNELS = 16;
+    std::unique_ptr<AudioVoice> voices[MAX_CHANNELS];
+    bool channelInUse[MAX_CHANNELS] = { false };
+    std::unique_ptr<AudioClip> clip;
+    float soundVolume;
+
+public:
+    SoundManager(AudioBackend& backend, float volume = 40.f)
+        : soundVolume(volume) {
+        for (int i = 0; i < MAX_CHANNELS; ++i) voices[i] = backend.createVoice();
+    }
+
+    // Главный поток: загруженный клип занимает место
+    void setClip(std::unique_ptr<AudioClip> loaded) {
+        stopAll();
+        clip = std::move(loaded);
+    }
+
+    // 16-битные выборки
+    size_t getClipBytes() const { return clip ? clip->getSampleCount() * 2 : 0; }
+
+    void toggleEffects(bool enabled) {
+        soundVolume = enabled ? 40.f : 0.f;
+        for (int i = 0; i < MAX_CHANNELS; ++i) {
+            if (channelInUse[i]) {
+                voices[i]->setVolume(soundVolume);
+            }
+        }
+    }
+
+    // pitch - множитель частоты, например для серии яблок (synth::ComboPitch)
+    void play(bool loop = false, float pitch = 1.f) {
+        int freeChannel = -1;
+        for (int i = 0; i < MAX_CHANNELS; ++i) {
+            if (!channelInUse[i] || voices[i]->getStatus() == AUDIO_STOPPED) {
+                freeChannel = i;
+                break;
+            }
+        }
+
+        if (freeChannel == -1 || !clip) return; // звук не загрузился
+
+        voices[freeChannel]->play(*clip, soundVolume, pitch, loop);
+        channelInUse[freeChannel] = true;
+    }
+
+    void stopAll() {
+        for (int i = 0; i < MAX_CHANNELS; ++i) {
+            voices[i]->stop();
+            channelInUse[i] = false;
+        }
+    }
+
+    void setVolume(float volume) {
+        soundVolume = volume;
+        for (int i = 0; i < MAX_CHANNELS; ++i) {
+            if (channelInUse[i]) {
+                voices[i]->setVolume(volume);
+            }
+        }
+    }
+};
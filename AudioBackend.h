@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Звук за интерфейсом: SoundManager и MusicManager (Audio.h) работают с
+// AudioBackend, а не с OpenAL напрямую. В игре это SFML (SfmlAudio в Game.cpp),
+// в SnakeTool и на машинах без звуковой карты - RecordingAudio: устройство не
+// трогает, а записывает каждый запрос с отметкой времени, так что переходы
+// музыки, занятость голосов и задержки можно проверять без звука.
+
+enum AudioStatus { AUDIO_STOPPED, AUDIO_PAUSED, AUDIO_PLAYING };
+
+// Короткий звук целиком в памяти (SoundBuffer у SFML), из файла или синтезированный
+class AudioClip {
+public:
+    virtual ~AudioClip() = default;
+    virtual size_t getSampleCount() const = 0;
+};
+
+// Голос: играет один клип за раз
+class AudioVoice {
+public:
+    virtual ~AudioVoice() = default;
+    // pitch - множитель частоты (и скорости) проигрывания
+    virtual void play(const AudioClip& clip, float volume, float pitch, bool loop) = 0;
+    virtual void stop() = 0;
+    virtual void setVolume(float volume) = 0;
+    virtual AudioStatus getStatus() const = 0;
+};
+
+// Дорожка, которая читается и декодируется по ходу проигрывания (Music у SFML)
+class AudioStream {
+public:
+    virtual ~AudioStream() = default;
+    virtual void play() = 0;
+    virtual void pause() = 0;
+    virtual void stop() = 0;
+    virtual void setVolume(float volume) = 0;
+    virtual void setLoop(bool loop) = 0;
+    virtual AudioStatus getStatus() const = 0;
+    virtual double getOffsetMs() const = 0;      // проиграно с начала дорожки
+    virtual size_t getBufferBytes() const = 0;   // память под буферы потока
+};
+
+class AudioBackend {
+public:
+    virtual ~AudioBackend() = default;
+    // Загрузка зовётся из потоков загрузчика ресурсов; nullptr - не вышло
+    virtual std::unique_ptr<AudioClip> loadClip(const std::string& path) = 0;
+    // Клип из готовых выборок (моно, 16 бит); name - для журнала
+    virtual std::unique_ptr<AudioClip> createClip(const std::string& name, const int16_t* samples, size_t count,
+        unsigned int sampleRate) = 0;
+    virtual std::unique_ptr<AudioStream> openStream(const std::string& path) = 0;
+    virtual std::unique_ptr<AudioVoice> createVoice() = 0;
+};
+
+enum AudioEventType {
+    AUDIO_CLIP_LOAD, AUDIO_VOICE_PLAY, AUDIO_VOICE_STOP,
+    AUDIO_STREAM_OPEN, AUDIO_STREAM_PLAY, AUDIO_STREAM_PAUSE, AUDIO_STREAM_STOP, AUDIO_EVENT_TYPES
+};
+
+struct AudioEvent {
+    double ms;              // от создания RecordingAudio
+    AudioEventType type;
+    std::string name;       // путь клипа или дорожки
+};
+
+// Пустой звук с журналом. Клип "звучит" clipMs, дорожка - streamMs (без
+// зацикливания потом останавливается сама); первая выборка дорожки слышна
+// через startDelayMs после play() из остановки - так моделируется заполнение
+// буферов; после паузы дорожка звучит сразу. Голоса и дорожки не должны
+// пережить RecordingAudio
+class RecordingAudio : public AudioBackend {
+private:
+    class Clip : public AudioClip {
+    public:
+        std::string name;
+        size_t samples = 44100;
+        size_t getSampleCount() const override { return samples; }
+    };
+
+    class Voice : public AudioVoice {
+    private:
+        RecordingAudio& owner;
+        std::string name;
+        double startMs = 0.0;
+        bool looping = false;
+        bool playing = false;
+
+    public:
+        explicit Voice(RecordingAudio& owner) : owner(owner) {}
+        ~Voice() override { owner.forget(this); }
+
+        void play(const AudioClip& clip, float, float, bool loop) override {
+            name = static_cast<const Clip&>(clip).name;
+            startMs = owner.now();
+            looping = loop;
+            playing = true;
+            owner.record(AUDIO_VOICE_PLAY, name);
+            owner.countVoices();
+        }
+
+        void stop() override {
+            if (playing) owner.record(AUDIO_VOICE_STOP, name);
+            playing = false;
+        }
+
+        void setVolume(float) override {}
+
+        AudioStatus getStatus() const override {
+            return playing && (looping || owner.now() - startMs < owner.clipMs) ? AUDIO_PLAYING : AUDIO_STOPPED;
+        }
+    };
+
+    class Stream : public AudioStream {
+    private:
+        RecordingAudio& owner;
+        std::string name;
+        AudioStatus status = AUDIO_STOPPED;
+        bool looping = false;
+        bool buffered = false;      // буферы заполнены: play() после паузы звучит сразу
+        double playedMs = 0.0;      // до последнего play()
+        double resumedMs = 0.0;     // когда был play()
+        double delayMs = 0.0;
+
+        double elapsed() const {
+            if (status != AUDIO_PLAYING) return playedMs;
+            return playedMs + std::max(0.0, owner.now() - resumedMs - delayMs);
+        }
+
+    public:
+        Stream(RecordingAudio& owner, const std::string& name) : owner(owner), name(name) {}
+
+        void play() override {
+            if (status == AUDIO_PLAYING) return;
+            resumedMs = owner.now();
+            delayMs = buffered ? 0.0 : owner.startDelayMs;
+            buffered = true;
+            status = AUDIO_PLAYING;
+            owner.record(AUDIO_STREAM_PLAY, name);
+        }
+
+        void pause() override {
+            if (status != AUDIO_PLAYING) return;
+            playedMs = elapsed();
+            status = AUDIO_PAUSED;
+            owner.record(AUDIO_STREAM_PAUSE, name);
+        }
+
+        void stop() override {
+            status = AUDIO_STOPPED;
+            buffered = false;
+            playedMs = 0.0;
+            owner.record(AUDIO_STREAM_STOP, name);
+        }
+
+        void setVolume(float) override {}
+        void setLoop(bool loop) override { looping = loop; }
+
+        AudioStatus getStatus() const override {
+            return status == AUDIO_PLAYING && !looping && elapsed() >= owner.streamMs ? AUDIO_STOPPED : status;
+        }
+
+        double getOffsetMs() const override {
+            double offset = elapsed();
+            if (looping) return offset - static_cast<long long>(offset / owner.streamMs) * owner.streamMs;
+            return std::min(offset, owner.streamMs);
+        }
+
+        size_t getBufferBytes() const override { return 44100 * 2 * 2; }
+    };
+
+    const double clipMs;
+    const double streamMs;
+    const double startDelayMs;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mutable std::mutex mutex;
+    std::vector<AudioEvent> events;
+    size_t counts[AUDIO_EVENT_TYPES] = {};
+    std::vector<const Voice*> voices;
+    size_t peakVoices = 0;
+
+    double now() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void record(AudioEventType type, const std::string& name) {
+        double ms = now();
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(AudioEvent{ ms, type, name });
+        ++counts[type];
+    }
+
+    void countVoices() {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t busy = 0;
+        for (const Voice* voice : voices) busy += voice->getStatus() == AUDIO_PLAYING ? 1 : 0;
+        peakVoices = std::max(peakVoices, busy);
+    }
+
+    void forget(const Voice* voice) {
+        std::lock_guard<std::mutex> lock(mutex);
+        voices.erase(std::remove(voices.begin(), voices.end(), voice), voices.end());
+    }
+
+public:
+    explicit RecordingAudio(double clipMs = 300.0, double streamMs = 120000.0, double startDelayMs = 0.0)
+        : clipMs(clipMs), streamMs(streamMs), startDelayMs(startDelayMs) {}
+
+    std::unique_ptr<AudioClip> loadClip(const std::string& path) override {
+        std::unique_ptr<Clip> clip = std::make_unique<Clip>();
+        clip->name = path;
+        record(AUDIO_CLIP_LOAD, path);
+        return clip;
+    }
+
+    std::unique_ptr<AudioClip> createClip(const std::string& name, const int16_t*, size_t count, unsigned int) override {
+        std::unique_ptr<Clip> clip = std::make_unique<Clip>();
+        clip->name = name;
+        clip->samples = count;
+        record(AUDIO_CLIP_LOAD, name);
+        return clip;
+    }
+
+    std::unique_ptr<AudioStream> openStream(const std::string& path) override {
+        record(AUDIO_STREAM_OPEN, path);
+        return std::make_unique<Stream>(*this, path);
+    }
+
+    std::unique_ptr<AudioVoice> createVoice() override {
+        std::unique_ptr<Voice> voice = std::make_unique<Voice>(*this);
+        std::lock_guard<std::mutex> lock(mutex);
+        voices.push_back(voice.get());
+        return voice;
+    }
+
+    size_t getCount(AudioEventType type) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return counts[type];
+    }
+
+    size_t getPeakVoices() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return peakVoices;
+    }
+
+    std::vector<AudioEvent> getEvents() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return events;
+    }
+
+    static const char* getTypeName(AudioEventType type) {
+        static const char* NAMES[AUDIO_EVENT_TYPES] = {
+            "clip load", "voice play", "voice stop", "stream open", "stream play", "stream pause", "stream stop"
+        };
+        return NAMES[type];
+    }
+
+    void printReport(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int type = 0; type < AUDIO_EVENT_TYPES; ++type) {
+            out << std::left << std::setw(14) << getTypeName(static_cast<AudioEventType>(type)) << std::right
+                << std::setw(8) << counts[type] << "\n";
+        }
+        out << "peak voices " << peakVoices << "\n";
+    }
+};
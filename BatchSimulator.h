@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Histogram.h"
+#include "SnakeBot.h"
+#include "SnakeCore.h"
+#include "ThreadPool.h"
+
+struct SimulationConfig {
+    uint64_t games = 10000;
+    unsigned threads = 0;
+    uint64_t seed = 1;
+    int cols = 71;
+    int rows = 40;
+    uint32_t maxTicks = 20000;
+    uint64_t gamesPerTask = 64;
+    Difficulty difficulty = NORMAL;
+    GameRules rules;
+};
+
+struct SimulationStats {
+    Histogram score{ 5, 40 };
+    Histogram length{ 10, 40 };
+    Histogram duration{ 250, 40 }; // в тиках
+    uint64_t timedOut = 0;
+
+    void merge(const SimulationStats& other) {
+        score.merge(other.score);
+        length.merge(other.length);
+        duration.merge(other.duration);
+        timedOut += other.timedOut;
+    }
+};
+
+// Прогоняет независимые игры бота с сидом seed + номер игры,
+// так что результат не зависит от числа потоков.
+class BatchSimulator {
+private:
+    SimulationConfig config;
+
+    void runGame(SnakeCore& core, uint64_t gameIndex, SimulationStats& stats) const {
+        core.reseed(config.seed + gameIndex);
+        core.reset();
+        while (!core.gameOver && core.getTicks() < config.maxTicks) {
+            core.changeDirection(SnakeBot::choose(core));
+            core.move();
+        }
+        if (!core.gameOver) ++stats.timedOut;
+        stats.score.add(core.score);
+        stats.length.add(core.getLength());
+        stats.duration.add(core.getTicks());
+    }
+
+public:
+    explicit BatchSimulator(const SimulationConfig& config) : config(config) {}
+
+    SimulationStats run(double& wallSeconds, unsigned& threadsUsed) const {
+        SimulationStats total;
+        std::mutex totalMutex;
+        auto start = std::chrono::steady_clock::now();
+        {
+            ThreadPool pool(config.threads);
+            threadsUsed = pool.size();
+            for (uint64_t first = 0; first < config.games; first += config.gamesPerTask) {
+                uint64_t last = std::min(config.games, first + config.gamesPerTask);
+                pool.submit([this, first, last, &total, &totalMutex] {
+                    SnakeCore core(config.cols, config.rows, config.seed, config.rules);
+                    core.setDifficulty(config.difficulty);
+                    SimulationStats local;
+                    for (uint64_t game = first; game < last; ++game) {
+                        runGame(core, game, local);
+                    }
+                    std::lock_guard<std::mutex> lock(totalMutex);
+                    total.merge(local);
+                });
+            }
+            pool.wait();
+        }
+        wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return total;
+    }
+};
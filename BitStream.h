@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Побитовая запись/чтение для сетевых сообщений. Биты идут от младших к старшим,
+// varint пишется группами по chunkBits бит с битом продолжения.
+
+class BitWriter {
+private:
+    std::vector<uint8_t> bytes;
+    uint64_t accumulator = 0;
+    int pending = 0;
+
+public:
+    void write(uint32_t value, int bits) {
+        if (bits < 32) value &= (1u << bits) - 1;
+        accumulator |= static_cast<uint64_t>(value) << pending;
+        pending += bits;
+        while (pending >= 8) {
+            bytes.push_back(static_cast<uint8_t>(accumulator));
+            accumulator >>= 8;
+            pending -= 8;
+        }
+    }
+
+    void writeBit(bool value) { write(value ? 1u : 0u, 1); }
+
+    void writeVarint(uint32_t value, int chunkBits) {
+        for (;;) {
+            uint32_t chunk = value & ((1u << chunkBits) - 1);
+            value >>= chunkBits;
+            write(chunk, chunkBits);
+            writeBit(value != 0);
+            if (value == 0) return;
+        }
+    }
+
+    // Знаковые значения через zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+    void writeSigned(int32_t value, int chunkBits) {
+        writeVarint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31), chunkBits);
+    }
+
+    // Дописывает неполный байт; после этого data() готово к отправке
+    const std::vector<uint8_t>& finish() {
+        if (pending > 0) {
+            bytes.push_back(static_cast<uint8_t>(accumulator));
+            accumulator = 0;
+            pending = 0;
+        }
+        return bytes;
+    }
+
+    size_t bitCount() const { return bytes.size() * 8 + pending; }
+
+    void clear() {
+        bytes.clear();
+        accumulator = 0;
+        pending = 0;
+    }
+};
+
+class BitReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0; // в битах
+    bool valid = true;
+
+public:
+    BitReader(const void* data, size_t size) : data(static_cast<const uint8_t*>(data)), size(size) {}
+
+    uint32_t read(int bits) {
+        if (position + bits > size * 8) {
+            valid = false;
+            position = size * 8;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int done = 0; done < bits;) {
+            size_t byte = position >> 3;
+            int offset = static_cast<int>(position & 7);
+            int take = bits - done < 8 - offset ? bits - done : 8 - offset;
+            uint32_t part = (data[byte] >> offset) & ((1u << take) - 1);
+            value |= part << done;
+            done += take;
+            position += take;
+        }
+        return value;
+    }
+
+    bool readBit() { return read(1) != 0; }
+
+    uint32_t readVarint(int chunkBits) {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += chunkBits) {
+            value |= read(chunkBits) << shift;
+            if (!readBit()) return value;
+        }
+        valid = false;
+        return value;
+    }
+
+    int32_t readSigned(int chunkBits) {
+        uint32_t value = readVarint(chunkBits);
+        return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+    }
+
+    // false, если чтение вышло за конец данных или varint испорчен
+    bool ok() const { return valid; }
+};
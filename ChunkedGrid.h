@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Разреженная сетка: поле делится на чанки 32x32, чанк выделяется при первой
+// записи и освобождается, когда в нём не остаётся занятых клеток. Каталог чанков -
+// плоский массив указателей, так что доступ к клетке - два сдвига и одно разыменование.
+// Память растёт с числом занятых чанков, а не с площадью мира.
+template <typename T>
+class ChunkedGrid {
+public:
+    static const int CHUNK_SHIFT = 5;
+    static const int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    static const int CHUNK_MASK = CHUNK_SIZE - 1;
+    static const int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+
+    struct Chunk {
+        T cells[CHUNK_CELLS];
+        int used = 0; // клетки, удерживающие чанк (см. retain/release)
+    };
+
+private:
+    int cols;
+    int rows;
+    int chunkCols;
+    int chunkRows;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    size_t allocated = 0;
+    T empty{};
+
+    size_t chunkIndex(int x, int y) const {
+        return static_cast<size_t>(y >> CHUNK_SHIFT) * chunkCols + (x >> CHUNK_SHIFT);
+    }
+
+    static int localIndex(int x, int y) {
+        return ((y & CHUNK_MASK) << CHUNK_SHIFT) | (x & CHUNK_MASK);
+    }
+
+public:
+    ChunkedGrid(int cols, int rows)
+        : cols(cols), rows(rows),
+        chunkCols((cols + CHUNK_MASK) >> CHUNK_SHIFT), chunkRows((rows + CHUNK_MASK) >> CHUNK_SHIFT),
+        chunks(static_cast<size_t>(chunkCols) * chunkRows) {
+    }
+
+    ChunkedGrid(const ChunkedGrid& other)
+        : cols(other.cols), rows(other.rows), chunkCols(other.chunkCols), chunkRows(other.chunkRows),
+        chunks(other.chunks.size()), allocated(other.allocated) {
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            if (other.chunks[i]) chunks[i] = std::make_unique<Chunk>(*other.chunks[i]);
+        }
+    }
+
+    ChunkedGrid& operator=(const ChunkedGrid& other) {
+        if (this != &other) {
+            ChunkedGrid copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    ChunkedGrid(ChunkedGrid&&) = default;
+    ChunkedGrid& operator=(ChunkedGrid&&) = default;
+
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+
+    // Чтение без выделения: для отсутствующего чанка - значение по умолчанию
+    const T& get(int x, int y) const {
+        const Chunk* chunk = chunks[chunkIndex(x, y)].get();
+        return chunk ? chunk->cells[localIndex(x, y)] : empty;
+    }
+
+    // Запись: чанк создаётся при необходимости
+    T& at(int x, int y) {
+        std::unique_ptr<Chunk>& chunk = chunks[chunkIndex(x, y)];
+        if (!chunk) {
+            chunk = std::make_unique<Chunk>();
+            ++allocated;
+        }
+        return chunk->cells[localIndex(x, y)];
+    }
+
+    void retain(int x, int y) {
+        at(x, y);
+        ++chunks[chunkIndex(x, y)]->used;
+    }
+
+    void release(int x, int y) {
+        std::unique_ptr<Chunk>& chunk = chunks[chunkIndex(x, y)];
+        if (chunk && --chunk->used == 0) {
+            chunk.reset();
+            --allocated;
+        }
+    }
+
+    // Обход выделенных чанков, пересекающих прямоугольник клеток [x0, x1) x [y0, y1).
+    // f(originX, originY, const Chunk&)
+    template <typename F>
+    void forEachChunk(int x0, int y0, int x1, int y1, F f) const {
+        int cx0 = std::max(0, x0) >> CHUNK_SHIFT;
+        int cy0 = std::max(0, y0) >> CHUNK_SHIFT;
+        int cx1 = (std::min(cols, x1) + CHUNK_MASK) >> CHUNK_SHIFT;
+        int cy1 = (std::min(rows, y1) + CHUNK_MASK) >> CHUNK_SHIFT;
+        for (int cy = cy0; cy < cy1; ++cy) {
+            for (int cx = cx0; cx < cx1; ++cx) {
+                const Chunk* chunk = chunks[static_cast<size_t>(cy) * chunkCols + cx].get();
+                if (chunk) f(cx << CHUNK_SHIFT, cy << CHUNK_SHIFT, *chunk);
+            }
+        }
+    }
+
+    size_t chunkCount() const { return allocated; }
+
+    size_t memoryBytes() const {
+        return allocated * sizeof(Chunk) + chunks.size() * sizeof(std::unique_ptr<Chunk>);
+    }
+};
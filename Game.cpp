@@ -5,10 +5,26 @@
 #include <ctime>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <sstream>
 #include <unordered_map>
 #include <algorithm>
+#include <chrono>
+#include <future>
 #include <string>
 #include "Game.h"
+#include "Arena.h"
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "Audio.h"
+#include "Lockstep.h"
+#include "PasswordHash.h"
+#include "PcmCache.h"
+#include "PersistenceWorker.h"
+#include "ScoreBoard.h"
+#include "UserStore.h"
+#include "SfxSynth.h"
+#include "SnakeCore.h"
 
 using namespace sf;
 
@@ -17,20 +33,11 @@ int GLOBAL_WIDTH;
 int GLOBAL_HEIGHT;
 int GLOBAL_GRID_SIZE; // Теперь размер сетки будет вычисляться динамически
 
-const int BONUS_GROW = 3;
-const int ANTIBONUS_SHRINK = 3;
-const float BONUS_INTERVAL = 30.0f;
-const float ANTI_BONUS_INTERVAL = 30.0f; // Добавлено
-const float BONUS_DELAY = 30.0f;
-const float EASY_SPEED = 0.2f;
-const float NORMAL_SPEED = 0.1f;
-const float HARD_SPEED = 0.05f;
+// Игровые константы (BONUS_GROW, скорости и т.д.) живут в SnakeCore.h
 // Где-то рядом с другими глобальными константами
 const std::vector<std::string> DIFFICULTY_OPTIONS = { "Легкий", "Нормальный", "Сложный" };
 
-enum Direction { UP, DOWN, LEFT, RIGHT };
-enum GameState { LOGIN, REGISTER, MENU, PLAYING, PAUSED, GAME_OVER, SETTINGS, LEADERBOARD };
-enum Difficulty { EASY, NORMAL, HARD };
+enum GameState { LOGIN, REGISTER, MENU, PLAYING, PAUSED, GAME_OVER, SETTINGS, LEADERBOARD, ARENA };
 
 // Мягкая цветовая палитра
 const Color BACKGROUND_COLOR(240, 240, 245);
@@ -44,20 +51,27 @@ const Color SNAKE_COLOR(100, 180, 180);
 const Color FOOD_COLOR(220, 120, 120);
 const Color BONUS_COLOR(240, 200, 80);
 const Color ANTIBONUS_COLOR(180, 80, 200); 
+const Color BOT_COLOR(120, 140, 160);
 
 struct Settings {
     Difficulty difficulty = NORMAL;
     bool musicEnabled = true;
     bool soundEffectsEnabled = true;  // Новая переменная
-
-    void saveToFile() {
-        std::ofstream file("settings.cfg");
-        if (file.is_open()) {
-            file << static_cast<int>(difficulty) << "\n";
-            file << musicEnabled << "\n";
-            file << soundEffectsEnabled << "\n";  // Сохраняем состояние звуковых эффектов
-            file.close();
-        }
+    int passwordIterations = credentials::DEFAULT_ITERATIONS; // цена хэша паролей, подбирается SnakeTool password-bench
+    int assetBudgetMb = 64; // память под ресурсы экранов; сверх неё вытесняются давно не нужные
+    int crossfadeMs = 400;  // сведение музыки при смене экрана; 0 - резкая смена
+    bool pcmCache = true;   // декодированная музыка в pcmcache/, без Vorbis на каждом запуске
+
+    void saveToFile(PersistenceWorker& persistence) {
+        std::ostringstream file;
+        file << static_cast<int>(difficulty) << "\n";
+        file << musicEnabled << "\n";
+        file << soundEffectsEnabled << "\n";  // Сохраняем состояние звуковых эффектов
+        file << passwordIterations << "\n";
+        file << assetBudgetMb << "\n";
+        file << crossfadeMs << "\n";
+        file << pcmCache << "\n";
+        persistence.write("settings.cfg", file.str());
     }
 
     void loadFromFile() {
@@ -68,59 +82,99 @@ struct Settings {
             difficulty = static_cast<Difficulty>(diff);
             file >> musicEnabled;
             file >> soundEffectsEnabled;  // Загружаем состояние звуковых эффектов
+            int iterations;
+            if (file >> iterations) passwordIterations = credentials::clampIterations(iterations); // в старых файлах строки нет
+            int budget;
+            if (file >> budget) assetBudgetMb = std::max(0, budget); // 0 - без ограничения
+            int crossfade;
+            if (file >> crossfade) crossfadeMs = std::max(0, crossfade);
+            bool cache;
+            if (file >> cache) pcmCache = cache;
             file.close();
         }
     }
 } settings;
 
+enum AuthResult { AUTH_IDLE, AUTH_PENDING, AUTH_LOGGED_IN, AUTH_REGISTERED, AUTH_WRONG_PASSWORD, AUTH_NAME_TAKEN, AUTH_INVALID };
+
+// Вход и регистрация: PBKDF2 считается в отдельном потоке, окно продолжает
+// рисоваться; результат забирает poll() из главного цикла. Хранилище трогает
+// только главный поток
 class UserManager {
 private:
-    std::unordered_map<std::string, std::string> users;
+    struct Job {
+        bool ok = false;
+        std::string record;    // новая запись хэша: регистрация или пересчёт при входе
+    };
+
+    UserStore users{ "users.txt" };
     std::string currentUser;
-    const std::string userFile = "users.txt";
+    std::future<Job> job;
+    bool registering = false;
+    std::string jobUser;
+    int iterations = credentials::DEFAULT_ITERATIONS;
 
 public:
-    UserManager() {
-        loadUsers();
+    UserManager(PersistenceWorker& persistence) {
+        users.setWriter(&persistence);
     }
 
-    void loadUsers() {
-        std::ifstream file(userFile);
-        if (file.is_open()) {
-            std::string username, password;
-            while (file >> username >> password) {
-                users[username] = password;
-            }
-            file.close();
-        }
+    void setIterations(int value) {
+        iterations = credentials::clampIterations(value);
     }
 
-    void saveUsers() {
-        std::ofstream file(userFile);
-        if (file.is_open()) {
-            for (const auto& [username, password] : users) {
-                file << username << " " << password << "\n";
-            }
-            file.close();
-        }
-    }
+    bool isBusy() const { return job.valid(); }
 
-    bool registerUser(const std::string& username, const std::string& password) {
-        if (users.find(username) != users.end()) {
-            return false; // User already exists
-        }
-        users[username] = password;
-        saveUsers();
+    // false - уже идёт проверка
+    bool beginLogin(const std::string& username, const std::string& password) {
+        if (job.valid()) return false;
+        std::string record;
+        bool known = users.find(username, record);
+        registering = false;
+        jobUser = username;
+        int cost = iterations;
+        job = std::async(std::launch::async, [known, record, password, cost] {
+            Job result;
+            if (!known) {
+                credentials::makeRecord(password, cost); // та же цена: по времени ответа не видно, есть ли имя
+                return result;
+            }
+            result.ok = credentials::verifyRecord(record, password);
+            if (result.ok && credentials::needsRehash(record, cost)) result.record = credentials::makeRecord(password, cost);
+            return result;
+        });
         return true;
     }
 
-    bool loginUser(const std::string& username, const std::string& password) {
-        auto it = users.find(username);
-        if (it != users.end() && it->second == password) {
-            currentUser = username;
-            return true;
+    // Занятое имя и пробелы в полях отвечают сразу
+    AuthResult beginRegister(const std::string& username, const std::string& password) {
+        if (job.valid()) return AUTH_PENDING;
+        if (!UserStore::isValidField(username) || !UserStore::isValidField(password)) return AUTH_INVALID;
+        if (users.contains(username)) return AUTH_NAME_TAKEN;
+        registering = true;
+        jobUser = username;
+        int cost = iterations;
+        job = std::async(std::launch::async, [password, cost] {
+            Job result;
+            result.record = credentials::makeRecord(password, cost);
+            result.ok = true;
+            return result;
+        });
+        return AUTH_PENDING;
+    }
+
+    // Каждый кадр: AUTH_PENDING, пока поток считает, затем итог один раз
+    AuthResult poll() {
+        if (!job.valid()) return AUTH_IDLE;
+        if (job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return AUTH_PENDING;
+        Job result = job.get();
+        if (registering) {
+            return users.add(jobUser, result.record) ? AUTH_REGISTERED : AUTH_NAME_TAKEN;
         }
-        return false;
+        if (!result.ok) return AUTH_WRONG_PASSWORD;
+        if (!result.record.empty()) users.update(jobUser, result.record);
+        currentUser = jobUser;
+        return AUTH_LOGGED_IN;
     }
 
     std::string getCurrentUser() const {
@@ -132,149 +186,396 @@ public:
     }
 };
 
-class MusicManager {
+// Ресурс из assets.pack, если он там есть, иначе отдельный файл (Font, Image, SoundBuffer).
+// Image и SoundBuffer дочитывают поток при загрузке, и он сразу закрывается;
+// Font читает его и дальше - такому ресурсу нужен keep, живущий вместе с ним
+template <typename Resource>
+bool loadResource(Resource& resource, AssetPack& pack, const std::string& path,
+    std::unique_ptr<InputStream>* keep = nullptr) {
+    std::unique_ptr<AssetStream> stream = pack.openStream(path);
+    if (!stream) return resource.loadFromFile(path);
+    if (!resource.loadFromStream(*stream)) return false;
+    if (keep) *keep = std::move(stream);
+    return true;
+}
+
+// Размеры шрифта, которыми рисуется интерфейс; bold - есть и жирное
+// начертание (первые места таблицы лидеров). Зависит от GLOBAL_HEIGHT
+struct GlyphSize {
+    unsigned int size;
+    bool bold;
+};
+
+std::vector<GlyphSize> uiGlyphSizes() {
+    unsigned int height = static_cast<unsigned int>(GLOBAL_HEIGHT);
+    unsigned int button = height / 20;
+    unsigned int label = height / 30;
+    return {
+        { height / 10, true },                               // заголовки
+        { button, false },                                   // кнопки
+        { button * 3 / 4, false },                           // переключатель таблицы лидеров
+        { height / 25, true },                               // кнопки настроек, результат, первые места
+        { label, true },                                     // подписи, поля ввода, строки таблицы
+        { height / 35, false },                              // счёт в игре
+        { static_cast<unsigned int>(label * 0.8f), false }   // ошибки входа и регистрации
+    };
+}
+
+struct GlyphWarmup {
+    size_t glyphs = 0;
+    size_t atlasBytes = 0;
+    double ms = 0.0;
+};
+
+// FreeType растеризует глиф при первом показе, и первый заход на каждый экран
+// подтормаживал. Здесь латиница и кириллица всех размеров интерфейса заранее
+// кладутся в страницы шрифта. Только на главном потоке: страницы - текстуры
+// OpenGL, их создают и дописывают в контексте окна
+GlyphWarmup warmGlyphs(const Font& font, const std::vector<GlyphSize>& sizes) {
+    std::vector<Uint32> characters;
+    for (Uint32 c = 0x20; c < 0x7f; ++c) characters.push_back(c);
+    for (Uint32 c = 0x410; c <= 0x44f; ++c) characters.push_back(c); // А..я
+    characters.push_back(0x401);                                      // Ё
+    characters.push_back(0x451);                                      // ё
+
+    GlyphWarmup result;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned int> pages;
+    for (const GlyphSize& glyphSize : sizes) {
+        for (int bold = 0; bold <= (glyphSize.bold ? 1 : 0); ++bold) {
+            for (Uint32 c : characters) font.getGlyph(c, glyphSize.size, bold != 0);
+            result.glyphs += characters.size();
+        }
+        if (std::find(pages.begin(), pages.end(), glyphSize.size) == pages.end()) pages.push_back(glyphSize.size);
+    }
+    for (unsigned int size : pages) {
+        Vector2u atlas = font.getTexture(size).getSize();
+        result.atlasBytes += static_cast<size_t>(atlas.x) * atlas.y * 4;
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Фон экрана, один раз приведённый к размеру окна, с затемнением каждого
+// экрана, запечённым в свою текстуру: экран рисует фон одним проходом без
+// смешивания вместо масштабирования спрайта и полупрозрачного прямоугольника
+// поверх на каждом кадре. shade - альфа прежнего чёрного прямоугольника, 0 - без него
+class Background {
 private:
-    Music backgroundMusic;
-    Music gameMusic;
-    Music gameOverMusic;
-    Music settingsMusic;
+    std::vector<std::pair<Uint8, std::unique_ptr<RenderTexture>>> variants;
 
 public:
-    void loadMusic() {
-        if (!backgroundMusic.openFromFile("assets/sounds/background.ogg") ||
-            !gameMusic.openFromFile("assets/sounds/GameMode.ogg") ||
-            !gameOverMusic.openFromFile("assets/sounds/GameOver.ogg") ||
-            !settingsMusic.openFromFile("assets/sounds/Settings.ogg")) {
-            std::cerr << "Failed to load music files!" << std::endl;
+    // Главный поток: нужен контекст OpenGL
+    bool build(const Image& image, const std::vector<Uint8>& shades) {
+        clear();
+        Texture source;
+        if (!source.loadFromImage(image)) return false;
+        source.setSmooth(true);
+        Sprite sprite(source);
+        sprite.setScale(static_cast<float>(GLOBAL_WIDTH) / source.getSize().x, static_cast<float>(GLOBAL_HEIGHT) / source.getSize().y);
+        RectangleShape overlay(Vector2f(static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT)));
+        for (Uint8 shade : shades) {
+            auto target = std::make_unique<RenderTexture>();
+            if (!target->create(GLOBAL_WIDTH, GLOBAL_HEIGHT)) {
+                clear();
+                return false;
+            }
+            target->clear(Color::Black);
+            target->draw(sprite, BlendNone);
+            if (shade > 0) {
+                overlay.setFillColor(Color(0, 0, 0, shade));
+                target->draw(overlay);
+            }
+            target->display();
+            variants.emplace_back(shade, std::move(target));
         }
-        backgroundMusic.setLoop(true);
-        gameMusic.setLoop(true);
-        gameOverMusic.setLoop(false);
-        settingsMusic.setLoop(true);
+        return true;
     }
 
-    bool isPlaying(const std::string& type) const {
-        if (type == "menu") return backgroundMusic.getStatus() == Music::Playing;
-        if (type == "game") return gameMusic.getStatus() == Music::Playing;
-        if (type == "settings") return settingsMusic.getStatus() == Music::Playing;
-        if (type == "gameover") return gameOverMusic.getStatus() == Music::Playing;
-        return false;
+    void clear() { variants.clear(); }
+
+    void draw(RenderTarget& target, Uint8 shade) const {
+        if (variants.empty()) return;
+        const RenderTexture* texture = variants.front().second.get();
+        for (const auto& variant : variants) {
+            if (variant.first == shade) texture = variant.second.get();
+        }
+        target.draw(Sprite(texture->getTexture()), BlendNone);
     }
 
-    void play(const std::string& type) {
-        if (!settings.musicEnabled) return;
+    size_t getBytes() const { return variants.size() * GLOBAL_WIDTH * GLOBAL_HEIGHT * 4; }
+};
 
-        if ((type == "menu" && backgroundMusic.getStatus() == Music::Playing) ||
-            (type == "game" && gameMusic.getStatus() == Music::Playing) ||
-            (type == "gameover" && gameOverMusic.getStatus() == Music::Playing) ||
-            (type == "settings" && settingsMusic.getStatus() == Music::Playing)) {
-            return;
+// Звук через SFML (OpenAL); файлы - из assets.pack, если он есть
+class SfmlAudio : public AudioBackend {
+private:
+    class Clip : public AudioClip {
+    public:
+        SoundBuffer buffer;
+        size_t getSampleCount() const override { return static_cast<size_t>(buffer.getSampleCount()); }
+    };
+
+    static AudioStatus convert(SoundSource::Status status) {
+        return status == SoundSource::Playing ? AUDIO_PLAYING : status == SoundSource::Paused ? AUDIO_PAUSED : AUDIO_STOPPED;
+    }
+
+    class Voice : public AudioVoice {
+    private:
+        Sound sound;
+
+    public:
+        void play(const AudioClip& clip, float volume, float pitch, bool loop) override {
+            sound.setBuffer(static_cast<const Clip&>(clip).buffer);
+            sound.setVolume(volume);
+            sound.setPitch(pitch);
+            sound.setLoop(loop);
+            sound.play();
         }
 
-        stop();
-        if (type == "menu") {
-            backgroundMusic.play();
-        }
-        else if (type == "game") {
-            gameMusic.play();
+        void stop() override { sound.stop(); }
+        void setVolume(float volume) override { sound.setVolume(volume); }
+        AudioStatus getStatus() const override { return convert(sound.getStatus()); }
+    };
+
+    // Дорожка из кэша PCM: куски по 0.1 с отдаются прямо из отображения файла
+    // или из памяти, без декодера и копирования
+    class PcmStream : public SoundStream {
+    private:
+        PcmTrack track;
+        size_t chunk;
+        size_t position = 0;
+        std::mutex mutex;       // onGetData - поток SoundStream, onSeek - и вызывающий
+
+    protected:
+        bool onGetData(Chunk& data) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            data.samples = track.samples + position;
+            data.sampleCount = std::min(chunk, track.sampleCount - position);
+            position += data.sampleCount;
+            return position < track.sampleCount;
         }
-        else if (type == "settings") {
-            settingsMusic.play();
+
+        void onSeek(Time offset) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t frame = static_cast<size_t>(offset.asMicroseconds() * track.sampleRate / 1000000);
+            position = std::min(frame * track.channels, track.sampleCount);
         }
-        else if (type == "gameover") {
-            gameOverMusic.play();
+
+    public:
+        explicit PcmStream(PcmTrack pcm) : track(std::move(pcm)), chunk(track.sampleRate * track.channels / 10) {
+            initialize(track.channels, track.sampleRate);
         }
-    }
 
-    void stop() {
-        backgroundMusic.stop();
-        gameMusic.stop();
-        settingsMusic.stop();
-        gameOverMusic.stop();
+        ~PcmStream() override { stop(); } // поток SoundStream зовёт onGetData этого объекта
+
+        size_t getResidentBytes() const { return track.memory ? track.memory->size() * sizeof(int16_t) : 0; }
+    };
+
+    class Stream : public AudioStream {
+    public:
+        std::unique_ptr<InputStream> packed;    // ресурс пакета под Music; объявлен раньше - переживает source
+        std::unique_ptr<SoundStream> source;    // Music или PcmStream
+        size_t residentBytes = 0;               // PCM в памяти
+
+        void play() override { source->play(); }
+        void pause() override { source->pause(); }
+        void stop() override { source->stop(); }
+        void setVolume(float volume) override { source->setVolume(volume); }
+        void setLoop(bool loop) override { source->setLoop(loop); }
+        AudioStatus getStatus() const override { return convert(source->getStatus()); }
+        double getOffsetMs() const override { return source->getPlayingOffset().asMicroseconds() / 1000.0; }
+
+        // Буферы потока SoundStream - около секунды 16-битного звука
+        size_t getBufferBytes() const override {
+            return static_cast<size_t>(source->getSampleRate()) * source->getChannelCount() * 2 + residentBytes;
+        }
+    };
+
+    AssetPack& pack;
+    PcmCache* cache;
+
+    // Декодированная дорожка из кэша; исходник - из пакета или с диска
+    bool openCached(const std::string& path, PcmTrack& track) {
+        const uint8_t* bytes = nullptr;
+        uint64_t size = 0;
+        std::string contents;
+        if (!pack.view(path, bytes, size)) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open()) return false;
+            contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            bytes = reinterpret_cast<const uint8_t*>(contents.data());
+            size = contents.size();
+        }
+        return cache->get(path, bytes, static_cast<size_t>(size),
+            [](const void* source, size_t length, std::vector<int16_t>& samples, unsigned int& rate, unsigned int& channels) {
+                InputSoundFile file;
+                if (!file.openFromMemory(source, length)) return false;
+                samples.resize(static_cast<size_t>(file.getSampleCount()));
+                samples.resize(static_cast<size_t>(file.read(samples.data(), samples.size())));
+                rate = file.getSampleRate();
+                channels = file.getChannelCount();
+                return true;
+            }, track);
     }
 
-    void toggleMusic() {
-        settings.musicEnabled = !settings.musicEnabled;
-        if (settings.musicEnabled) {
-            // Если включаем, то продолжаем играть текущую фоновую музыку (или начинаем меню, если ничего не играло)
-            if (!backgroundMusic.getStatus() == Music::Playing && !gameMusic.getStatus() == Music::Playing && !settingsMusic.getStatus() == Music::Playing) {
-                play("menu");
-            }
+public:
+    // cache == nullptr - музыка декодируется на лету (Music)
+    SfmlAudio(AssetPack& pack, PcmCache* cache) : pack(pack), cache(cache) {}
+
+    std::unique_ptr<AudioClip> loadClip(const std::string& path) override {
+        std::unique_ptr<Clip> clip = std::make_unique<Clip>();
+        if (!loadResource(clip->buffer, pack, path)) return nullptr;
+        return clip;
+    }
+
+    std::unique_ptr<AudioClip> createClip(const std::string&, const int16_t* samples, size_t count,
+        unsigned int sampleRate) override {
+        std::unique_ptr<Clip> clip = std::make_unique<Clip>();
+        if (!clip->buffer.loadFromSamples(samples, count, 1, sampleRate)) return nullptr;
+        return clip;
+    }
+
+    std::unique_ptr<AudioStream> openStream(const std::string& path) override {
+        std::unique_ptr<Stream> stream = std::make_unique<Stream>();
+        PcmTrack track;
+        if (cache && openCached(path, track)) {
+            std::unique_ptr<PcmStream> pcm = std::make_unique<PcmStream>(std::move(track));
+            stream->residentBytes = pcm->getResidentBytes();
+            stream->source = std::move(pcm);
+            return stream;
         }
-        else {
-            stop();
+        std::unique_ptr<Music> music = std::make_unique<Music>();
+        stream->packed = pack.openStream(path);
+        if (!(stream->packed ? music->openFromStream(*stream->packed) : music->openFromFile(path))) {
+            std::cerr << "Failed to load music file " << path << std::endl;
+            return nullptr;
         }
+        stream->source = std::move(music);
+        return stream;
     }
-};
 
-class SoundManager {
-private:
-    static const int MAX_CHANNELS = 16;
-    sf::Sound sounds[MAX_CHANNELS];
-    sf::SoundBuffer buffers[MAX_CHANNELS];
-    bool channelInUse[MAX_CHANNELS] = { false };
-    std::string soundFile;
-    float soundVolume;
+    std::unique_ptr<AudioVoice> createVoice() override { return std::make_unique<Voice>(); }
+};
 
-    Sound ButtonClickSound;
-    Sound BonusSound;
-    Sound AntiBonusSound;
+bool isLeftRelease(const Event& event) {
+    return event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left;
+}
 
+// Виджет экрана, которому InputSnapshot раздаёт события
+class Widget {
 public:
-    SoundManager(const std::string& filename, float volume = 40.f)
-        : soundFile(filename), soundVolume(volume) {
-    }
+    virtual ~Widget() = default;
+
+    virtual bool hitTest(const Vector2f& point) const = 0;
+    virtual bool isFocusable() const { return false; }
+    virtual void setFocused(bool) {}
+    virtual void setHovered(bool) {}
+    // Пока true, мышь идёт этому виджету (он в фокусе), а не наведённому: раскрытый список
+    virtual bool capturesMouse() const { return false; }
+    // Событие, доставшееся виджету; true - поглощено
+    virtual bool onEvent(const Event&, const Vector2f&) { return false; }
+};
 
-    void toggleEffects() {
-        soundVolume = settings.soundEffectsEnabled ? 40.f : 0.f;
-        for (int i = 0; i < MAX_CHANNELS; ++i) {
-            if (channelInUse[i]) {
-                sounds[i].setVolume(soundVolume);
-            }
-        }
+// Ввод за кадр. Позиция мыши спрашивается у ОС и переводится в координаты вида
+// один раз в начале кадра, события мыши поправляют её по своим же пикселям.
+// По этой позиции один раз находится наведённый виджет текущего экрана (верхний
+// из попавших), нажатие кнопки мыши переносит на него фокус. dispatch отдаёт
+// событие мыши наведённому (или захватившему мышь), клавиши и текст - виджету
+// в фокусе; остальные виджеты события не видят. Клики кнопок главный цикл
+// проверяет через isClick - это то же наведение
+class InputSnapshot {
+private:
+    Vector2f mouse;
+    const std::vector<Widget*>* widgets = nullptr;
+    Widget* hovered = nullptr;
+    Widget* focused = nullptr;
+
+    void moveTo(const RenderWindow& window, int x, int y) {
+        mouse = window.mapPixelToCoords(Vector2i(x, y));
+        updateHover();
     }
 
-    void play(bool loop = false) {
-        int freeChannel = -1;
-        for (int i = 0; i < MAX_CHANNELS; ++i) {
-            if (!channelInUse[i] || sounds[i].getStatus() == sf::Sound::Stopped) {
-                freeChannel = i;
-                break;
+    void updateHover() {
+        Widget* top = nullptr;
+        if (widgets) {
+            for (auto it = widgets->rbegin(); it != widgets->rend() && !top; ++it) {
+                if ((*it)->hitTest(mouse)) top = *it;
             }
         }
+        if (top == hovered) return;
+        if (hovered) hovered->setHovered(false);
+        hovered = top;
+        if (hovered) hovered->setHovered(true);
+    }
 
-        if (freeChannel == -1) return;
+    Widget* mouseTarget() const { return focused && focused->capturesMouse() ? focused : hovered; }
 
-        if (buffers[freeChannel].loadFromFile(soundFile)) {
-            sounds[freeChannel].setBuffer(buffers[freeChannel]);
-            sounds[freeChannel].setVolume(soundVolume);
-            sounds[freeChannel].setLoop(loop);
-            sounds[freeChannel].play();
-            channelInUse[freeChannel] = true;
+public:
+    // Виджеты экрана снизу вверх: последний рисуется поверх и первым ловит мышь.
+    // Смена экрана снимает наведение и фокус
+    void setScreen(const std::vector<Widget*>* screen) {
+        if (screen == widgets) return;
+        setFocus(nullptr);
+        if (hovered) hovered->setHovered(false);
+        hovered = nullptr;
+        widgets = screen;
+        updateHover();
+    }
+
+    void beginFrame(const RenderWindow& window) {
+        Vector2i pixel = Mouse::getPosition(window);
+        moveTo(window, pixel.x, pixel.y);
+    }
+
+    // Событие из pollEvent - до dispatch и до главного цикла
+    void onEvent(const Event& event, const RenderWindow& window) {
+        if (event.type == Event::MouseMoved) {
+            moveTo(window, event.mouseMove.x, event.mouseMove.y);
+        }
+        else if (event.type == Event::MouseButtonPressed || event.type == Event::MouseButtonReleased) {
+            moveTo(window, event.mouseButton.x, event.mouseButton.y);
+            // Захватившему мышь фокус сбивать нельзя: клик мимо раскрытого списка - его
+            if (event.type == Event::MouseButtonPressed && !(focused && focused->capturesMouse())) {
+                setFocus(hovered && hovered->isFocusable() ? hovered : nullptr);
+            }
         }
     }
 
-    void stopAll() {
-        for (int i = 0; i < MAX_CHANNELS; ++i) {
-            sounds[i].stop();
-            channelInUse[i] = false;
+    // true - событие поглотил виджет, главному циклу его обрабатывать не нужно
+    bool dispatch(const Event& event) const {
+        switch (event.type) {
+        case Event::MouseMoved:
+        case Event::MouseButtonPressed:
+        case Event::MouseButtonReleased:
+        case Event::MouseWheelScrolled: {
+            Widget* target = mouseTarget();
+            return target && target->onEvent(event, mouse);
+        }
+        case Event::KeyPressed:
+        case Event::KeyReleased:
+        case Event::TextEntered:
+            return focused && focused->onEvent(event, mouse);
+        default:
+            return false;
         }
     }
 
-    void setVolume(float volume) {
-        soundVolume = volume;
-        for (int i = 0; i < MAX_CHANNELS; ++i) {
-            if (channelInUse[i]) {
-                sounds[i].setVolume(volume);
-            }
-        }
+    void setFocus(Widget* widget) {
+        if (widget == focused) return;
+        if (focused) focused->setFocused(false);
+        focused = widget;
+        if (focused) focused->setFocused(true);
     }
+
+    const Vector2f& getMouse() const { return mouse; }
+    bool isHovered(const Widget& widget) const { return mouseTarget() == &widget; }
+    bool isClick(const Event& event, const Widget& widget) const { return isLeftRelease(event) && isHovered(widget); }
 };
 
-class Dropdown {
+class Dropdown : public Widget {
 private:
     std::vector<std::string> options;
-    Font font;
+    const Font& font;
     unsigned int characterSize;
     Text mainButtonText;
     RectangleShape mainButtonBackground;
@@ -366,8 +667,29 @@ public:
         }
     }
 
-    bool handleEvent(const Event& event, const RenderWindow& window) {
-        Vector2f mousePos = window.mapPixelToCoords(Mouse::getPosition(window));
+    bool hitTest(const Vector2f& point) const override {
+        if (mainButtonBackground.getGlobalBounds().contains(point)) return true;
+        for (size_t i = 0; expanded && i < itemBackgrounds.size(); ++i) {
+            if (itemBackgrounds[i].getGlobalBounds().contains(point)) return true;
+        }
+        return false;
+    }
+
+    bool isFocusable() const override { return true; }
+    // Фокус ушёл (клик по другому виджету, смена экрана) - список закрывается
+    void setFocused(bool focused) override {
+        if (!focused) expanded = false;
+    }
+    void setHovered(bool hovered) override {
+        if (hovered) return;
+        hoveredItemIndex = -1;
+        mainButtonBackground.setOutlineColor(PRIMARY_COLOR);
+        mainButtonText.setFillColor(TEXT_COLOR);
+    }
+    // Раскрытый список получает и клики мимо себя, чтобы закрыться по ним
+    bool capturesMouse() const override { return expanded; }
+
+    bool onEvent(const Event& event, const Vector2f& mousePos) override {
         hoveredItemIndex = -1; // Сбрасываем при каждом событии
 
         // Обработка наведения для основной кнопки (когда список не раскрыт)
@@ -391,7 +713,7 @@ public:
         }
 
 
-        if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
+        if (isLeftRelease(event)) {
             if (mainButtonBackground.getGlobalBounds().contains(mousePos)) {
                 expanded = !expanded;
                 return true; // Событие обработано
@@ -433,7 +755,7 @@ public:
     }
 };
 
-class Button {
+class Button : public Widget {
 private:
     Text buttonText;
     RectangleShape background;
@@ -472,28 +794,23 @@ public:
     }
 
     void draw(RenderWindow& window) {
-        isMouseOver(window); // Обновляем состояние наведения
-        setHighlight(isHovered); // Применяем эффект наведения
+        setHighlight(isHovered); // Наведение - из последнего isMouseOver
         window.draw(background);
         window.draw(buttonText);
     }
 
-    bool isMouseOver(const RenderWindow& window) {
-        Vector2f mousePos = window.mapPixelToCoords(Mouse::getPosition(window));
-        isHovered = background.getGlobalBounds().contains(mousePos);
+    bool hitTest(const Vector2f& point) const override { return background.getGlobalBounds().contains(point); }
+
+    bool isMouseOver(const InputSnapshot& input) {
+        isHovered = input.isHovered(*this);
         return isHovered;
     }
 
-    bool handleClick(const RenderWindow& window, const Event& event, SoundManager& sfx) {
-        if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
-            sfx.play();
-            Vector2f mousePos = window.mapPixelToCoords(Mouse::getPosition(window));
-    
-            if (background.getGlobalBounds().contains(mousePos)) {
-                return true;
-            }
-        }
-        return false;
+    // Клик достаётся только наведённой кнопке
+    bool handleClick(const InputSnapshot& input, const Event& event, SoundManager& sfx) {
+        if (!input.isClick(event, *this)) return false;
+        sfx.play();
+        return true;
     }
 
     void setHighlight(bool highlight) {
@@ -537,7 +854,7 @@ public:
     }
 };
 
-class TextBox {
+class TextBox : public Widget {
 private:
     RectangleShape box;
     Text text;
@@ -570,14 +887,12 @@ public:
         centerTextVertically(); // Initial centering
     }
 
-    void handleEvent(const Event& event, const RenderWindow& window) {
-        if (event.type == Event::MouseButtonPressed) {
-            Vector2f mousePos = window.mapPixelToCoords(Mouse::getPosition(window));
-            FloatRect bounds = box.getGlobalBounds();
-            isActive = bounds.contains(mousePos);
-            box.setOutlineColor(isActive ? PRIMARY_COLOR : SECONDARY_COLOR);
-        }
+    bool hitTest(const Vector2f& point) const override { return box.getGlobalBounds().contains(point); }
+    bool isFocusable() const override { return true; }
+    void setFocused(bool focused) override { setActive(focused); }
 
+    // Сюда приходит только ввод поля в фокусе
+    bool onEvent(const Event& event, const Vector2f&) override {
         if (isActive && event.type == Event::TextEntered) {
             if (event.text.unicode == '\b') {
                 if (!input.empty()) {
@@ -591,7 +906,9 @@ public:
             }
             text.setString(input);
             centerTextVertically(); // Re-center after text change
+            return true;
         }
+        return false;
     }
 
     void draw(RenderWindow& window) {
@@ -618,85 +935,13 @@ public:
 
 class Snake {
 private:
-    std::deque<Vector2i> body;
-    Direction direction;
-    Vector2i food;
-    Vector2i bonus;
-    float currentSpeed = NORMAL_SPEED;
-    Vector2i antiBonus;
-    bool bonusActive = false;
-    bool antiBonusActive = false;
-    Clock bonusClock;
-    Clock antiBonusClock;
-    Clock gameClock;
-    bool gameStarted = false;
-    Font scoreFont;
-
-    void spawnFood() {
-        food = getRandomPosition();
-    }
-
-    void spawnBonus() {
-        bonus = getRandomPosition();
-        bonusActive = true;
-        bonusClock.restart();
-    }
-
-    void spawnAntiBonus() {
-        antiBonus = getRandomPosition();
-        antiBonusActive = true;
-        antiBonusClock.restart();
-    }
-
-    Vector2i getRandomPosition() {
-        Vector2i position;
-        bool validPosition;
-
-        do {
-            position = { (rand() % (GLOBAL_WIDTH / GLOBAL_GRID_SIZE)) * GLOBAL_GRID_SIZE,
-                         (rand() % (GLOBAL_HEIGHT / GLOBAL_GRID_SIZE)) * GLOBAL_GRID_SIZE };
-
-            validPosition = true;
-            for (const auto& segment : body) {
-                if (segment == position) {
-                    validPosition = false;
-                    break;
-                }
-            }
-            if (position == food || (bonusActive && position == bonus) || (antiBonusActive && position == antiBonus)) {
-                validPosition = false;
-            }
-        } while (!validPosition);
+    SnakeCore core;
+    const Font& scoreFont;
+    synth::ComboPitch combo;
 
-        return position;
-    }
-
-    bool checkCollision(const Vector2i& head) {
-        if (head.x < 0 || head.x >= GLOBAL_WIDTH || head.y < 0 || head.y >= GLOBAL_HEIGHT)
-            return true;
-
-        for (auto it = body.begin() + 1; it != body.end(); ++it) {
-            if (*it == head)
-                return true;
-        }
-        return false;
-    }
-
-    void grow(int size) {
-        for (int i = 0; i < size; ++i) {
-            body.push_back(body.back());
-        }
-    }
-
-    void shrink(int size) {
-        for (int i = 0; i < size && body.size() > 3; ++i) {
-            body.pop_back();
-        }
-    }
-
-    void drawObject(RenderWindow& window, Vector2i position, Color color) {
+    void drawObject(RenderWindow& window, Cell cell, Color color) {
         RectangleShape shape(Vector2f(static_cast<float>(GLOBAL_GRID_SIZE - 1), static_cast<float>(GLOBAL_GRID_SIZE - 1)));
-        shape.setPosition(static_cast<float>(position.x) + 0.5f, static_cast<float>(position.y) + 0.5f);
+        shape.setPosition(static_cast<float>(cell.x * GLOBAL_GRID_SIZE) + 0.5f, static_cast<float>(cell.y * GLOBAL_GRID_SIZE) + 0.5f);
         shape.setFillColor(color);
         window.draw(shape);
     }
@@ -727,10 +972,6 @@ private:
     }
 
     void drawScore(RenderWindow& window) {
-        if (!scoreFont.loadFromFile("font1.ttf")) {
-            std::cerr << "Error loading font for score!" << std::endl;
-            return;
-        }
         Text scoreText("Счет: " + std::to_string(score), scoreFont, GLOBAL_HEIGHT / 35);
         scoreText.setFillColor(LIGHT_TEXT_COLOR);
         scoreText.setPosition(GLOBAL_WIDTH * 0.01f, GLOBAL_HEIGHT * 0.01f);
@@ -740,171 +981,66 @@ private:
 public:
     bool gameOver = false;
     int score = 0;
-    float getSpeed() const { return currentSpeed; }
+    float getSpeed() const { return core.getSpeed(); }
 
-    Snake() {
-        // Инициализация направления
-        direction = RIGHT;
-
-        // Инициализация флагов бонусов
-        bonusActive = false;
-        antiBonusActive = false;
-
-        // Инициализация состояния игры
-        gameOver = false;
-        gameStarted = false;
-        score = 0;
-
-        // Инициализация скорости
-        updateSpeed();
-
-        // Инициализация часов
-        bonusClock.restart();
-        antiBonusClock.restart();
-        gameClock.restart();
-
-        // Загрузка шрифта для счета
-        if (!scoreFont.loadFromFile("font1.ttf")) {
-            std::cerr << "Error loading font for score!" << std::endl;
-        }
-
-        // Инициализация змейки
+    // Шрифт счёта - общий, загруженный при старте
+    explicit Snake(const Font& font)
+        : core(GLOBAL_WIDTH / GLOBAL_GRID_SIZE, GLOBAL_HEIGHT / GLOBAL_GRID_SIZE, static_cast<uint64_t>(std::rand())), scoreFont(font) {
         reset();
-
-        // Спавн первой еды
-        spawnFood();
     }
 
     void updateSpeed() {
-        switch (settings.difficulty) {
-        case EASY: currentSpeed = EASY_SPEED; break;
-        case NORMAL: currentSpeed = NORMAL_SPEED; break;
-        case HARD: currentSpeed = HARD_SPEED; break;
-        }
+        core.setDifficulty(settings.difficulty);
     }
 
     void reset() {
-        body.clear();
-        // Всегда добавляем минимум 3 сегмента
-        int centerX = (GLOBAL_WIDTH / 2 / GLOBAL_GRID_SIZE) * GLOBAL_GRID_SIZE;
-        int centerY = (GLOBAL_HEIGHT / 2 / GLOBAL_GRID_SIZE) * GLOBAL_GRID_SIZE;
-
-        body.push_back({ centerX, centerY });
-        body.push_back({ centerX - GLOBAL_GRID_SIZE, centerY });
-        body.push_back({ centerX - 2 * GLOBAL_GRID_SIZE, centerY });
-
-        direction = RIGHT;
-        spawnFood();
-        bonusClock.restart();
-        antiBonusClock.restart();
-        gameClock.restart();
-        bonusActive = false;
-        antiBonusActive = false;
+        core.reset();
+        combo.reset();
         gameOver = false;
         score = 0;
-        gameStarted = false;
         updateSpeed();
     }
 
     void move(SoundManager& bonusSfx, SoundManager& antiBonusSfx, SoundManager& appleSfx) {
-        if (gameOver || body.empty()) return; // Защита от пустого тела
-
-        if (!gameStarted) {
-            gameStarted = true;
-            gameClock.restart();
-        }
-
-        Vector2i head = body.front();
-        switch (direction) {
-        case UP:head.y -= GLOBAL_GRID_SIZE; break;
-        case DOWN:head.y += GLOBAL_GRID_SIZE; break;
-        case LEFT:head.x -= GLOBAL_GRID_SIZE; break;
-        case RIGHT: head.x += GLOBAL_GRID_SIZE; break;
-        }
-
-        if (checkCollision(head)) {
-            gameOver = true;
-            return;
-        }
-
-        body.push_front(head);
-
-        if (head == food) {
-            spawnFood();
-            score += 1;
-            appleSfx.play();
-        }
-        else if (bonusActive && head == bonus) {
-            grow(BONUS_GROW);
-            bonusActive = false;
-            bonusClock.restart();
-            score += 3;
-            bonusSfx.play();
-        }
-        else if (antiBonusActive && head == antiBonus) {
-            shrink(ANTIBONUS_SHRINK);
-            antiBonusActive = false;
-            antiBonusClock.restart();
-            score = std::max(0, score - 3);
-            antiBonusSfx.play();
-        }
-        else {
-            body.pop_back();
-        }
-
-        float elapsedTime = gameClock.getElapsedTime().asSeconds();
-        if (elapsedTime > BONUS_DELAY) {
-            if (!bonusActive && bonusClock.getElapsedTime().asSeconds() > BONUS_INTERVAL) {
-                spawnBonus();
-            }
-            if (!antiBonusActive && antiBonusClock.getElapsedTime().asSeconds() > ANTI_BONUS_INTERVAL) {
-                spawnAntiBonus();
-            }
+        switch (core.move()) {
+        case STEP_FOOD: appleSfx.play(false, combo.hit()); break;
+        case STEP_BONUS: bonusSfx.play(); break;
+        case STEP_ANTIBONUS: antiBonusSfx.play(); break;
+        default: break;
         }
+        gameOver = core.gameOver;
+        score = core.score;
     }
 
     void changeDirection(Direction newDirection) {
-        if (body.empty()) return; // Защита от пустого тела
-
-        if ((direction == UP && newDirection != DOWN) ||
-            (direction == DOWN && newDirection != UP) ||
-            (direction == LEFT && newDirection != RIGHT) ||
-            (direction == RIGHT && newDirection != LEFT)) {
-            direction = newDirection;
-        }
+        core.changeDirection(newDirection);
     }
 
-    void draw(RenderWindow& window, const Sprite& background) {
-        window.draw(background);
+    void draw(RenderWindow& window, const Background& background) {
+        background.draw(window, 0);
         drawGrid(window);
 
-        // Проверяем, что тело не пустое
-        if (body.empty()) return;
-
-        for (auto& segment : body) {
-            RectangleShape rect(Vector2f(static_cast<float>(GLOBAL_GRID_SIZE - 1),
-                static_cast<float>(GLOBAL_GRID_SIZE - 1)));
-            rect.setPosition(static_cast<float>(segment.x) + 0.5f,
-                static_cast<float>(segment.y) + 0.5f);
-            rect.setFillColor(SNAKE_COLOR);
+        RectangleShape rect(Vector2f(static_cast<float>(GLOBAL_GRID_SIZE - 1),
+            static_cast<float>(GLOBAL_GRID_SIZE - 1)));
+        rect.setFillColor(SNAKE_COLOR);
+        for (int i = 0; i < core.getLength(); ++i) {
+            Cell segment = core.getSegment(i);
+            rect.setPosition(static_cast<float>(segment.x * GLOBAL_GRID_SIZE) + 0.5f,
+                static_cast<float>(segment.y * GLOBAL_GRID_SIZE) + 0.5f);
             window.draw(rect);
         }
 
-        drawObject(window, food, FOOD_COLOR);
-        if (bonusActive) drawObject(window, bonus, BONUS_COLOR);
-        if (antiBonusActive) drawObject(window, antiBonus, ANTIBONUS_COLOR);
+        drawObject(window, core.getFood(), FOOD_COLOR);
+        if (core.hasBonus()) drawObject(window, core.getBonus(), BONUS_COLOR);
+        if (core.hasAntiBonus()) drawObject(window, core.getAntiBonus(), ANTIBONUS_COLOR);
 
         drawScore(window);
     }
 
-    void drawGameOver(RenderWindow& window, Font& font, const Sprite& background,
-        Button& restartButton, Button& menuButton) {
+    void drawGameOver(RenderWindow& window, const InputSnapshot& input, Font& font, const Background& background,
+        Button& restartButton, Button& menuButton, const std::string& rankLine) {
         window.clear();
-        window.draw(background);
-
-        RectangleShape overlay(Vector2f(static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT)));
-        overlay.setFillColor(Color(0, 0, 0, 150));
-        window.draw(overlay);
+        background.draw(window, 150);
 
         Text text("Игра Окончена", font, GLOBAL_HEIGHT / 10);
         text.setFillColor(ACCENT_COLOR);
@@ -920,8 +1056,16 @@ public:
         finalScoreText.setFillColor(PRIMARY_COLOR);
         window.draw(finalScoreText);
 
-        restartButton.isMouseOver(window);
-        menuButton.isMouseOver(window);
+        // Место в таблице своей сложности
+        Text rankText(rankLine, font, GLOBAL_HEIGHT / 30);
+        FloatRect rankRect = rankText.getLocalBounds();
+        rankText.setOrigin(rankRect.left + rankRect.width / 2.0f, rankRect.top + rankRect.height / 2.0f);
+        rankText.setPosition(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.52f);
+        rankText.setFillColor(LIGHT_TEXT_COLOR);
+        window.draw(rankText);
+
+        restartButton.isMouseOver(input);
+        menuButton.isMouseOver(input);
 
         restartButton.draw(window);
         menuButton.draw(window);
@@ -929,58 +1073,202 @@ public:
 
 };
 
-struct ScoreEntry {
-    std::string name;
-    int score;
-};
-
-class Leaderboard {
+// Режим арены: игрок (змейка 0) против ботов на общем поле
+class ArenaMode {
 private:
-    std::vector<ScoreEntry> scores;
-    Font font;
+    static const int BOT_COUNT = 24;
+    // Большой мир: поле 10000x10000 клеток, хранится чанками, рисуется только видимое
+    static const int HUGE_SIDE = 10000;
+    static const int HUGE_BOT_COUNT = 4000;
+    static const int HUGE_SPAWN_RADIUS = 40;
+    Arena arena;
+    std::unique_ptr<LockstepSession> network; // сетевая арена: состояние ведёт сессия
+    bool huge = false;
+    View camera;
+    VertexArray quads;
+    synth::ComboPitch combo;
+
+    void addCell(int x, int y, Color color) {
+        float size = static_cast<float>(GLOBAL_GRID_SIZE - 1);
+        float px = static_cast<float>(x * GLOBAL_GRID_SIZE) + 0.5f;
+        float py = static_cast<float>(y * GLOBAL_GRID_SIZE) + 0.5f;
+        quads.append(Vertex(Vector2f(px, py), color));
+        quads.append(Vertex(Vector2f(px + size, py), color));
+        quads.append(Vertex(Vector2f(px + size, py + size), color));
+        quads.append(Vertex(Vector2f(px, py + size), color));
+    }
+
+    static Arena makeArena(bool huge) {
+        if (huge) {
+            return Arena(HUGE_SIDE, HUGE_SIDE, HUGE_BOT_COUNT + 1, static_cast<uint64_t>(std::rand()),
+                GameRules(), HUGE_SPAWN_RADIUS);
+        }
+        return Arena(GLOBAL_WIDTH / GLOBAL_GRID_SIZE, GLOBAL_HEIGHT / GLOBAL_GRID_SIZE, BOT_COUNT + 1,
+            static_cast<uint64_t>(std::rand()));
+    }
 
-    void loadScores() {
-        std::ifstream file("scores.txt");
-        if (file.is_open()) {
-            scores.clear();
-            std::string name;
-            int score;
-            while (file >> name >> score) {
-                scores.push_back({ name, score });
-            }
-            file.close();
+    const Arena& current() const { return network ? network->getArena() : arena; }
+    int localId() const { return network ? network->getConfig().localPlayer : 0; }
+
+public:
+    ArenaMode()
+        : arena(makeArena(false)),
+        camera(FloatRect(0.f, 0.f, static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT))),
+        quads(Quads) {
+        arena.setBot(0, false);
+    }
+
+    float getSpeed() const { return current().getSpeed(); }
+
+    // Все узлы должны запускаться с одинаковыми размерами поля и сидом
+    bool startNetwork(const LockstepConfig& config) {
+        network = std::make_unique<LockstepSession>(config);
+        if (network->start()) return true;
+        network.reset();
+        return false;
+    }
+
+    void reset(bool hugeWorld) {
+        // Сетевую арену нельзя перезапустить в одиночку - остальные узлы разойдутся
+        if (network) return;
+        huge = hugeWorld;
+        combo.reset();
+        arena = makeArena(huge);
+        arena.setBot(0, false);
+        arena.setDifficulty(settings.difficulty);
+    }
+
+    void changeDirection(Direction direction) {
+        if (network) network->setInput(direction);
+        else arena.changeDirection(0, direction);
+    }
+
+    // Обмен пакетами, каждый кадр
+    void poll() {
+        if (network) network->poll();
+    }
+
+    // false - тик не сделан (ждём ввод других игроков)
+    bool update(SoundManager& appleSfx) {
+        int scoreBefore = current().getSnake(localId()).score;
+        if (network) {
+            if (!network->advance()) return false;
         }
+        else {
+            arena.step();
+            // Игрок возрождается сразу, счёт обнуляется
+            if (!arena.getSnake(0).alive) arena.spawnSnake(0);
+        }
+        if (current().getSnake(localId()).score > scoreBefore) appleSfx.play(false, combo.hit());
+        return true;
     }
 
-    void saveScores() {
-        std::ofstream file("scores.txt");
-        if (file.is_open()) {
-            for (const auto& entry : scores) {
-                file << entry.name << " " << entry.score << "\n";
+    void draw(RenderWindow& window, Font& font, const Background& background) {
+        window.setView(window.getDefaultView());
+        background.draw(window, 0);
+
+        // Камера следует за головой игрока; на обычной арене поле целиком помещается в окно
+        const Arena& world = current();
+        const int self = localId();
+        int x0 = 0, y0 = 0;
+        int x1 = world.getCols(), y1 = world.getRows();
+        if (network) {
+            // Поле сетевой игры одинаково у всех узлов и растягивается на окно
+            camera.reset(FloatRect(0.f, 0.f, static_cast<float>(x1 * GLOBAL_GRID_SIZE), static_cast<float>(y1 * GLOBAL_GRID_SIZE)));
+        }
+        else if (huge && world.getSnake(0).alive) {
+            int32_t head = world.getSnake(0).body.front();
+            float cx = (Arena::cellX(head) + 0.5f) * GLOBAL_GRID_SIZE;
+            float cy = (Arena::cellY(head) + 0.5f) * GLOBAL_GRID_SIZE;
+            camera.setCenter(cx, cy);
+            x0 = static_cast<int>((cx - GLOBAL_WIDTH / 2.f) / GLOBAL_GRID_SIZE) - 1;
+            y0 = static_cast<int>((cy - GLOBAL_HEIGHT / 2.f) / GLOBAL_GRID_SIZE) - 1;
+            x1 = x0 + GLOBAL_WIDTH / GLOBAL_GRID_SIZE + 3;
+            y1 = y0 + GLOBAL_HEIGHT / GLOBAL_GRID_SIZE + 3;
+        }
+        else if (!huge) {
+            camera.setCenter(GLOBAL_WIDTH / 2.f, GLOBAL_HEIGHT / 2.f);
+        }
+
+        // Обходятся только выделенные чанки в пределах экрана, всё одним вызовом отрисовки
+        quads.clear();
+        typedef ChunkedGrid<Arena::CellState> Grid;
+        world.getGrid().forEachChunk(x0, y0, x1, y1, [&](int originX, int originY, const Grid::Chunk& chunk) {
+            for (int i = 0; i < Grid::CHUNK_CELLS; ++i) {
+                const Arena::CellState& state = chunk.cells[i];
+                if (!state.occupancy && !state.item) continue;
+                int x = originX + (i & Grid::CHUNK_MASK);
+                int y = originY + (i >> Grid::CHUNK_SHIFT);
+                if (state.occupancy) addCell(x, y, BOT_COLOR);
+                else if (state.item == Arena::ITEM_FOOD) addCell(x, y, FOOD_COLOR);
+                else if (state.item == Arena::ITEM_BONUS) addCell(x, y, BONUS_COLOR);
+                else addCell(x, y, ANTIBONUS_COLOR);
             }
-            file.close();
+            });
+        // Клетка не хранит владельца: своя змейка перекрашивается поверх по своему телу
+        for (int32_t cell : world.getSnake(self).body) {
+            int x = Arena::cellX(cell), y = Arena::cellY(cell);
+            if (x >= x0 && x < x1 && y >= y0 && y < y1) addCell(x, y, SNAKE_COLOR);
+        }
+        window.setView(camera);
+        window.draw(quads);
+        window.setView(window.getDefaultView());
+
+        Text scoreText("Счет: " + std::to_string(world.getSnake(self).score), font, GLOBAL_HEIGHT / 35);
+        scoreText.setFillColor(LIGHT_TEXT_COLOR);
+        scoreText.setPosition(GLOBAL_WIDTH * 0.01f, GLOBAL_HEIGHT * 0.01f);
+        window.draw(scoreText);
+
+        if (network && network->isDesynced()) {
+            Text desyncText("Рассинхронизация на тике " + std::to_string(network->getDesyncTick()), font, GLOBAL_HEIGHT / 35);
+            desyncText.setFillColor(ACCENT_COLOR);
+            desyncText.setPosition(GLOBAL_WIDTH * 0.01f, GLOBAL_HEIGHT * 0.05f);
+            window.draw(desyncText);
+        }
+        if (network && network->getStats().peersDropped > 0) {
+            std::string lost = "Отключились:";
+            for (int player = 0; player < world.getSnakeCount(); ++player) {
+                if (player != self && network->isDropped(player)) lost += " игрок " + std::to_string(player + 1);
+            }
+            Text lostText(lost, font, GLOBAL_HEIGHT / 35);
+            lostText.setFillColor(ACCENT_COLOR);
+            lostText.setPosition(GLOBAL_WIDTH * 0.01f, GLOBAL_HEIGHT * 0.09f);
+            window.draw(lostText);
         }
     }
+};
+
+class Leaderboard {
+private:
+    ScoreBoard board{ "scores.bin", 10 };
+    const Font& font; // общий с остальными экранами: один кэш глифов
+    int view = ALL_DIFFICULTIES;
 
 public:
-    Leaderboard(const Font& font) : font(font) {
-        loadScores();
+    Leaderboard(const Font& font, PersistenceWorker& persistence) : font(font) {
+        // Первый запуск после перехода на двоичный формат: переносим текстовую историю
+        std::ifstream binary(board.getPath(), std::ios::binary);
+        if (!binary.is_open()) ScoreBoard::importText("scores.txt", board.getPath());
+        binary.close();
+        board.load();
+        board.setWriter(&persistence);
     }
 
-    void addScore(const std::string& name, int score) {
-        scores.push_back({ name, score });
-        std::sort(scores.begin(), scores.end(), [](const ScoreEntry& a, const ScoreEntry& b) {
-            return a.score > b.score;
-            });
-        saveScores();
+    // Дописывает результат в журнал; возвращает его место среди результатов той же сложности
+    size_t addScore(const std::string& name, int score, Difficulty difficulty) {
+        return board.add(name, score, difficulty, static_cast<int64_t>(std::time(NULL)));
     }
 
-    void draw(RenderWindow& window, const Sprite& menuBackground, Button& backButton) {
-        window.draw(menuBackground);
+    size_t getCount(Difficulty difficulty) const { return board.size(difficulty); }
 
-        RectangleShape overlay(Vector2f(static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT)));
-        overlay.setFillColor(Color(0, 0, 0, 180));
-        window.draw(overlay);
+    // Вид таблицы по кругу: все сложности, затем каждая по отдельности
+    void nextView() { view = view + 1 < DIFFICULTY_COUNT ? view + 1 : ALL_DIFFICULTIES; }
+
+    std::string getViewName() const { return view == ALL_DIFFICULTIES ? "Все уровни" : DIFFICULTY_OPTIONS[view]; }
+
+    void draw(RenderWindow& window, const InputSnapshot& input, const Background& menuBackground, Button& backButton, Button& viewButton,
+        const std::string& currentUser) {
+        menuBackground.draw(window, 180);
 
         Text title("Таблица лидеров", font, GLOBAL_HEIGHT / 10);
         title.setFillColor(PRIMARY_COLOR);
@@ -991,7 +1279,11 @@ public:
         title.setPosition(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.15f);
         window.draw(title);
 
-        for (size_t i = 0; i < std::min(scores.size(), static_cast<size_t>(10)); ++i) {
+        viewButton.isMouseOver(input);
+        viewButton.draw(window);
+
+        const std::vector<ScoreEntry>& scores = board.top(view);
+        for (size_t i = 0; i < scores.size(); ++i) {
             Color textColor = (i < 3) ? PRIMARY_COLOR : TEXT_COLOR;
             unsigned int textSize = (i < 3) ? (GLOBAL_HEIGHT / 25) : (GLOBAL_HEIGHT / 30);
             float yPos = static_cast<float>(GLOBAL_HEIGHT) * 0.3f + i * (static_cast<float>(GLOBAL_HEIGHT) / 18);
@@ -1017,20 +1309,51 @@ public:
             window.draw(scoreText);
         }
 
-        backButton.isMouseOver(window);
+        ScoreEntry best;
+        std::string bestLine = board.personalBest(currentUser, view, best) ? "Ваш рекорд: " + std::to_string(best.score) +
+            ", место " + std::to_string(board.rankOf(best.score, view)) : "Ваш рекорд: нет";
+        Text bestText(bestLine, font, GLOBAL_HEIGHT / 30);
+        bestText.setFillColor(LIGHT_TEXT_COLOR);
+        FloatRect bestRect = bestText.getLocalBounds();
+        bestText.setOrigin(bestRect.left + bestRect.width / 2.0f, bestRect.top);
+        bestText.setPosition(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.83f);
+        window.draw(bestText);
+
+        backButton.isMouseOver(input);
         backButton.draw(window);
     }
 };
 
-void drawLoginScreen(RenderWindow& window, Font& font, const Sprite& background,
+// Полоса загрузки; подпись появляется, как только загружен шрифт
+void drawLoadingScreen(RenderWindow& window, const Font* font, float progress) {
+    window.clear(BACKGROUND_COLOR);
+
+    Vector2f barSize(static_cast<float>(GLOBAL_WIDTH) * 0.4f, static_cast<float>(GLOBAL_HEIGHT) * 0.02f);
+    Vector2f barPosition((static_cast<float>(GLOBAL_WIDTH) - barSize.x) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.55f);
+    RectangleShape track(barSize);
+    track.setPosition(barPosition);
+    track.setFillColor(SECONDARY_COLOR);
+    window.draw(track);
+    RectangleShape bar(Vector2f(barSize.x * progress, barSize.y));
+    bar.setPosition(barPosition);
+    bar.setFillColor(PRIMARY_COLOR);
+    window.draw(bar);
+
+    if (font) {
+        Text label("Загрузка... " + std::to_string(static_cast<int>(progress * 100)) + "%", *font, GLOBAL_HEIGHT / 30);
+        label.setFillColor(TEXT_COLOR);
+        FloatRect labelRect = label.getLocalBounds();
+        label.setOrigin(labelRect.left + labelRect.width / 2.0f, labelRect.top + labelRect.height / 2.0f);
+        label.setPosition(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.48f);
+        window.draw(label);
+    }
+}
+
+void drawLoginScreen(RenderWindow& window, const InputSnapshot& input, Font& font, const Background& background,
     UserManager& userManager, TextBox& usernameBox, TextBox& passwordBox,
     Text& errorText, Button& loginButton, Button& registerButton) {
     window.clear();
-    window.draw(background);
-
-    RectangleShape overlay(Vector2f(static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT)));
-    overlay.setFillColor(Color(0, 0, 0, 150));
-    window.draw(overlay);
+    background.draw(window, 150);
 
     Text title("ЗМЕЙКА", font, GLOBAL_HEIGHT / 10);
     title.setFillColor(PRIMARY_COLOR);
@@ -1062,21 +1385,17 @@ void drawLoginScreen(RenderWindow& window, Font& font, const Sprite& background,
     window.draw(errorText);
 
     // Buttons
-    loginButton.isMouseOver(window);
-    registerButton.isMouseOver(window);
+    loginButton.isMouseOver(input);
+    registerButton.isMouseOver(input);
     loginButton.draw(window);
     registerButton.draw(window);
 }
 
-void drawRegisterScreen(RenderWindow& window, Font& font, const Sprite& background,
+void drawRegisterScreen(RenderWindow& window, const InputSnapshot& input, Font& font, const Background& background,
     UserManager& userManager, TextBox& usernameBox, TextBox& passwordBox,
     TextBox& confirmBox, Text& errorText, Button& registerButton, Button& backButton) {
     window.clear();
-    window.draw(background);
-
-    RectangleShape overlay(Vector2f(static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT)));
-    overlay.setFillColor(Color(0, 0, 0, 150));
-    window.draw(overlay);
+    background.draw(window, 150);
 
     Text title("Регистрация", font, GLOBAL_HEIGHT / 10);
     title.setFillColor(PRIMARY_COLOR);
@@ -1117,21 +1436,17 @@ void drawRegisterScreen(RenderWindow& window, Font& font, const Sprite& backgrou
     window.draw(errorText);
 
     // Buttons
-    registerButton.isMouseOver(window);
-    backButton.isMouseOver(window);
+    registerButton.isMouseOver(input);
+    backButton.isMouseOver(input);
     registerButton.draw(window);
     backButton.draw(window);
 }
 
-void drawMainMenu(RenderWindow& window, Font& font, const Sprite& background,
-    UserManager& userManager, Button& playButton, Button& settingsButton,
+void drawMainMenu(RenderWindow& window, const InputSnapshot& input, Font& font, const Background& background,
+    UserManager& userManager, Button& playButton, Button& arenaButton, Button& hugeArenaButton, Button& settingsButton,
     Button& leaderboardButton, Button& exitToDesktopButton) {
     window.clear();
-    window.draw(background);
-
-    RectangleShape overlay(Vector2f(static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT)));
-    overlay.setFillColor(Color(0, 0, 0, 100));
-    window.draw(overlay);
+    background.draw(window, 100);
 
     Text title("ЗМЕЙКА", font, GLOBAL_HEIGHT / 10);
     title.setFillColor(PRIMARY_COLOR);
@@ -1148,28 +1463,28 @@ void drawMainMenu(RenderWindow& window, Font& font, const Sprite& background,
     window.draw(welcomeText);
 
     // Buttons
-    playButton.isMouseOver(window);
-    settingsButton.isMouseOver(window);
-    leaderboardButton.isMouseOver(window);
-    exitToDesktopButton.isMouseOver(window);
+    playButton.isMouseOver(input);
+    arenaButton.isMouseOver(input);
+    hugeArenaButton.isMouseOver(input);
+    settingsButton.isMouseOver(input);
+    leaderboardButton.isMouseOver(input);
+    exitToDesktopButton.isMouseOver(input);
 
     playButton.draw(window);
+    arenaButton.draw(window);
+    hugeArenaButton.draw(window);
     settingsButton.draw(window);
     leaderboardButton.draw(window);
     exitToDesktopButton.draw(window);
 }
 
 // Изменена сигнатура функции
-void drawSettingsScreen(RenderWindow& window, Font& font, const Sprite& background,
+void drawSettingsScreen(RenderWindow& window, const InputSnapshot& input, Font& font, const Background& background,
     Dropdown& difficultyDropdown, Button& toggleMusicButton, Button& toggleEffectsButton,
     Button& saveButton, Button& backButton, bool fromPauseMenu) {
 
     window.clear();
-    window.draw(background);
-
-    RectangleShape overlay(Vector2f(static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT)));
-    overlay.setFillColor(Color(0, 0, 0, 150));
-    window.draw(overlay);
+    background.draw(window, 150);
 
     Text title("НАСТРОЙКИ", font, GLOBAL_HEIGHT / 10);
     title.setFillColor(PRIMARY_COLOR);
@@ -1199,7 +1514,7 @@ void drawSettingsScreen(RenderWindow& window, Font& font, const Sprite& backgrou
         font, buttonFontSize,
         Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, startY),
         SECONDARY_COLOR);
-    toggleMusicButton.isMouseOver(window);
+    toggleMusicButton.isMouseOver(input);
     toggleMusicButton.draw(window);
 
     // Sound Effects Button
@@ -1207,14 +1522,14 @@ void drawSettingsScreen(RenderWindow& window, Font& font, const Sprite& backgrou
         font, buttonFontSize,
         Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, startY + verticalSpacing),
         SECONDARY_COLOR);
-    toggleEffectsButton.isMouseOver(window);
+    toggleEffectsButton.isMouseOver(input);
     toggleEffectsButton.draw(window);
 
     // Save Button
     saveButton = Button("Сохранить настройки", font, buttonFontSize,
         Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, startY + verticalSpacing * 2),
         PRIMARY_COLOR);
-    saveButton.isMouseOver(window);
+    saveButton.isMouseOver(input);
     saveButton.draw(window);
 
     // Back Button
@@ -1222,21 +1537,17 @@ void drawSettingsScreen(RenderWindow& window, Font& font, const Sprite& backgrou
         font, buttonFontSize,
         Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, startY + verticalSpacing * 3),
         SECONDARY_COLOR);
-    backButton.isMouseOver(window);
+    backButton.isMouseOver(input);
     backButton.draw(window);
 
     // Отрисовка раскрытого списка поверх всего
     difficultyDropdown.drawExpanded(window);
 }
 
-void drawPauseScreen(RenderWindow& window, Font& font, const Sprite& background,
+void drawPauseScreen(RenderWindow& window, const InputSnapshot& input, Font& font, const Background& background,
     Button& resumeButton, Button& settingsPauseButton, Button& menuButton) {
     window.clear();
-    window.draw(background);
-
-    RectangleShape overlay(Vector2f(static_cast<float>(GLOBAL_WIDTH), static_cast<float>(GLOBAL_HEIGHT)));
-    overlay.setFillColor(Color(0, 0, 0, 150));
-    window.draw(overlay);
+    background.draw(window, 150);
 
     Text pausedText("ПАУЗА", font, GLOBAL_HEIGHT / 10);
     pausedText.setFillColor(PRIMARY_COLOR);
@@ -1245,22 +1556,29 @@ void drawPauseScreen(RenderWindow& window, Font& font, const Sprite& background,
     pausedText.setPosition(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.25f);
     window.draw(pausedText);
 
-    resumeButton.isMouseOver(window);
-    settingsPauseButton.isMouseOver(window);
-    menuButton.isMouseOver(window);
+    resumeButton.isMouseOver(input);
+    settingsPauseButton.isMouseOver(input);
+    menuButton.isMouseOver(input);
 
     resumeButton.draw(window);
     settingsPauseButton.draw(window); // Теперь эта кнопка будет между resume и menu
     menuButton.draw(window);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "Rus");
-    SoundManager clickSfx("assets/sounds/buttonClick.wav", 70.f);
-    SoundManager appleSfx("assets/sounds/appleSound.wav", 70.f);
-    SoundManager bonusSfx("assets/sounds/bonus.wav", 70.f);
-    SoundManager antiBonusSfx("assets/sounds/antiBonus.wav", 100.f);
+    // Запись файлов в фоне; объявлен первым, чтобы разрушиться последним
+    PersistenceWorker persistence;
     settings.loadFromFile();
+    // Пакет и звук - раньше всего, что из них читает и играет
+    AssetPack pack;
+    std::unique_ptr<PcmCache> pcmCache;
+    if (settings.pcmCache) pcmCache = std::make_unique<PcmCache>("pcmcache");
+    SfmlAudio audio(pack, pcmCache.get());
+    SoundManager clickSfx(audio, 70.f);
+    SoundManager appleSfx(audio, 70.f);
+    SoundManager bonusSfx(audio, 70.f);
+    SoundManager antiBonusSfx(audio, 100.f);
     std::srand(static_cast<unsigned int>(std::time(NULL)));
 
     VideoMode desktopMode = VideoMode::getDesktopMode();
@@ -1271,43 +1589,151 @@ int main() {
     RenderWindow window(VideoMode(GLOBAL_WIDTH, GLOBAL_HEIGHT), L"Игра Змейка", Style::Fullscreen);
     window.setFramerateLimit(60);
 
+    // Ресурсы по экранам: набор состояния грузится при первом входе в него, наборы
+    // вероятных следующих состояний - заранее в фоне, сверх бюджета памяти
+    // вытесняются давно не нужные. Файлы читаются на пуле потоков, текстуры
+    // выгружаются в видеопамять на главном. Пакет объявлен раньше ресурсов:
+    // шрифт и музыка читают его потоки, пока живы
+    Clock startupClock;
+    if (pack.open("assets.pack")) std::cout << "Using assets.pack (" << pack.size() << " assets)" << std::endl;
+    std::unique_ptr<InputStream> fontStream; // Font читает глифы из пакета по ходу; объявлен раньше - переживает font
     Font font;
-    if (!font.loadFromFile("font1.ttf")) {
-        std::cerr << "Error loading font! Make sure 'font1.ttf' is in the correct directory." << std::endl;
-        return -1;
+    Image menuImage, gameImage;
+    Background menuBackground, gameBackground;
+    MusicManager musicManager(audio);
+    if (!settings.musicEnabled) musicManager.setEnabled(false);
+    musicManager.setCrossfade(settings.crossfadeMs);
+    AssetLoader assets;
+    assets.setBudget(static_cast<size_t>(settings.assetBudgetMb) << 20);
+    auto addBackground = [&](const std::string& path, Image& image, Background& background, std::vector<Uint8> shades) {
+        return assets.add(path.substr(path.find_last_of('/') + 1),
+            [&image, &pack, path] { return loadResource(image, pack, path); },
+            [&image, &background, shades] {
+                bool ok = background.build(image, shades);
+                image = Image();
+                return ok;
+            },
+            [&background] { background.clear(); },
+            [&background] { return background.getBytes(); });
+    };
+    auto addTrack = [&](MusicTrack type) {
+        auto opened = std::make_shared<std::unique_ptr<AudioStream>>();
+        return assets.add(std::string("music: ") + MUSIC_TRACKS[type].name,
+            [opened, &musicManager, type] {
+                *opened = musicManager.openTrack(type);
+                return *opened != nullptr;
+            },
+            [opened, &musicManager, type] {
+                musicManager.install(type, std::move(*opened));
+                return true;
+            },
+            [&musicManager, type] { musicManager.close(type); },
+            [&musicManager, type] { return musicManager.getTrackBytes(type); }, false);
+    };
+    // Звуки синтезируются на рабочем потоке (SfxSynth.h), файлов не читают
+    auto addSound = [&](const std::string& name, const synth::Patch& patch, SoundManager& sfx) {
+        auto loaded = std::make_shared<std::unique_ptr<AudioClip>>();
+        return assets.add("synth: " + name,
+            [loaded, &audio, name, patch] {
+                std::vector<int16_t> samples(synth::sampleCount(patch));
+                synth::render(patch, 1.0f, synth::SAMPLE_RATE, 0, samples.data(), samples.size());
+                *loaded = audio.createClip(name, samples.data(), samples.size(), synth::SAMPLE_RATE);
+                return *loaded != nullptr;
+            },
+            [loaded, &sfx] {
+                sfx.setClip(std::move(*loaded));
+                return true;
+            },
+            nullptr, [&sfx] { return sfx.getClipBytes(); }, false);
+    };
+    // Файл шрифта читается на рабочем потоке, глифы греются в finish на главном
+    GlyphWarmup glyphWarmup;
+    size_t fontAsset = assets.add("font1.ttf", [&] { return loadResource(font, pack, "font1.ttf", &fontStream); },
+        [&] {
+            glyphWarmup = warmGlyphs(font, uiGlyphSizes());
+            return true;
+        });
+    size_t menuImageAsset = addBackground("assets/images/main_menu_background.png", menuImage, menuBackground, { 100, 150, 180 });
+    size_t gameImageAsset = addBackground("assets/images/game_background.png", gameImage, gameBackground, { 0, 150 });
+    size_t menuTrack = addTrack(MUSIC_MENU);
+    size_t gameTrack = addTrack(MUSIC_GAME);
+    size_t gameOverTrack = addTrack(MUSIC_GAMEOVER);
+    size_t settingsTrack = addTrack(MUSIC_SETTINGS);
+    size_t clickSound = addSound("click", synth::CLICK, clickSfx);
+    std::vector<size_t> gameSounds = {
+        addSound("apple", synth::APPLE, appleSfx),
+        addSound("bonus", synth::BONUS, bonusSfx),
+        addSound("antibonus", synth::ANTIBONUS, antiBonusSfx)
+    };
+    // Шрифт и щелчок кнопки нужны везде и не вытесняются (без unload)
+    auto screenSet = [&](std::vector<size_t> extra) {
+        extra.push_back(fontAsset);
+        extra.push_back(clickSound);
+        return extra;
+    };
+    std::vector<size_t> playSet = screenSet({ gameImageAsset, gameTrack });
+    playSet.insert(playSet.end(), gameSounds.begin(), gameSounds.end());
+    for (int state : { LOGIN, REGISTER, MENU }) assets.declare(state, screenSet({ menuImageAsset, menuTrack }));
+    for (int state : { SETTINGS, LEADERBOARD }) assets.declare(state, screenSet({ menuImageAsset, settingsTrack }));
+    for (int state : { PLAYING, PAUSED, ARENA }) assets.declare(state, playSet);
+    assets.declare(GAME_OVER, screenSet({ gameImageAsset, gameOverTrack }));
+    assets.prefetchAfter(MENU, { PLAYING, SETTINGS });
+    assets.prefetchAfter(PLAYING, { GAME_OVER });
+    assets.prefetchAfter(PAUSED, { SETTINGS });
+    assets.prefetchAfter(GAME_OVER, { PLAYING, MENU });
+    assets.prefetchAfter(SETTINGS, { MENU });
+    assets.prefetchAfter(LEADERBOARD, { MENU });
+    assets.prefetchAfter(ARENA, { MENU });
+    // Те же переходы для музыки: дорожки загружены заранее, остаётся их зарядить
+    musicManager.setNext(MUSIC_MENU, { MUSIC_GAME, MUSIC_SETTINGS });
+    musicManager.setNext(MUSIC_GAME, { MUSIC_GAMEOVER });
+    musicManager.setNext(MUSIC_GAMEOVER, { MUSIC_GAME, MUSIC_MENU });
+    musicManager.setNext(MUSIC_SETTINGS, { MUSIC_MENU });
+
+    // До первого кадра ждём только набор экрана входа
+    assets.enter(LOGIN);
+    while (!assets.isStateReady(LOGIN)) {
+        Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == Event::Closed) window.close();
+        }
+        if (!window.isOpen()) return 0;
+        assets.update();
+        drawLoadingScreen(window, assets.isReady(fontAsset) ? &font : nullptr, assets.getStateProgress(LOGIN));
+        window.display();
     }
-
-    Texture menuTexture;
-    if (!menuTexture.loadFromFile("assets/images/main_menu_background.png")) {
-        std::cerr << "Error loading menu background image! Make sure 'main_menu_background.png' is in 'assets/images/'." << std::endl;
+    if (!assets.getFailure().empty()) {
+        std::cerr << "Error loading " << assets.getFailure() << "! Make sure 'font1.ttf' and 'assets/' are next to the game." << std::endl;
         return -1;
     }
-    Sprite menuBackground(menuTexture);
-    menuBackground.setScale(
-        static_cast<float>(GLOBAL_WIDTH) / menuTexture.getSize().x,
-        static_cast<float>(GLOBAL_HEIGHT) / menuTexture.getSize().y
-    );
-
-    Texture gameTexture;
-    if (!gameTexture.loadFromFile("assets/images/game_background.png")) {
-        std::cerr << "Error loading game background image! Make sure 'game_background.png' is in 'assets/images/'." << std::endl;
-        return -1;
+    std::cout << "First frame after " << startupClock.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+    assets.printReport(std::cout);
+    std::cout << "Glyphs: " << glyphWarmup.glyphs << " pre-rasterized in " << glyphWarmup.ms << " ms, atlas "
+        << glyphWarmup.atlasBytes / 1024 << " KB" << std::endl;
+
+    UserManager userManager(persistence);
+    userManager.setIterations(settings.passwordIterations);
+    musicManager.play(MUSIC_MENU);
+
+    Snake snake(font);
+    ArenaMode arenaMode;
+    // Сетевая арена для нескольких окон на одной машине:
+    // Game.exe --lockstep <номер игрока> <число игроков> [адрес] [порт]
+    if (argc >= 4 && std::string(argv[1]) == "--lockstep") {
+        LockstepConfig lockstepConfig;
+        lockstepConfig.localPlayer = std::atoi(argv[2]);
+        lockstepConfig.players = std::min(LockstepSession::MAX_PLAYERS, std::max(2, std::atoi(argv[3])));
+        if (argc >= 5) lockstepConfig.host = IpAddress(argv[4]);
+        if (argc >= 6) lockstepConfig.basePort = static_cast<unsigned short>(std::atoi(argv[5]));
+        if (lockstepConfig.localPlayer < 0 || lockstepConfig.localPlayer >= lockstepConfig.players ||
+            !arenaMode.startNetwork(lockstepConfig)) {
+            std::cerr << "Error starting network arena! Check the player number and that the UDP port is free." << std::endl;
+        }
     }
-    Sprite gameBackground(gameTexture);
-    gameBackground.setScale(
-        static_cast<float>(GLOBAL_WIDTH) / gameTexture.getSize().x,
-        static_cast<float>(GLOBAL_HEIGHT) / gameTexture.getSize().y
-    );
-
-    UserManager userManager;
-    MusicManager musicManager;
-    musicManager.loadMusic();
-    musicManager.play("menu");
-
-    Snake snake;
-    Leaderboard leaderboard(font);
+    Leaderboard leaderboard(font, persistence);
 
     GameState currentGameState = LOGIN;
+    GameState residentState = LOGIN; // состояние, чей набор ресурсов запрошен
     GameState previousGameState = MENU; // Добавлена переменная для отслеживания предыдущего состояния
 
     unsigned int titleFontSize = GLOBAL_HEIGHT / 10;
@@ -1336,10 +1762,12 @@ int main() {
     Button backToLoginButton("Вернуться в авторизацию", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.87f), SECONDARY_COLOR);
 
     // Main Menu UI elements
-    Button playButton("Играть", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.40f), SECONDARY_COLOR);
-    Button settingsButton("Настройки", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.53f), SECONDARY_COLOR);
-    Button leaderboardButton("Таблица Лидеров", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.66f), SECONDARY_COLOR);
-    Button exitToDesktopButton("Рабочий стол", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.79f), SECONDARY_COLOR);
+    Button playButton("Играть", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.33f), SECONDARY_COLOR);
+    Button arenaButton("Арена", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.43f), SECONDARY_COLOR);
+    Button hugeArenaButton("Большой мир", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.53f), SECONDARY_COLOR);
+    Button settingsButton("Настройки", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.63f), SECONDARY_COLOR);
+    Button leaderboardButton("Таблица Лидеров", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.73f), SECONDARY_COLOR);
+    Button exitToDesktopButton("Рабочий стол", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.83f), SECONDARY_COLOR);
 
     // Settings UI elements
     std::vector<std::string> difficultyOptions = { "лёгкая", "нормальная", "сложная" };
@@ -1367,38 +1795,48 @@ int main() {
     Button gameOverMenuButton("Главное Меню", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.75f), SECONDARY_COLOR);
 
     // Leaderboard UI elements
+    Button leaderboardViewButton(leaderboard.getViewName(), font, buttonFontSize * 3 / 4, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) * 0.23f), SECONDARY_COLOR);
+    std::string gameOverRankLine;
     Button leaderboardBackButton("Главное Меню", font, buttonFontSize, Vector2f(static_cast<float>(GLOBAL_WIDTH) / 2, static_cast<float>(GLOBAL_HEIGHT) - static_cast<float>(GLOBAL_HEIGHT) * 0.1f), SECONDARY_COLOR);
 
     Clock gameUpdateClock;
     float snakeSpeed = 0.15f; // Normal difficulty by default
 
+    // Виджеты экранов для InputSnapshot, снизу вверх: раскрытый список поверх кнопок
+    std::vector<std::vector<Widget*>> screens(ARENA + 1);
+    screens[LOGIN] = { &usernameLoginBox, &passwordLoginBox, &loginButton, &registerButton };
+    screens[REGISTER] = { &usernameRegisterBox, &passwordRegisterBox, &confirmRegisterBox, &registerConfirmButton, &backToLoginButton };
+    screens[MENU] = { &playButton, &arenaButton, &hugeArenaButton, &settingsButton, &leaderboardButton, &exitToDesktopButton };
+    screens[PAUSED] = { &resumeButton, &settingsPauseButton, &pauseMenuButton };
+    screens[GAME_OVER] = { &gameOverRestartButton, &gameOverMenuButton };
+    screens[SETTINGS] = { &toggleMusicButton_placeholder, &toggleEffectsButton_placeholder, &saveButton,
+        &backToMenuButton_placeholder, &difficultyDropdown };
+    screens[LEADERBOARD] = { &leaderboardViewButton, &leaderboardBackButton };
+
+    InputSnapshot input;
     while (window.isOpen()) {
+        input.setScreen(&screens[currentGameState]);
+        input.beginFrame(window);
         Event event;
         while (window.pollEvent(event)) {
+            // Клик мог сменить экран на прошлом событии
+            input.setScreen(&screens[currentGameState]);
+            input.onEvent(event, window);
+            bool consumed = input.dispatch(event);
             if (event.type == Event::Closed) {
                 window.close();
             }
 
             // Обработка событий в зависимости от текущего состояния игры
             if (currentGameState == LOGIN) {
-                usernameLoginBox.handleEvent(event, window);
-                passwordLoginBox.handleEvent(event, window);
-
-                if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
-                    if (loginButton.handleClick(window, event, clickSfx)) {
-                        if (userManager.loginUser(usernameLoginBox.getText(), passwordLoginBox.getText())) {
-                            currentGameState = MENU;
-                            loginErrorText.setString("");
-                            usernameLoginBox.clear();
-                            passwordLoginBox.clear();
-                            musicManager.play("menu");
-                        }
-                        else {
-                            loginErrorText.setString("Неверное имя или пароль");
+                if (isLeftRelease(event)) {
+                    if (loginButton.handleClick(input, event, clickSfx)) {
+                        if (userManager.beginLogin(usernameLoginBox.getText(), passwordLoginBox.getText())) {
+                            loginErrorText.setString("Проверка...");
                             loginErrorText.setOrigin(loginErrorText.getLocalBounds().width / 2.0f, loginErrorText.getLocalBounds().height / 2.0f);
                         }
                     }
-                    else if (registerButton.handleClick(window, event, clickSfx)) {
+                    else if (registerButton.handleClick(input, event, clickSfx)) {
                         currentGameState = REGISTER;
                         loginErrorText.setString("");
                         usernameLoginBox.clear();
@@ -1411,31 +1849,19 @@ int main() {
                 }
                 if (event.type == Event::KeyPressed && event.key.code == Keyboard::Enter) {
                     if (usernameLoginBox.getActive()) {
-                        passwordLoginBox.setActive(true);
-                        usernameLoginBox.setActive(false);
+                        input.setFocus(&passwordLoginBox);
                     }
                     else if (passwordLoginBox.getActive()) {
-                        if (userManager.loginUser(usernameLoginBox.getText(), passwordLoginBox.getText())) {
-                            currentGameState = MENU;
-                            loginErrorText.setString("");
-                            usernameLoginBox.clear();
-                            passwordLoginBox.clear();
-                            musicManager.play("menu");
-                        }
-                        else {
-                            loginErrorText.setString("Неверное имя или пароль");
+                        if (userManager.beginLogin(usernameLoginBox.getText(), passwordLoginBox.getText())) {
+                            loginErrorText.setString("Проверка...");
                             loginErrorText.setOrigin(loginErrorText.getLocalBounds().width / 2.0f, loginErrorText.getLocalBounds().height / 2.0f);
                         }
                     }
                 }
             }
             else if (currentGameState == REGISTER) {
-                usernameRegisterBox.handleEvent(event, window);
-                passwordRegisterBox.handleEvent(event, window);
-                confirmRegisterBox.handleEvent(event, window);
-
-                if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
-                    if (registerConfirmButton.handleClick(window, event, clickSfx)) {
+                if (isLeftRelease(event)) {
+                    if (registerConfirmButton.handleClick(input, event, clickSfx)) {
                         if (usernameRegisterBox.getText().empty() || passwordRegisterBox.getText().empty() || confirmRegisterBox.getText().empty()) {
                             registerErrorText.setString("Все поля должны быть заполнены!");
                             registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
@@ -1444,21 +1870,15 @@ int main() {
                             registerErrorText.setString("Неверный пароль!");
                             registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
                         }
-                        else if (userManager.registerUser(usernameRegisterBox.getText(), passwordRegisterBox.getText())) {
-                            currentGameState = LOGIN;
-                            registerErrorText.setString("Успешная регистрация! Пожалуйста войдите.");
-                            registerErrorText.setFillColor(PRIMARY_COLOR);
-                            registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
-                            usernameRegisterBox.clear();
-                            passwordRegisterBox.clear();
-                            confirmRegisterBox.clear();
-                        }
                         else {
-                            registerErrorText.setString("Имя уже существует!");
+                            AuthResult result = userManager.beginRegister(usernameRegisterBox.getText(), passwordRegisterBox.getText());
+                            if (result == AUTH_PENDING) registerErrorText.setString("Регистрация...");
+                            else if (result == AUTH_INVALID) registerErrorText.setString("Имя и пароль без пробелов!");
+                            else registerErrorText.setString("Имя уже существует!");
                             registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
                         }
                     }
-                    else if (backToLoginButton.handleClick(window, event, clickSfx)) {
+                    else if (backToLoginButton.handleClick(input, event, clickSfx)) {
                         currentGameState = LOGIN;
                         registerErrorText.setString("");
                         usernameRegisterBox.clear();
@@ -1469,12 +1889,10 @@ int main() {
                 }
                 if (event.type == Event::KeyPressed && event.key.code == Keyboard::Enter) {
                     if (usernameRegisterBox.getActive()) {
-                        passwordRegisterBox.setActive(true);
-                        usernameRegisterBox.setActive(false);
+                        input.setFocus(&passwordRegisterBox);
                     }
                     else if (passwordRegisterBox.getActive()) {
-                        confirmRegisterBox.setActive(true);
-                        passwordRegisterBox.setActive(false);
+                        input.setFocus(&confirmRegisterBox);
                     }
                     else if (confirmRegisterBox.getActive()) {
                         if (usernameRegisterBox.getText().empty() || passwordRegisterBox.getText().empty() || confirmRegisterBox.getText().empty()) {
@@ -1485,43 +1903,47 @@ int main() {
                             registerErrorText.setString("Неверный пароль!");
                             registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
                         }
-                        else if (userManager.registerUser(usernameRegisterBox.getText(), passwordRegisterBox.getText())) {
-                            currentGameState = LOGIN;
-                            registerErrorText.setString("Успешная регистрация! Пожалуйста войдите.");
-                            registerErrorText.setFillColor(PRIMARY_COLOR);
-                            registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
-                            usernameRegisterBox.clear();
-                            passwordRegisterBox.clear();
-                            confirmRegisterBox.clear();
-                        }
                         else {
-                            registerErrorText.setString("Имя уже занято!");
+                            AuthResult result = userManager.beginRegister(usernameRegisterBox.getText(), passwordRegisterBox.getText());
+                            if (result == AUTH_PENDING) registerErrorText.setString("Регистрация...");
+                            else if (result == AUTH_INVALID) registerErrorText.setString("Имя и пароль без пробелов!");
+                            else registerErrorText.setString("Имя уже занято!");
                             registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
                         }
                     }
                 }
             }
             else if (currentGameState == MENU) {
-                if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
-                    if (playButton.handleClick(window, event, clickSfx)) {
+                if (isLeftRelease(event)) {
+                    if (playButton.handleClick(input, event, clickSfx)) {
                         currentGameState = PLAYING;
-                        musicManager.play("game");
+                        musicManager.play(MUSIC_GAME);
                     }
-                    else if (settingsButton.handleClick(window, event, clickSfx)) {
+                    else if (arenaButton.handleClick(input, event, clickSfx)) {
+                        arenaMode.reset(false);
+                        currentGameState = ARENA;
+                        musicManager.play(MUSIC_GAME);
+                    }
+                    else if (hugeArenaButton.handleClick(input, event, clickSfx)) {
+                        arenaMode.reset(true);
+                        currentGameState = ARENA;
+                        musicManager.play(MUSIC_GAME);
+                    }
+                    else if (settingsButton.handleClick(input, event, clickSfx)) {
                         // Обновленная часть - переход в настройки
                         previousGameState = MENU;
                         currentGameState = SETTINGS;
-                        musicManager.play("settings");
+                        musicManager.play(MUSIC_SETTINGS);
                         // Устанавливаем текущую сложность в dropdown
                         difficultyDropdown.setSelectedIndex(static_cast<int>(settings.difficulty));
                         // Обновляем скорость змейки согласно настройкам
                         snake.updateSpeed();
                     }
-                    else if (leaderboardButton.handleClick(window, event, clickSfx)) {
+                    else if (leaderboardButton.handleClick(input, event, clickSfx)) {
                         currentGameState = LEADERBOARD;
-                        musicManager.play("settings"); // Можно использовать ту же музыку, что и для настроек
+                        musicManager.play(MUSIC_SETTINGS); // Можно использовать ту же музыку, что и для настроек
                     }
-                    else if (exitToDesktopButton.handleClick(window, event, clickSfx)) {
+                    else if (exitToDesktopButton.handleClick(input, event, clickSfx)) {
                         window.close();
                     }
                 }
@@ -1539,61 +1961,72 @@ int main() {
                 }
             }
 
+            else if (currentGameState == ARENA) {
+                if (event.type == Event::KeyPressed) {
+                    if (event.key.code == Keyboard::Up) arenaMode.changeDirection(UP);
+                    else if (event.key.code == Keyboard::Down) arenaMode.changeDirection(DOWN);
+                    else if (event.key.code == Keyboard::Left) arenaMode.changeDirection(LEFT);
+                    else if (event.key.code == Keyboard::Right) arenaMode.changeDirection(RIGHT);
+                    else if (event.key.code == Keyboard::Escape) {
+                        currentGameState = MENU;
+                        musicManager.play(MUSIC_MENU);
+                    }
+                }
+            }
             else if (currentGameState == PAUSED) {
-                if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
-                    if (resumeButton.handleClick(window, event, clickSfx)) {
+                if (isLeftRelease(event)) {
+                    if (resumeButton.handleClick(input, event, clickSfx)) {
                         currentGameState = PLAYING;
-                        musicManager.play("game");
+                        musicManager.play(MUSIC_GAME);
                     }
-                    else if (settingsPauseButton.handleClick(window, event, clickSfx)) {
+                    else if (settingsPauseButton.handleClick(input, event, clickSfx)) {
                         // Обновленная часть - переход в настройки из паузы
                         previousGameState = PAUSED;
                         currentGameState = SETTINGS;
-                        musicManager.play("settings");
+                        musicManager.play(MUSIC_SETTINGS);
                         // Устанавливаем текущую сложность в dropdown
                         difficultyDropdown.setSelectedIndex(static_cast<int>(settings.difficulty));
                         // Обновляем скорость змейки согласно настройкам
                         snake.updateSpeed();
                     }
-                    else if (pauseMenuButton.handleClick(window, event, clickSfx)) {
+                    else if (pauseMenuButton.handleClick(input, event, clickSfx)) {
                         currentGameState = MENU;
-                        musicManager.play("menu");
+                        musicManager.play(MUSIC_MENU);
                         snake.reset();
                     }
                 }
             }
             else if (currentGameState == GAME_OVER) {
-                if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
-                    if (gameOverRestartButton.handleClick(window, event, clickSfx)) {
+                if (isLeftRelease(event)) {
+                    if (gameOverRestartButton.handleClick(input, event, clickSfx)) {
                         snake.reset();
                         currentGameState = PLAYING;
-                        musicManager.play("game");
+                        musicManager.play(MUSIC_GAME);
                     }
-                    else if (gameOverMenuButton.handleClick(window, event, clickSfx)) {
+                    else if (gameOverMenuButton.handleClick(input, event, clickSfx)) {
                         snake.reset();
                         currentGameState = MENU;
-                        musicManager.play("menu");
+                        musicManager.play(MUSIC_MENU);
                     }
                 }
             }
             else if (currentGameState == SETTINGS) {
-                // Обработка событий для dropdown
-                bool dropdownHandled = difficultyDropdown.handleEvent(event, window);
-
-                if (!dropdownHandled && event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
-                    if (toggleMusicButton_placeholder.handleClick(window, event, clickSfx)) {
-                        musicManager.toggleMusic();
+                // Список сложности получил событие через dispatch
+                if (!consumed && isLeftRelease(event)) {
+                    if (toggleMusicButton_placeholder.handleClick(input, event, clickSfx)) {
+                        settings.musicEnabled = !settings.musicEnabled;
+                        musicManager.setEnabled(settings.musicEnabled);
                         toggleMusicButton_placeholder.setString(settings.musicEnabled ? "Музыка: ВКЛ" : "Музыка: ВЫКЛ");
                     }
-                    else if (toggleEffectsButton_placeholder.handleClick(window, event, clickSfx)) {
+                    else if (toggleEffectsButton_placeholder.handleClick(input, event, clickSfx)) {
                         settings.soundEffectsEnabled = !settings.soundEffectsEnabled;
                         toggleEffectsButton_placeholder.setString(settings.soundEffectsEnabled ? "Звуковые эффекты: ВКЛ" : "Звуковые эффекты: ВЫКЛ");
-                        clickSfx.toggleEffects();
-                        appleSfx.toggleEffects();
-                        bonusSfx.toggleEffects();
-                        antiBonusSfx.toggleEffects();
+                        clickSfx.toggleEffects(settings.soundEffectsEnabled);
+                        appleSfx.toggleEffects(settings.soundEffectsEnabled);
+                        bonusSfx.toggleEffects(settings.soundEffectsEnabled);
+                        antiBonusSfx.toggleEffects(settings.soundEffectsEnabled);
                     }
-                    else if (saveButton.handleClick(window, event, clickSfx)) {
+                    else if (saveButton.handleClick(input, event, clickSfx)) {
                         // Применяем настройки только после нажатия Save
                         int selected = difficultyDropdown.getSelectedIndex();
                         if (selected == 0) settings.difficulty = EASY;
@@ -1601,12 +2034,12 @@ int main() {
                         else if (selected == 2) settings.difficulty = HARD;
 
                         snake.updateSpeed();
-                        settings.saveToFile();
+                        settings.saveToFile(persistence);
                     }
-                    else if (backToMenuButton_placeholder.handleClick(window, event, clickSfx)) {
+                    else if (backToMenuButton_placeholder.handleClick(input, event, clickSfx)) {
                         currentGameState = previousGameState;
                         if (currentGameState == MENU) {
-                            musicManager.play("menu");
+                            musicManager.play(MUSIC_MENU);
                         }
                         else if (currentGameState == PAUSED) {
                             // Если вернулись в паузу, музыку не проигрываем
@@ -1616,24 +2049,73 @@ int main() {
                 }
             }
             else if (currentGameState == LEADERBOARD) {
-                if (event.type == Event::MouseButtonReleased && event.mouseButton.button == Mouse::Left) {
-                    if (leaderboardBackButton.handleClick(window, event, clickSfx)) {
+                if (isLeftRelease(event)) {
+                    if (leaderboardBackButton.handleClick(input, event, clickSfx)) {
                         currentGameState = MENU;
-                        musicManager.play("menu");
+                        musicManager.play(MUSIC_MENU);
+                    }
+                    else if (leaderboardViewButton.handleClick(input, event, clickSfx)) {
+                        leaderboard.nextView();
+                        leaderboardViewButton.setString(leaderboard.getViewName());
                     }
                 }
             }
            window.clear();
         }
+
+        // Итог входа/регистрации из потока хэширования паролей
+        AuthResult auth = userManager.poll();
+        if (auth == AUTH_LOGGED_IN) {
+            currentGameState = MENU;
+            loginErrorText.setString("");
+            usernameLoginBox.clear();
+            passwordLoginBox.clear();
+            musicManager.play(MUSIC_MENU);
+        }
+        else if (auth == AUTH_WRONG_PASSWORD) {
+            loginErrorText.setString("Неверное имя или пароль");
+            loginErrorText.setOrigin(loginErrorText.getLocalBounds().width / 2.0f, loginErrorText.getLocalBounds().height / 2.0f);
+        }
+        else if (auth == AUTH_REGISTERED) {
+            currentGameState = LOGIN;
+            registerErrorText.setString("Успешная регистрация! Пожалуйста войдите.");
+            registerErrorText.setFillColor(PRIMARY_COLOR);
+            registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
+            usernameRegisterBox.clear();
+            passwordRegisterBox.clear();
+            confirmRegisterBox.clear();
+        }
+        else if (auth == AUTH_NAME_TAKEN) {
+            registerErrorText.setString("Имя уже существует!");
+            registerErrorText.setOrigin(registerErrorText.getLocalBounds().width / 2.0f, registerErrorText.getLocalBounds().height / 2.0f);
+        }
+
+        // Набор ресурсов нового экрана; пока он догружается - полоса загрузки
+        if (currentGameState != residentState) {
+            assets.enter(currentGameState);
+            residentState = currentGameState;
+        }
+        assets.update();
+        if (!assets.getFailure().empty()) {
+            std::cerr << "Error loading " << assets.getFailure() << "!" << std::endl;
+            window.close();
+            break;
+        }
+        if (!assets.isStateReady(currentGameState)) {
+            drawLoadingScreen(window, &font, assets.getStateProgress(currentGameState));
+            window.display();
+            continue;
+        }
+
         // Отрисовка в зависимости от текущего состояния игры
         if (currentGameState == LOGIN) {
-            drawLoginScreen(window, font, menuBackground, userManager, usernameLoginBox, passwordLoginBox, loginErrorText, loginButton, registerButton);
+            drawLoginScreen(window, input, font, menuBackground, userManager, usernameLoginBox, passwordLoginBox, loginErrorText, loginButton, registerButton);
         }
         else if (currentGameState == REGISTER) {
-            drawRegisterScreen(window, font, menuBackground, userManager, usernameRegisterBox, passwordRegisterBox, confirmRegisterBox, registerErrorText, registerConfirmButton, backToLoginButton);
+            drawRegisterScreen(window, input, font, menuBackground, userManager, usernameRegisterBox, passwordRegisterBox, confirmRegisterBox, registerErrorText, registerConfirmButton, backToLoginButton);
         }
         else if (currentGameState == MENU) {
-            drawMainMenu(window, font, menuBackground, userManager, playButton, settingsButton, leaderboardButton, exitToDesktopButton);
+            drawMainMenu(window, input, font, menuBackground, userManager, playButton, arenaButton, hugeArenaButton, settingsButton, leaderboardButton, exitToDesktopButton);
         }
         else if (currentGameState == PLAYING) {
             // Установка скорости змейки в зависимости от сложности
@@ -1648,29 +2130,42 @@ int main() {
 
             if (snake.gameOver) {
                 currentGameState = GAME_OVER;
-                leaderboard.addScore(userManager.getCurrentUser(), snake.score);
-                musicManager.play("gameover");
+                size_t rank = leaderboard.addScore(userManager.getCurrentUser(), snake.score, settings.difficulty);
+                gameOverRankLine = "Место: " + std::to_string(rank) + " из " +
+                    std::to_string(leaderboard.getCount(settings.difficulty)) + " (" + DIFFICULTY_OPTIONS[settings.difficulty] + ")";
+                musicManager.play(MUSIC_GAMEOVER);
             }
             else {
                 snake.draw(window, gameBackground);
             }
         }
+        else if (currentGameState == ARENA) {
+            arenaMode.poll();
+            if (gameUpdateClock.getElapsedTime().asSeconds() >= arenaMode.getSpeed() && arenaMode.update(appleSfx)) {
+                gameUpdateClock.restart();
+            }
+            arenaMode.draw(window, font, gameBackground);
+        }
         else if (currentGameState == PAUSED) {
-            drawPauseScreen(window, font, gameBackground, resumeButton, settingsPauseButton, pauseMenuButton);
+            drawPauseScreen(window, input, font, gameBackground, resumeButton, settingsPauseButton, pauseMenuButton);
         }
         else if (currentGameState == GAME_OVER) {
-            snake.drawGameOver(window, font, gameBackground, gameOverRestartButton, gameOverMenuButton);
+            snake.drawGameOver(window, input, font, gameBackground, gameOverRestartButton, gameOverMenuButton, gameOverRankLine);
         }
         else if (currentGameState == SETTINGS) {
-            drawSettingsScreen(window, font, menuBackground, difficultyDropdown,
+            drawSettingsScreen(window, input, font, menuBackground, difficultyDropdown,
                 toggleMusicButton_placeholder, toggleEffectsButton_placeholder,
                 saveButton, backToMenuButton_placeholder, previousGameState == PAUSED);
         }
         else if (currentGameState == LEADERBOARD) {
-            leaderboard.draw(window, menuBackground, leaderboardBackButton);
+            leaderboard.draw(window, input, menuBackground, leaderboardBackButton, leaderboardViewButton, userManager.getCurrentUser());
         }
 
         window.display();
     }
+    musicManager.printReport(std::cout);
+    if (pcmCache) pcmCache->printReport(std::cout);
+    // Барьер на выходе: всё, что поставлено в очередь, должно лечь на диск
+    persistence.flush();
    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Гистограмма с корзинами фиксированной ширины; последняя корзина собирает хвост
+struct Histogram {
+    int bucketWidth = 1;
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    double sum = 0.0;
+    int64_t minValue = INT64_MAX;
+    int64_t maxValue = INT64_MIN;
+
+    Histogram(int bucketWidth = 1, int bucketCount = 32)
+        : bucketWidth(bucketWidth), buckets(bucketCount, 0) {
+    }
+
+    void add(int64_t value) {
+        size_t index = static_cast<size_t>(std::max<int64_t>(0, value) / bucketWidth);
+        ++buckets[std::min(index, buckets.size() - 1)];
+        ++count;
+        sum += static_cast<double>(value);
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+
+    void merge(const Histogram& other) {
+        for (size_t i = 0; i < buckets.size(); ++i) buckets[i] += other.buckets[i];
+        count += other.count;
+        sum += other.sum;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    double mean() const { return count ? sum / count : 0.0; }
+
+    // Верхняя граница корзины, в которую попадает доля q значений (0..1)
+    int64_t percentile(double q) const {
+        uint64_t target = static_cast<uint64_t>(q * count);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            seen += buckets[i];
+            if (seen > target) return i + 1 == buckets.size() ? maxValue : std::min(maxValue, static_cast<int64_t>(i + 1) * bucketWidth);
+        }
+        return count ? maxValue : 0;
+    }
+
+    void print(std::ostream& out, const std::string& title) const {
+        out << title << ": min " << (count ? minValue : 0) << ", max " << (count ? maxValue : 0)
+            << ", mean " << std::fixed << std::setprecision(2) << mean() << "\n";
+        uint64_t peak = *std::max_element(buckets.begin(), buckets.end());
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            if (buckets[i] == 0) continue;
+            int64_t from = static_cast<int64_t>(i) * bucketWidth;
+            out << "  " << std::setw(7) << from;
+            if (i + 1 == buckets.size()) out << "+       ";
+            else out << ".." << std::setw(6) << std::left << (from + bucketWidth - 1) << std::right;
+            int bar = peak ? static_cast<int>(40 * buckets[i] / peak) : 0;
+            out << std::setw(10) << buckets[i] << " " << std::string(bar, '#') << "\n";
+        }
+    }
+};
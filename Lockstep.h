@@ -0,0 +1,395 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Arena.h"
+
+// Локальная сетевая игра в lockstep: 2-8 узлов симулируют одну и ту же арену,
+// по сети (UDP) ходят только ввод игроков на каждый тик. Ввод планируется с
+// задержкой inputDelay тиков, каждый пакет повторяет последние redundancy вводов,
+// так что потеря отдельных пакетов не останавливает игру. Узлы обмениваются
+// хэшами состояния и сразу замечают рассинхронизацию. Узел, от которого дольше
+// peerTimeoutSeconds нет пакетов, выбывает: оставшиеся сообщают друг другу, до
+// какого тика у них есть его ввод, пересылают недостающее и с общего тика считают
+// его ввод пустым.
+
+struct LockstepConfig {
+    int players = 2;
+    int localPlayer = 0;
+    sf::IpAddress host = sf::IpAddress::LocalHost; // узел i слушает host:basePort + i
+    unsigned short basePort = 47000;
+    int cols = 48;
+    int rows = 27;
+    uint64_t seed = 1;
+    int inputDelay = 3;
+    int redundancy = 6;
+    float resendSeconds = 0.03f; // повтор последнего пакета, пока ждём чужой ввод
+    float peerTimeoutSeconds = 5.f;  // молчание узла, после которого он выбывает
+    float joinTimeoutSeconds = 30.f; // ожидание первого пакета от узла после start()
+    // Имитация плохой сети (только исходящие пакеты)
+    float loss = 0.f;
+    float latencySeconds = 0.f;
+    float jitterSeconds = 0.f;
+};
+
+// Обёртка над sf::UdpSocket, которая теряет и задерживает исходящие пакеты
+class LossyLink {
+private:
+    struct Pending {
+        float deliverAt;
+        sf::Packet packet;
+        unsigned short port;
+    };
+
+    sf::UdpSocket& socket;
+    sf::IpAddress host;
+    float loss;
+    float latency;
+    float jitter;
+    Rng rng;
+    std::vector<Pending> queue;
+
+    float random01() { return static_cast<float>(rng.next() >> 8) / 16777216.f; }
+
+public:
+    uint64_t sent = 0;
+    uint64_t dropped = 0;
+
+    LossyLink(sf::UdpSocket& socket, const sf::IpAddress& host, float loss, float latency, float jitter, uint64_t seed)
+        : socket(socket), host(host), loss(loss), latency(latency), jitter(jitter) {
+        rng.seed(seed);
+    }
+
+    void send(const sf::Packet& packet, unsigned short port, float now) {
+        ++sent;
+        if (loss > 0.f && random01() < loss) {
+            ++dropped;
+            return;
+        }
+        float delay = latency + jitter * random01();
+        if (delay <= 0.f) {
+            sf::Packet copy = packet;
+            socket.send(copy, host, port);
+            return;
+        }
+        queue.push_back({ now + delay, packet, port });
+    }
+
+    void flush(float now) {
+        size_t kept = 0;
+        for (size_t i = 0; i < queue.size(); ++i) {
+            if (queue[i].deliverAt <= now) socket.send(queue[i].packet, host, queue[i].port);
+            else {
+                if (kept != i) queue[kept] = std::move(queue[i]);
+                ++kept;
+            }
+        }
+        queue.resize(kept);
+    }
+};
+
+class LockstepSession {
+public:
+    static const uint8_t INPUT_NONE = 0xFF; // без поворота
+    static const int MAX_PLAYERS = 8;
+
+    struct Stats {
+        uint32_t stalls = 0;      // вызовы advance, которым не хватило чужого ввода
+        uint64_t resends = 0;
+        uint64_t received = 0;
+        uint64_t rejected = 0;    // чужие/битые пакеты и пакеты выбывших узлов
+        uint32_t peersDropped = 0;
+    };
+
+private:
+    // Окно тиков, в котором хранятся ввод и хэши; узлы расходятся не больше чем на inputDelay
+    static const int WINDOW = 256;
+    static const uint32_t MAGIC = 0x534E4B31; // "SNK1"
+    static const uint32_t NO_TICK = UINT32_MAX;
+
+    struct Slot {
+        uint32_t tick = NO_TICK;
+        uint8_t input = INPUT_NONE;
+    };
+
+    struct HashSlot {
+        uint32_t tick = NO_TICK;
+        uint64_t hash = 0;
+    };
+
+    LockstepConfig config;
+    Arena arena;
+    sf::UdpSocket socket;
+    LossyLink link;
+    sf::Clock clock;
+    std::vector<Slot> inputs;       // [player][WINDOW]
+    std::vector<HashSlot> hashes;   // [player][WINDOW], свой игрок тоже
+    std::vector<uint32_t> peerTicks; // последний известный тик каждого узла
+    std::vector<float> lastHeard;   // время последнего пакета от узла
+    std::vector<bool> heard;        // от узла был хотя бы один пакет
+    std::vector<bool> dropped;      // узел выбыл по таймауту или по сообщению другого узла
+    std::vector<uint32_t> dropFrom; // первый тик, ввода выбывшего на котором у нас нет
+    std::vector<uint32_t> reportedDrop; // [узел][выбывший] - его dropFrom, NO_TICK - ещё не сообщил
+    uint32_t simTick = 0;           // следующий тик симуляции
+    uint8_t pendingInput = INPUT_NONE;
+    float lastSend = 0.f;
+    bool desynced = false;
+    uint32_t desyncTick = 0;
+    Stats stats;
+
+    Slot& inputSlot(int player, uint32_t tick) { return inputs[player * WINDOW + tick % WINDOW]; }
+    HashSlot& hashSlot(int player, uint32_t tick) { return hashes[player * WINDOW + tick % WINDOW]; }
+
+    void checkHash(int player, uint32_t tick) {
+        const HashSlot& remote = hashSlot(player, tick);
+        const HashSlot& local = hashSlot(config.localPlayer, tick);
+        if (remote.tick == tick && local.tick == tick && remote.hash != local.hash && !desynced) {
+            desynced = true;
+            desyncTick = tick;
+        }
+    }
+
+    // Пакет: magic, игрок, его текущий тик, первый тик, вводы [first, first + count),
+    // последний посчитанный тик и его хэш. Вводы начинаются не позже самого
+    // отстающего узла, чтобы повтор всегда закрывал то, чего ему не хватает.
+    void broadcast() {
+        // Ввод на simTick + inputDelay ещё не запланирован, если advance до него не дошёл:
+        // в ячейке кольца лежит чужой тик, слать его нельзя
+        uint32_t last = simTick + config.inputDelay;
+        if (inputSlot(config.localPlayer, last).tick != last) --last;
+        uint32_t first = last + 1 > static_cast<uint32_t>(config.redundancy) ? last + 1 - config.redundancy : 0;
+        for (int player = 0; player < config.players; ++player) {
+            if (player != config.localPlayer && !dropped[player]) first = std::min(first, peerTicks[player]);
+        }
+        first = std::max(first, last > 254 ? last - 254 : 0u);
+        sf::Packet packet;
+        packet << static_cast<sf::Uint32>(MAGIC) << static_cast<sf::Uint8>(config.localPlayer)
+            << static_cast<sf::Uint32>(simTick) << static_cast<sf::Uint32>(first) << static_cast<sf::Uint8>(last - first + 1);
+        for (uint32_t tick = first; tick <= last; ++tick) {
+            packet << static_cast<sf::Uint8>(inputSlot(config.localPlayer, tick).input);
+        }
+        // До первого тика хэша ещё нет
+        uint32_t hashTick = simTick > 0 ? simTick - 1 : NO_TICK;
+        uint64_t hash = simTick > 0 ? hashSlot(config.localPlayer, hashTick).hash : 0;
+        packet << static_cast<sf::Uint32>(hashTick) << static_cast<sf::Uint64>(hash);
+        // Выбывшие: наш dropFrom и их ввод [relayFirst, dropFrom), которого может не быть у отстающих
+        sf::Uint8 dropCount = 0;
+        for (int player = 0; player < config.players; ++player) dropCount += dropped[player] ? 1 : 0;
+        packet << dropCount;
+        for (int player = 0; player < config.players; ++player) {
+            if (!dropped[player]) continue;
+            uint32_t relayFirst = std::max(first, dropFrom[player] > 255 ? dropFrom[player] - 255 : 0u);
+            uint32_t relayCount = dropFrom[player] > relayFirst ? dropFrom[player] - relayFirst : 0;
+            packet << static_cast<sf::Uint8>(player) << static_cast<sf::Uint32>(dropFrom[player])
+                << static_cast<sf::Uint32>(relayFirst) << static_cast<sf::Uint8>(relayCount);
+            for (uint32_t tick = relayFirst; tick < relayFirst + relayCount; ++tick) {
+                packet << static_cast<sf::Uint8>(inputSlot(player, tick).input);
+            }
+        }
+
+        float now = clock.getElapsedTime().asSeconds();
+        for (int player = 0; player < config.players; ++player) {
+            if (player != config.localPlayer && !dropped[player]) {
+                link.send(packet, static_cast<unsigned short>(config.basePort + player), now);
+            }
+        }
+        lastSend = now;
+    }
+
+    void receive() {
+        sf::Packet packet;
+        sf::IpAddress sender;
+        unsigned short port;
+        while (socket.receive(packet, sender, port) == sf::Socket::Done) {
+            sf::Uint32 magic, peerTick, first, hashTick;
+            sf::Uint8 player, count;
+            sf::Uint64 hash;
+            if (!(packet >> magic >> player >> peerTick >> first >> count) || magic != MAGIC ||
+                player >= config.players || player == config.localPlayer || dropped[player]) {
+                ++stats.rejected;
+                continue;
+            }
+            uint8_t values[256];
+            for (int i = 0; i < count; ++i) packet >> values[i];
+            if (!(packet >> hashTick >> hash)) {
+                ++stats.rejected;
+                continue;
+            }
+            ++stats.received;
+            lastHeard[player] = clock.getElapsedTime().asSeconds();
+            heard[player] = true;
+            peerTicks[player] = std::max(peerTicks[player], static_cast<uint32_t>(peerTick));
+            storeInputs(player, first, count, values);
+            sf::Uint8 dropCount = 0;
+            packet >> dropCount;
+            for (int i = 0; i < dropCount; ++i) {
+                sf::Uint8 lost, relayCount;
+                sf::Uint32 lostFrom, relayFirst;
+                if (!(packet >> lost >> lostFrom >> relayFirst >> relayCount) || lost >= config.players) break;
+                for (int k = 0; k < relayCount; ++k) packet >> values[k];
+                if (!packet || lost == config.localPlayer) continue;
+                // Узел, выбывший у соседа, выбывает и у нас: иначе наши вводы разойдутся
+                if (!dropped[lost]) dropPlayer(lost);
+                reportedDrop[player * config.players + lost] = lostFrom;
+                storeInputs(lost, relayFirst, relayCount, values);
+            }
+            if (hashTick != NO_TICK && static_cast<uint64_t>(hashTick) + WINDOW > simTick) {
+                HashSlot& slot = hashSlot(player, hashTick);
+                slot.tick = hashTick;
+                slot.hash = hash;
+                checkHash(player, hashTick);
+            }
+        }
+    }
+
+    // Свежий ввод игрока; уже записанные тики не трогаем - повторы несут то же самое
+    void storeInputs(int player, uint32_t first, int count, const uint8_t* values) {
+        for (int i = 0; i < count; ++i) {
+            uint32_t tick = first + i;
+            if (tick < simTick || tick >= simTick + WINDOW) continue;
+            Slot& slot = inputSlot(player, tick);
+            if (slot.tick == tick) continue;
+            slot.tick = tick;
+            slot.input = values[i];
+        }
+    }
+
+    // Пакеты выбывшего больше не принимаются, так что dropFrom у каждого узла окончательный
+    void dropPlayer(int player) {
+        dropped[player] = true;
+        uint32_t tick = simTick;
+        while (tick < simTick + WINDOW && inputSlot(player, tick).tick == tick) ++tick;
+        dropFrom[player] = tick;
+        ++stats.peersDropped;
+    }
+
+    // Тик, с которого ввод выбывшего пустой у всех: наибольший dropFrom среди
+    // оставшихся - у того узла есть весь ввод до него, и он его пересылает.
+    // NO_TICK - ещё не все оставшиеся сообщили свой dropFrom.
+    uint32_t agreedDropTick(int player) const {
+        uint32_t agreed = dropFrom[player];
+        for (int other = 0; other < config.players; ++other) {
+            if (other == config.localPlayer || dropped[other]) continue;
+            uint32_t reported = reportedDrop[other * config.players + player];
+            if (reported == NO_TICK) return NO_TICK;
+            agreed = std::max(agreed, reported);
+        }
+        return agreed;
+    }
+
+    void checkTimeouts() {
+        float now = clock.getElapsedTime().asSeconds();
+        for (int player = 0; player < config.players; ++player) {
+            if (player == config.localPlayer || dropped[player]) continue;
+            float limit = heard[player] ? config.peerTimeoutSeconds : config.joinTimeoutSeconds;
+            if (now - lastHeard[player] > limit) dropPlayer(player);
+        }
+    }
+
+public:
+    LockstepSession(const LockstepConfig& config)
+        : config(config), arena(config.cols, config.rows, config.players, config.seed),
+        link(socket, config.host, config.loss, config.latencySeconds, config.jitterSeconds,
+            config.seed * 31 + config.localPlayer),
+        inputs(static_cast<size_t>(config.players) * WINDOW), hashes(static_cast<size_t>(config.players) * WINDOW),
+        peerTicks(config.players, 0), lastHeard(config.players, 0.f), heard(config.players, false),
+        dropped(config.players, false), dropFrom(config.players, NO_TICK),
+        reportedDrop(static_cast<size_t>(config.players) * config.players, NO_TICK) {
+        for (int player = 0; player < config.players; ++player) {
+            arena.setBot(player, false);
+            // Первые inputDelay тиков идут без ввода у всех узлов
+            for (int tick = 0; tick < config.inputDelay; ++tick) {
+                inputSlot(player, tick).tick = static_cast<uint32_t>(tick);
+            }
+        }
+    }
+
+    // Занимает порт basePort + localPlayer; false, если порт занят
+    bool start() {
+        if (socket.bind(static_cast<unsigned short>(config.basePort + config.localPlayer), config.host) != sf::Socket::Done) {
+            return false;
+        }
+        socket.setBlocking(false);
+        clock.restart();
+        return true;
+    }
+
+    // Поворот, который уйдёт с ближайшим запланированным тиком
+    void setInput(Direction direction) { pendingInput = static_cast<uint8_t>(direction); }
+
+    // Приём пакетов, отправка отложенных и повтор, если давно ничего не отправляли.
+    // Вызывается каждый кадр.
+    void poll() {
+        receive();
+        checkTimeouts();
+        float now = clock.getElapsedTime().asSeconds();
+        if (now - lastSend >= config.resendSeconds) {
+            ++stats.resends;
+            broadcast();
+        }
+        link.flush(clock.getElapsedTime().asSeconds());
+    }
+
+    // Один тик симуляции, если есть ввод всех игроков; false - ждём сеть
+    bool advance() {
+        uint32_t scheduled = simTick + config.inputDelay;
+        Slot& own = inputSlot(config.localPlayer, scheduled);
+        if (own.tick != scheduled) {
+            own.tick = scheduled;
+            own.input = pendingInput;
+            pendingInput = INPUT_NONE;
+            broadcast();
+        }
+        receive();
+
+        for (int player = 0; player < config.players; ++player) {
+            Slot& slot = inputSlot(player, simTick);
+            if (slot.tick != simTick && dropped[player]) {
+                uint32_t agreed = agreedDropTick(player);
+                if (agreed != NO_TICK && simTick >= agreed) {
+                    slot.tick = simTick;
+                    slot.input = INPUT_NONE;
+                }
+            }
+            if (slot.tick != simTick) {
+                ++stats.stalls;
+                checkTimeouts();
+                link.flush(clock.getElapsedTime().asSeconds());
+                return false;
+            }
+        }
+        for (int player = 0; player < config.players; ++player) {
+            uint8_t input = inputSlot(player, simTick).input;
+            if (input != INPUT_NONE) arena.changeDirection(player, static_cast<Direction>(input & 3));
+        }
+        arena.step(false);
+        // Погибшие игроки возрождаются сразу: spawnSnake берёт случайность из общего состояния
+        for (int player = 0; player < config.players; ++player) {
+            if (!arena.getSnake(player).alive) arena.spawnSnake(player);
+        }
+
+        HashSlot& hash = hashSlot(config.localPlayer, simTick);
+        hash.tick = simTick;
+        hash.hash = arena.stateHash();
+        for (int player = 0; player < config.players; ++player) {
+            if (player != config.localPlayer) checkHash(player, simTick);
+        }
+        ++simTick;
+        link.flush(clock.getElapsedTime().asSeconds());
+        return true;
+    }
+
+    const Arena& getArena() const { return arena; }
+    // Только для проверки обнаружения рассинхронизации: локально меняет состояние мимо сети
+    Arena& mutableArena() { return arena; }
+    const LockstepConfig& getConfig() const { return config; }
+    uint32_t getTick() const { return simTick; }
+    bool isDesynced() const { return desynced; }
+    uint32_t getDesyncTick() const { return desyncTick; }
+    const Stats& getStats() const { return stats; }
+    bool isDropped(int player) const { return dropped[player]; }
+    uint64_t packetsSent() const { return link.sent; }
+    uint64_t packetsDropped() const { return link.dropped; }
+};
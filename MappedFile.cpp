@@ -0,0 +1,83 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize)) {
+        CloseHandle(handle);
+        return false;
+    }
+    file = reinterpret_cast<intptr_t>(handle);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) return true; // пустой файл отобразить нельзя, но это не ошибка
+
+    HANDLE section = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!section) {
+        close();
+        return false;
+    }
+    mapping = reinterpret_cast<intptr_t>(section);
+    view = static_cast<const uint8_t*>(MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0));
+    if (!view) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (view) UnmapViewOfFile(view);
+    if (mapping != -1) CloseHandle(reinterpret_cast<HANDLE>(mapping));
+    if (file != -1) CloseHandle(reinterpret_cast<HANDLE>(file));
+    view = nullptr;
+    length = 0;
+    mapping = -1;
+    file = -1;
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        return false;
+    }
+    file = descriptor;
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) return true;
+
+    void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (address == MAP_FAILED) {
+        close();
+        return false;
+    }
+    view = static_cast<const uint8_t*>(address);
+    return true;
+}
+
+void MappedFile::close() {
+    if (view) munmap(const_cast<uint8_t*>(view), length);
+    if (file != -1) ::close(static_cast<int>(file));
+    view = nullptr;
+    length = 0;
+    mapping = -1;
+    file = -1;
+}
+
+#endif
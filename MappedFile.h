@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Файл, отображённый в память только для чтения. Платформенный код
+// (MapViewOfFile / mmap) - в MappedFile.cpp, чтобы системные заголовки
+// не попадали в остальные единицы трансляции.
+class MappedFile {
+private:
+    const uint8_t* view = nullptr;
+    size_t length = 0;
+    intptr_t file = -1;     // HANDLE или дескриптор
+    intptr_t mapping = -1;  // HANDLE отображения (только Windows)
+
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false - файла нет или отобразить не удалось; пустой файл открывается с size() == 0
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return view; }
+    size_t size() const { return length; }
+    bool isOpen() const { return file != -1; }
+};
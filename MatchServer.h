@@ -0,0 +1,441 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Arena.h"
+#include "Histogram.h"
+#include "Replication.h"
+#include "TimerWheel.h"
+
+// Авторитетный сервер: в одном процессе сотни независимых матчей на арене.
+// Матчи распределены по потокам-шардам (матч m живёт в шарде m % shards и
+// никогда не переезжает), тики каждого шарда запускает своё колесо таймеров.
+// Приём соединений и рукопожатие (HELLO за HANDSHAKE_TIMEOUT_MS) - в отдельном
+// потоке через SocketSelector; ввод клиентов матча вычитывается без блокировки
+// прямо перед его тиком.
+//
+// Протокол поверх sf::TcpSocket, одно сообщение - один sf::Packet:
+//   клиент -> сервер: MSG_HELLO magic [role matchId]; MSG_INPUT direction
+//   сервер -> клиент: MSG_WELCOME matchId player snakes cols rows;
+//                     MSG_KEYFRAME / MSG_DELTA - кадры репликации (Replication.h)
+// Зритель (ROLE_SPECTATOR) получает те же кадры, но змейкой не управляет.
+// Каждый тик клиенту уходит не больше одного кадра: если кадр не ушёл целиком,
+// следующим будет ключевой, так что отстающий клиент не копит очередь.
+
+enum MatchMessage {
+    MSG_HELLO = 1,
+    MSG_INPUT = 2,
+    MSG_WELCOME = 3,
+    MSG_KEYFRAME = 4,
+    MSG_DELTA = 5
+};
+
+enum MatchRole {
+    ROLE_PLAYER = 0,
+    ROLE_SPECTATOR = 1
+};
+
+const sf::Uint8 SPECTATOR_PLAYER = 0xFF; // номер игрока в WELCOME для зрителя
+
+const sf::Uint32 MATCH_PROTOCOL_MAGIC = 0x534E4B53; // "SNKS"
+
+struct MatchServerConfig {
+    unsigned short port = 47800;
+    unsigned threads = 0;          // шарды; 0 - по числу ядер
+    int playersPerMatch = 2;
+    int botsPerMatch = 4;
+    int cols = 48;
+    int rows = 27;
+    int tickMicros = 100000;
+    int wheelResolutionMicros = 500;
+    int keyframeTicks = 100;       // плановый ключевой кадр всем; 0 - только по потере
+    uint64_t seed = 1;
+};
+
+struct MatchSummary {
+    int id = 0;
+    int clients = 0;
+    uint64_t ticks = 0;
+    double jitterMean = 0.0;       // мкс
+    int64_t jitterP99 = 0;
+    int64_t jitterMax = 0;
+    int spectators = 0;
+};
+
+struct MatchServerReport {
+    int matches = 0;
+    int clients = 0;
+    int spectators = 0;
+    uint64_t ticks = 0;
+    uint64_t frameBytes = 0;       // отправленные кадры репликации вместе с заголовком
+    uint64_t keyframes = 0;
+    uint64_t deltas = 0;
+    Histogram jitter{ 250, 80 };   // опоздание тика относительно расписания, мкс
+    double busySeconds = 0.0;      // суммарное время работы шардов
+    double wallSeconds = 0.0;
+    std::vector<MatchSummary> matchList;
+
+    // Сколько таких матчей поместится на одно полностью загруженное ядро
+    double matchesPerCore() const {
+        return busySeconds > 0.0 ? matches * wallSeconds / busySeconds : 0.0;
+    }
+
+    double bytesPerClientTick() const {
+        uint64_t frames = keyframes + deltas;
+        return frames ? static_cast<double>(frameBytes) / frames : 0.0;
+    }
+};
+
+class MatchServer {
+private:
+    struct Client {
+        std::unique_ptr<sf::TcpSocket> socket;
+        int player = 0;            // SPECTATOR_PLAYER у зрителя
+        bool connected = true;
+        bool needsKeyframe = true; // первый кадр и любой после пропуска - ключевой
+        sf::Packet pending;        // недоотправленный пакет (Partial)
+        bool hasPending = false;
+
+        bool isPlayer() const { return player != SPECTATOR_PLAYER; }
+    };
+
+    struct Match {
+        int id;
+        Arena arena;
+        std::vector<Client> clients;
+        ArenaEncoder encoder;      // после arena: подписывается на её журнал предметов
+        BitWriter bits;
+        Histogram jitter{ 250, 80 };
+        uint64_t ticks = 0;
+        uint64_t frameBytes = 0;
+        uint64_t keyframes = 0;
+        uint64_t deltas = 0;
+
+        Match(int id, const MatchServerConfig& config)
+            : id(id), arena(config.cols, config.rows, config.playersPerMatch + config.botsPerMatch,
+                config.seed + static_cast<uint64_t>(id)), encoder(arena) {
+        }
+    };
+
+    struct Joining {
+        int matchId;
+        int player;                // SPECTATOR_PLAYER у зрителя
+        std::unique_ptr<sf::TcpSocket> socket;
+    };
+
+    struct Shard {
+        std::mutex mutex;          // matches и статистика; inbox - под ним же
+        std::vector<std::unique_ptr<Match>> matches; // локальный индекс = id таймера
+        std::vector<Joining> inbox;
+        TimerWheel wheel;
+        std::thread thread;
+        double busySeconds = 0.0;
+
+        Shard(int64_t resolution, int64_t start) : wheel(resolution, 512, start) {}
+    };
+
+    // Больше одновременных рукопожатий не берём: SocketSelector ограничен FD_SETSIZE
+    static const size_t MAX_HANDSHAKES = 48;
+    // Не приславший HELLO за это время отключается и освобождает место
+    static const int HANDSHAKE_TIMEOUT_MS = 3000;
+
+    struct Handshake {
+        std::unique_ptr<sf::TcpSocket> socket;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    MatchServerConfig config;
+    std::vector<std::unique_ptr<Shard>> shards;
+    sf::TcpListener listener;
+    std::atomic<bool> running{ false };
+    std::thread acceptThread;
+    int nextClient = 0;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point lastReport;
+
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    // true - пакет ушёл целиком; иначе он пропущен или ещё досылается
+    static bool sendTo(Client& client, const sf::Packet& packet) {
+        if (!client.connected) return false;
+        if (client.hasPending) {
+            // Досылаем хвост; пока он не ушёл целиком (Partial или NotReady),
+            // новый пакет слать нельзя - половина старого уже в потоке TCP
+            sf::Socket::Status status = client.socket->send(client.pending);
+            if (status == sf::Socket::Disconnected || status == sf::Socket::Error) {
+                client.connected = false;
+                return false;
+            }
+            if (status != sf::Socket::Done) return false;
+            client.hasPending = false;
+        }
+        client.pending = packet;
+        sf::Socket::Status status = client.socket->send(client.pending);
+        // NotReady - клиент не успевает, кадр пропускается: следующий его заменит
+        if (status == sf::Socket::Partial) client.hasPending = true;
+        else if (status == sf::Socket::Disconnected || status == sf::Socket::Error) client.connected = false;
+        return status == sf::Socket::Done;
+    }
+
+    void attach(Shard& shard, Joining& joining) {
+        size_t local = static_cast<size_t>(joining.matchId) / shards.size();
+        if (shard.matches.size() <= local) shard.matches.resize(local + 1);
+        if (!shard.matches[local]) {
+            shard.matches[local] = std::make_unique<Match>(joining.matchId, config);
+            shard.wheel.schedule(static_cast<int>(local), now() + config.tickMicros);
+        }
+        Match& match = *shard.matches[local];
+        if (joining.player != SPECTATOR_PLAYER) match.arena.setBot(joining.player, false);
+
+        Client client;
+        client.socket = std::move(joining.socket);
+        client.player = joining.player;
+        sf::Packet welcome;
+        welcome << static_cast<sf::Uint8>(MSG_WELCOME) << static_cast<sf::Int32>(match.id)
+            << static_cast<sf::Uint8>(joining.player) << static_cast<sf::Uint8>(match.arena.getSnakeCount())
+            << static_cast<sf::Uint16>(config.cols) << static_cast<sf::Uint16>(config.rows);
+        sendTo(client, welcome);
+        match.clients.push_back(std::move(client));
+    }
+
+    void tickMatch(Match& match, int64_t lateness) {
+        match.jitter.add(lateness);
+        ++match.ticks;
+        Arena& arena = match.arena;
+
+        sf::Packet packet;
+        for (Client& client : match.clients) {
+            if (client.connected && client.isPlayer()) {
+                sf::Socket::Status status;
+                while ((status = client.socket->receive(packet)) == sf::Socket::Done) {
+                    sf::Uint8 type, direction;
+                    if (packet >> type >> direction && type == MSG_INPUT && direction < 4) {
+                        arena.changeDirection(client.player, static_cast<Direction>(direction));
+                    }
+                }
+                if (status == sf::Socket::Disconnected || status == sf::Socket::Error) client.connected = false;
+            }
+            // Змейка ушедшего клиента доигрывает ботом
+            else if (client.isPlayer() && !client.connected) arena.setBot(client.player, true);
+        }
+
+        arena.step(true);
+        for (const Client& client : match.clients) {
+            if (client.connected && client.isPlayer() && !arena.getSnake(client.player).alive) arena.spawnSnake(client.player);
+        }
+
+        // Дельта нужна каждый тик - энкодер помнит отправленное; ключевой кадр
+        // строится только если он кому-то нужен
+        match.bits.clear();
+        match.encoder.writeDelta(match.bits);
+        packet.clear();
+        replication::packFrame(packet, MSG_DELTA, match.bits);
+        bool keyframeDue = config.keyframeTicks > 0 && arena.getTick() % static_cast<uint32_t>(config.keyframeTicks) == 0;
+        sf::Packet keyframe;
+        bool keyframeBuilt = false;
+        for (Client& client : match.clients) {
+            if (!client.connected) continue;
+            bool full = keyframeDue || client.needsKeyframe;
+            if (full && !keyframeBuilt) {
+                match.bits.clear();
+                match.encoder.writeKeyframe(match.bits);
+                replication::packFrame(keyframe, MSG_KEYFRAME, match.bits);
+                keyframeBuilt = true;
+            }
+            const sf::Packet& frame = full ? keyframe : packet;
+            client.needsKeyframe = !sendTo(client, frame);
+            if (client.needsKeyframe) continue;
+            match.frameBytes += frame.getDataSize();
+            ++(full ? match.keyframes : match.deltas);
+        }
+    }
+
+    void runShard(Shard& shard) {
+        std::vector<Joining> joining;
+        while (running) {
+            int64_t started = now();
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                joining.swap(shard.inbox);
+                for (Joining& entry : joining) attach(shard, entry);
+                joining.clear();
+
+                // Тик выполняется по сроку, следующий планируется от срока, а не от факта:
+                // опоздания не накапливаются
+                shard.wheel.advance(started, [&](int local, int64_t due) {
+                    tickMatch(*shard.matches[local], now() - due);
+                    shard.wheel.schedule(local, due + config.tickMicros);
+                    });
+            }
+            int64_t finished = now();
+            shard.busySeconds += (finished - started) / 1e6;
+
+            int64_t wake = std::min(shard.wheel.nextSlotTime(), finished + 5000);
+            if (wake > finished) sf::sleep(sf::microseconds(wake - finished));
+        }
+    }
+
+    void runAcceptor() {
+        sf::SocketSelector selector;
+        selector.add(listener);
+        bool listening = true;
+        std::vector<Handshake> handshaking;
+
+        while (running) {
+            // Мест нет - слушатель снимается с селектора: иначе он всё время
+            // готов, wait возвращается сразу, и поток крутится вхолостую
+            bool full = handshaking.size() >= MAX_HANDSHAKES;
+            if (full && listening) selector.remove(listener);
+            else if (!full && !listening) selector.add(listener);
+            listening = !full;
+
+            bool ready = selector.wait(sf::milliseconds(50));
+            auto current = std::chrono::steady_clock::now();
+            for (size_t i = handshaking.size(); i-- > 0;) {
+                if (current < handshaking[i].deadline) continue;
+                selector.remove(*handshaking[i].socket);
+                handshaking.erase(handshaking.begin() + i);
+            }
+            if (!ready) continue;
+
+            if (listening && selector.isReady(listener)) {
+                std::unique_ptr<sf::TcpSocket> socket = std::make_unique<sf::TcpSocket>();
+                if (listener.accept(*socket) == sf::Socket::Done) {
+                    // Сразу неблокирующий: иначе клиент, приславший полпакета HELLO,
+                    // подвесит receive, и до дедлайнов дело не дойдёт
+                    socket->setBlocking(false);
+                    selector.add(*socket);
+                    handshaking.push_back(Handshake{ std::move(socket), current + std::chrono::milliseconds(HANDSHAKE_TIMEOUT_MS) });
+                }
+            }
+
+            for (size_t i = handshaking.size(); i-- > 0;) {
+                sf::TcpSocket& socket = *handshaking[i].socket;
+                if (!selector.isReady(socket)) continue;
+                sf::Packet packet;
+                sf::Socket::Status status = socket.receive(packet);
+                if (status == sf::Socket::NotReady || status == sf::Socket::Partial) continue;
+
+                sf::Uint8 type = 0;
+                sf::Uint32 magic = 0;
+                sf::Uint8 role = ROLE_PLAYER;
+                sf::Int32 watch = 0;
+                selector.remove(socket);
+                if (status == sf::Socket::Done && packet >> type >> magic && type == MSG_HELLO && magic == MATCH_PROTOCOL_MAGIC) {
+                    if (!packet.endOfPacket() && !(packet >> role >> watch)) role = 0xFF;
+                    Joining entry;
+                    if (role == ROLE_PLAYER) {
+                        // Клиенты заполняют матчи по порядку подключения
+                        int index = nextClient++;
+                        entry.matchId = index / config.playersPerMatch;
+                        entry.player = index % config.playersPerMatch;
+                    }
+                    else if (role == ROLE_SPECTATOR && watch >= 0 && nextClient > 0 && watch <= (nextClient - 1) / config.playersPerMatch) {
+                        // Смотреть можно только матч, в который уже кто-то назначен
+                        entry.matchId = watch;
+                        entry.player = SPECTATOR_PLAYER;
+                    }
+                    else {
+                        handshaking.erase(handshaking.begin() + i);
+                        continue;
+                    }
+                    entry.socket = std::move(handshaking[i].socket);
+                    Shard& shard = *shards[static_cast<size_t>(entry.matchId) % shards.size()];
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    shard.inbox.push_back(std::move(entry));
+                }
+                handshaking.erase(handshaking.begin() + i);
+            }
+        }
+    }
+
+public:
+    explicit MatchServer(const MatchServerConfig& config) : config(config) {
+        this->config.playersPerMatch = std::max(1, std::min(config.playersPerMatch, 16));
+        if (this->config.threads == 0) this->config.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    ~MatchServer() { stop(); }
+
+    bool start() {
+        if (listener.listen(config.port) != sf::Socket::Done) return false;
+        startTime = std::chrono::steady_clock::now();
+        lastReport = startTime;
+        running = true;
+        for (unsigned i = 0; i < config.threads; ++i) {
+            shards.push_back(std::make_unique<Shard>(config.wheelResolutionMicros, 0));
+        }
+        for (auto& shard : shards) {
+            Shard* raw = shard.get();
+            raw->thread = std::thread([this, raw] { runShard(*raw); });
+        }
+        acceptThread = std::thread([this] { runAcceptor(); });
+        return true;
+    }
+
+    void stop() {
+        if (!running) return;
+        running = false;
+        if (acceptThread.joinable()) acceptThread.join();
+        for (auto& shard : shards) {
+            if (shard->thread.joinable()) shard->thread.join();
+        }
+        listener.close();
+    }
+
+    // Снимок статистики; сбрасывает накопленное, чтобы отчёты шли по интервалам
+    MatchServerReport report(bool resetStats = true) {
+        MatchServerReport result;
+        auto current = std::chrono::steady_clock::now();
+        result.wallSeconds = std::chrono::duration<double>(current - lastReport).count();
+        if (resetStats) lastReport = current;
+
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            result.busySeconds += shard->busySeconds;
+            if (resetStats) shard->busySeconds = 0.0;
+            for (auto& match : shard->matches) {
+                if (!match) continue;
+                MatchSummary summary;
+                summary.id = match->id;
+                for (const Client& client : match->clients) {
+                    if (!client.connected) continue;
+                    ++(client.isPlayer() ? summary.clients : summary.spectators);
+                }
+                summary.ticks = match->ticks;
+                summary.jitterMean = match->jitter.mean();
+                summary.jitterP99 = match->jitter.percentile(0.99);
+                summary.jitterMax = match->jitter.count ? match->jitter.maxValue : 0;
+                result.matchList.push_back(summary);
+                result.jitter.merge(match->jitter);
+                result.ticks += match->ticks;
+                result.clients += summary.clients;
+                result.spectators += summary.spectators;
+                result.frameBytes += match->frameBytes;
+                result.keyframes += match->keyframes;
+                result.deltas += match->deltas;
+                ++result.matches;
+                if (resetStats) {
+                    match->jitter = Histogram(250, 80);
+                    match->ticks = 0;
+                    match->frameBytes = 0;
+                    match->keyframes = 0;
+                    match->deltas = 0;
+                }
+            }
+        }
+        return result;
+    }
+
+    const MatchServerConfig& getConfig() const { return config; }
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+// Хранение паролей: PBKDF2-HMAC-SHA256 с солью, всё своё, без внешних библиотек.
+// Запись в users.txt вместо пароля: "pbkdf2$<итерации>$<соль hex>$<хэш hex>".
+// Число итераций хранится в записи, поэтому его можно менять в settings.cfg,
+// не ломая старые записи: при входе запись со старой ценой пересчитывается.
+// Строка без префикса - пароль открытым текстом из старых версий.
+namespace credentials {
+
+const int DEFAULT_ITERATIONS = 200000;
+const int MIN_ITERATIONS = 1000;
+const int MAX_ITERATIONS = 10000000;
+const size_t SALT_BYTES = 16;
+const size_t HASH_BYTES = 32;
+
+class Sha256 {
+private:
+    uint32_t state[8];
+    uint8_t block[64];
+    size_t blockSize = 0;
+    uint64_t length = 0;
+
+    static uint32_t rotate(uint32_t value, int bits) { return (value >> bits) | (value << (32 - bits)); }
+
+    void compress(const uint8_t* data) {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (static_cast<uint32_t>(data[i * 4]) << 24) | (static_cast<uint32_t>(data[i * 4 + 1]) << 16) |
+                (static_cast<uint32_t>(data[i * 4 + 2]) << 8) | data[i * 4 + 3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+
+public:
+    Sha256() {
+        static const uint32_t INITIAL[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        std::memcpy(state, INITIAL, sizeof(state));
+    }
+
+    void update(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        length += size;
+        if (blockSize > 0) {
+            size_t take = size < 64 - blockSize ? size : 64 - blockSize;
+            std::memcpy(block + blockSize, bytes, take);
+            blockSize += take;
+            bytes += take;
+            size -= take;
+            if (blockSize < 64) return;
+            compress(block);
+            blockSize = 0;
+        }
+        for (; size >= 64; bytes += 64, size -= 64) compress(bytes);
+        std::memcpy(block, bytes, size);
+        blockSize = size;
+    }
+
+    void finish(uint8_t digest[HASH_BYTES]) {
+        uint64_t bits = length * 8;
+        uint8_t padding[72] = { 0x80 };
+        size_t padSize = (blockSize < 56 ? 56 : 120) - blockSize;
+        for (int i = 0; i < 8; ++i) padding[padSize + i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+        update(padding, padSize + 8);
+        for (int i = 0; i < 8; ++i) {
+            digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+        }
+    }
+};
+
+// HMAC с ключом, разобранным один раз: состояния после ipad/opad копируются
+// на каждый вызов, так что итерация PBKDF2 стоит ровно два сжатия SHA-256
+class HmacSha256 {
+private:
+    Sha256 inner;
+    Sha256 outer;
+
+public:
+    HmacSha256(const void* key, size_t keySize) {
+        uint8_t padded[64] = {};
+        if (keySize > 64) {
+            Sha256 hash;
+            hash.update(key, keySize);
+            hash.finish(padded);
+        }
+        else {
+            std::memcpy(padded, key, keySize);
+        }
+        uint8_t pad[64];
+        for (int i = 0; i < 64; ++i) pad[i] = padded[i] ^ 0x36;
+        inner.update(pad, 64);
+        for (int i = 0; i < 64; ++i) pad[i] = padded[i] ^ 0x5c;
+        outer.update(pad, 64);
+    }
+
+    void compute(const void* data, size_t size, uint8_t mac[HASH_BYTES]) const {
+        Sha256 hash = inner;
+        hash.update(data, size);
+        uint8_t digest[HASH_BYTES];
+        hash.finish(digest);
+        hash = outer;
+        hash.update(digest, HASH_BYTES);
+        hash.finish(mac);
+    }
+};
+
+// PBKDF2-HMAC-SHA256, один блок выхода (32 байта)
+inline void pbkdf2(const std::string& password, const uint8_t* salt, size_t saltSize, int iterations,
+    uint8_t output[HASH_BYTES]) {
+    HmacSha256 hmac(password.data(), password.size());
+    std::string first(reinterpret_cast<const char*>(salt), saltSize);
+    first.append("\0\0\0\1", 4);
+    uint8_t u[HASH_BYTES];
+    hmac.compute(first.data(), first.size(), u);
+    std::memcpy(output, u, HASH_BYTES);
+    for (int i = 1; i < iterations; ++i) {
+        hmac.compute(u, HASH_BYTES, u);
+        for (size_t k = 0; k < HASH_BYTES; ++k) output[k] ^= u[k];
+    }
+}
+
+inline std::string toHex(const uint8_t* data, size_t size) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string text;
+    for (size_t i = 0; i < size; ++i) {
+        text += DIGITS[data[i] >> 4];
+        text += DIGITS[data[i] & 15];
+    }
+    return text;
+}
+
+inline bool fromHex(const std::string& text, uint8_t* data, size_t size) {
+    if (text.size() != size * 2) return false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (digit < 0) return false;
+        data[i / 2] = static_cast<uint8_t>(i % 2 == 0 ? digit << 4 : data[i / 2] | digit);
+    }
+    return true;
+}
+
+// Сравнение без раннего выхода: время не зависит от места первого расхождения
+inline bool equalBytes(const void* a, const void* b, size_t size) {
+    const uint8_t* x = static_cast<const uint8_t*>(a);
+    const uint8_t* y = static_cast<const uint8_t*>(b);
+    uint8_t difference = 0;
+    for (size_t i = 0; i < size; ++i) difference |= x[i] ^ y[i];
+    return difference == 0;
+}
+
+inline int clampIterations(int iterations) {
+    return iterations < MIN_ITERATIONS ? MIN_ITERATIONS : iterations > MAX_ITERATIONS ? MAX_ITERATIONS : iterations;
+}
+
+inline std::string makeRecord(const std::string& password, int iterations) {
+    iterations = clampIterations(iterations);
+    static thread_local std::random_device device;
+    uint8_t salt[SALT_BYTES];
+    for (size_t i = 0; i < SALT_BYTES; i += 4) {
+        uint32_t value = device();
+        std::memcpy(salt + i, &value, 4);
+    }
+    uint8_t hash[HASH_BYTES];
+    pbkdf2(password, salt, SALT_BYTES, iterations, hash);
+    return "pbkdf2$" + std::to_string(iterations) + "$" + toHex(salt, SALT_BYTES) + "$" + toHex(hash, HASH_BYTES);
+}
+
+// Итерации из записи; 0 - запись открытым текстом или испорчена
+inline int recordIterations(const std::string& record) {
+    if (record.compare(0, 7, "pbkdf2$") != 0) return 0;
+    int iterations = std::atoi(record.c_str() + 7);
+    return iterations >= MIN_ITERATIONS && iterations <= MAX_ITERATIONS ? iterations : 0;
+}
+
+inline bool verifyRecord(const std::string& record, const std::string& password) {
+    if (record.compare(0, 7, "pbkdf2$") != 0) {
+        return record.size() == password.size() && equalBytes(record.data(), password.data(), record.size());
+    }
+    int iterations = recordIterations(record);
+    size_t saltStart = record.find('$', 7);
+    size_t hashStart = saltStart == std::string::npos ? std::string::npos : record.find('$', saltStart + 1);
+    uint8_t salt[SALT_BYTES];
+    uint8_t expected[HASH_BYTES];
+    if (iterations == 0 || hashStart == std::string::npos ||
+        !fromHex(record.substr(saltStart + 1, hashStart - saltStart - 1), salt, SALT_BYTES) ||
+        !fromHex(record.substr(hashStart + 1), expected, HASH_BYTES)) {
+        return false;
+    }
+    uint8_t hash[HASH_BYTES];
+    pbkdf2(password, salt, SALT_BYTES, iterations, hash);
+    return equalBytes(hash, expected, HASH_BYTES);
+}
+
+// Запись надо пересчитать: открытый текст или цена отличается от текущей
+inline bool needsRehash(const std::string& record, int iterations) {
+    return recordIterations(record) != clampIterations(iterations);
+}
+
+}
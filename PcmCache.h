@@ -0,0 +1,250 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include "MappedFile.h"
+#include "PersistenceWorker.h"
+
+// Кэш декодированной музыки: .ogg декодируется один раз, 16-битный PCM с
+// частотой SAMPLE_RATE ложится в <каталог>/<имя>.pcm и дальше отображается
+// в память, так что ни старт, ни перезапуск дорожки не платят за Vorbis.
+// Ключ - хэш байтов исходника: поменялся файл (или его копия в пакете) -
+// кэш пересобирается сам. Короткие дорожки (до memoryLimit байт PCM, например
+// GameOver.ogg) копируются в память, и копия общая для всех, кто её сейчас
+// играет. Кэш держит её только слабой ссылкой: байты считает открытый поток
+// (бюджет загрузчика), а с последним потоком уходит и копия. Одну дорожку
+// строит один поток за раз, остальные ждут и берут готовое.
+//
+// Файл: PcmCacheHeader, затем выборки int16, каналы чередуются.
+
+struct PcmCacheHeader {
+    char magic[4];          // "SNKA"
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint64_t samples;       // всех каналов
+};
+
+static_assert(sizeof(PcmCacheHeader) == 32, "pcm cache header layout is part of the file format");
+
+// Декодированная дорожка: выборки в отображении файла кэша или в памяти
+struct PcmTrack {
+    std::shared_ptr<MappedFile> mapping;
+    std::shared_ptr<const std::vector<int16_t>> memory;
+    const int16_t* samples = nullptr;
+    size_t sampleCount = 0;     // всех каналов
+    unsigned int sampleRate = 0;
+    unsigned int channels = 0;
+};
+
+class PcmCache {
+public:
+    // Декодер исходника: выборки int16 с чередованием каналов, частота и число каналов
+    using Decoder = std::function<bool(const void* source, size_t size, std::vector<int16_t>& samples,
+        unsigned int& sampleRate, unsigned int& channels)>;
+
+    static const unsigned int SAMPLE_RATE = 44100;
+
+private:
+    static const uint32_t VERSION = 1;
+
+    // Дорожка по имени; поля под build, а не под общим mutex
+    struct Entry {
+        std::mutex build;
+        uint64_t hash = 0;
+        std::weak_ptr<const std::vector<int16_t>> samples;
+        unsigned int channels = 0;
+    };
+
+    std::string directory;
+    size_t memoryLimit;
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> tracks; // узлы не переезжают, Entry* живёт с кэшем
+    size_t memoryHits = 0;
+    size_t diskHits = 0;
+    size_t decodes = 0;
+    double decodeMs = 0.0;
+
+    static PcmTrack fromMemory(std::shared_ptr<const std::vector<int16_t>> samples, unsigned int channels) {
+        PcmTrack track;
+        track.samples = samples->data();
+        track.sampleCount = samples->size();
+        track.sampleRate = SAMPLE_RATE;
+        track.channels = channels;
+        track.memory = std::move(samples);
+        return track;
+    }
+
+    std::string pathFor(const std::string& name) const {
+        std::string file = name;
+        for (char& c : file) {
+            if (c == '/' || c == '\\' || c == ':' || c == '.') c = '_';
+        }
+        return directory + "/" + file + ".pcm";
+    }
+
+    // Отображение кэша, если он сделан из этого исходника и цел
+    static bool openCached(const std::string& path, uint64_t hash, std::shared_ptr<MappedFile>& mapping, PcmTrack& track) {
+        mapping = std::make_shared<MappedFile>();
+        if (!mapping->open(path) || mapping->size() < sizeof(PcmCacheHeader)) return false;
+        const PcmCacheHeader* header = reinterpret_cast<const PcmCacheHeader*>(mapping->data());
+        if (std::memcmp(header->magic, "SNKA", 4) != 0 || header->version != VERSION || header->sourceHash != hash ||
+            header->sampleRate != SAMPLE_RATE || header->channels == 0 || header->channels > 8 ||
+            mapping->size() != sizeof(PcmCacheHeader) + header->samples * sizeof(int16_t)) {
+            return false;
+        }
+        track.samples = reinterpret_cast<const int16_t*>(mapping->data() + sizeof(PcmCacheHeader));
+        track.sampleCount = static_cast<size_t>(header->samples);
+        track.sampleRate = SAMPLE_RATE;
+        track.channels = header->channels;
+        track.mapping = mapping;
+        return true;
+    }
+
+public:
+    // memoryLimit - дорожки с PCM не больше стольких байт живут в памяти
+    explicit PcmCache(const std::string& directory, size_t memoryLimit = 4u << 20)
+        : directory(directory), memoryLimit(memoryLimit) {}
+
+    PcmCache(const PcmCache&) = delete;
+    PcmCache& operator=(const PcmCache&) = delete;
+
+    // 64-битный FNV-1a по словам: сотни МБ/с, на ogg в несколько МБ - миллисекунды
+    static uint64_t hashBytes(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = 1469598103934665603ull ^ size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        for (; i < size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    // Линейная интерполяция к SAMPLE_RATE; для музыки меню этого достаточно
+    static std::vector<int16_t> resample(const std::vector<int16_t>& input, unsigned int rate, unsigned int channels) {
+        if (rate == SAMPLE_RATE || channels == 0 || input.empty()) return input;
+        size_t frames = input.size() / channels;
+        size_t outFrames = static_cast<size_t>(static_cast<uint64_t>(frames) * SAMPLE_RATE / rate);
+        std::vector<int16_t> output(outFrames * channels);
+        for (size_t frame = 0; frame < outFrames; ++frame) {
+            double position = static_cast<double>(frame) * rate / SAMPLE_RATE;
+            size_t left = static_cast<size_t>(position);
+            size_t right = left + 1 < frames ? left + 1 : left;
+            double weight = position - left;
+            for (unsigned int c = 0; c < channels; ++c) {
+                double value = input[left * channels + c] * (1.0 - weight) + input[right * channels + c] * weight;
+                output[frame * channels + c] = static_cast<int16_t>(value);
+            }
+        }
+        return output;
+    }
+
+    // PCM дорожки name (путь исходника) по байтам исходника. Зовётся из потоков
+    // загрузчика. false - декодер не справился
+    bool get(const std::string& name, const void* source, size_t size, const Decoder& decode, PcmTrack& track) {
+        uint64_t hash = hashBytes(source, size);
+        Entry* entry;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entry = &tracks[name];
+        }
+        // Второй поток с той же дорожкой ждёт здесь, а не пишет <имя>.pcm.tmp вместе с первым
+        std::lock_guard<std::mutex> building(entry->build);
+        if (entry->hash == hash) {
+            if (std::shared_ptr<const std::vector<int16_t>> samples = entry->samples.lock()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++memoryHits;
+                track = fromMemory(std::move(samples), entry->channels);
+                return true;
+            }
+        }
+
+        std::string path = pathFor(name);
+        std::shared_ptr<MappedFile> mapping;
+        if (openCached(path, hash, mapping, track)) {
+            if (track.sampleCount * sizeof(int16_t) <= memoryLimit) {
+                auto copy = std::make_shared<const std::vector<int16_t>>(track.samples, track.samples + track.sampleCount);
+                entry->hash = hash;
+                entry->samples = copy;
+                entry->channels = track.channels;
+                track = fromMemory(std::move(copy), track.channels);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            ++diskHits;
+            return true;
+        }
+        mapping.reset();
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<int16_t> decoded;
+        unsigned int rate = 0;
+        unsigned int channels = 0;
+        if (!decode(source, size, decoded, rate, channels) || channels == 0 || rate == 0) return false;
+        decoded = resample(decoded, rate, channels);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        PcmCacheHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "SNKA", 4);
+        header.version = VERSION;
+        header.sourceHash = hash;
+        header.sampleRate = SAMPLE_RATE;
+        header.channels = channels;
+        header.samples = decoded.size();
+        std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+        contents.append(reinterpret_cast<const char*>(decoded.data()), decoded.size() * sizeof(int16_t));
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        bool written = PersistenceWorker::commitFile(path, contents);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++decodes;
+            decodeMs += ms;
+        }
+        // Длинную дорожку отдаём отображением только что записанного файла;
+        // не записалось (каталог только для чтения) - из памяти
+        if (written && decoded.size() * sizeof(int16_t) > memoryLimit && openCached(path, hash, mapping, track)) return true;
+        auto samples = std::make_shared<const std::vector<int16_t>>(std::move(decoded));
+        entry->hash = hash;
+        entry->samples = samples;
+        entry->channels = channels;
+        track = fromMemory(std::move(samples), channels);
+        return true;
+    }
+
+    size_t getMemoryHits() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return memoryHits;
+    }
+
+    size_t getDiskHits() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return diskHits;
+    }
+
+    size_t getDecodes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return decodes;
+    }
+
+    void printReport(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        out << "PCM cache: " << memoryHits << " memory hits, " << diskHits << " disk hits, " << decodes
+            << " decodes (" << std::fixed << std::setprecision(1) << decodeMs << " ms)" << std::endl;
+    }
+};
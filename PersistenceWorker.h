@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Фоновая запись файлов, чтобы поток отрисовки не ждал диск.
+// Запросы копятся по пути: новая полная запись заменяет ещё не выполненную,
+// дозаписи склеиваются в одну. Полная запись идёт во временный файл и
+// подменяет старый переименованием - при падении остаётся целая старая или
+// целая новая версия. flush() ждёт все запросы, поданные до вызова.
+// Данные пишутся байт в байт (двоичный режим) - годится и для двоичных файлов.
+class PersistenceWorker {
+private:
+    struct Pending {
+        bool replace = false;  // true - data это всё содержимое файла
+        std::string data;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::map<std::string, Pending> pending;
+    std::vector<std::string> order;  // пути в порядке первого запроса
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    bool stopping = false;
+    std::atomic<uint64_t> commits{ 0 };
+    std::atomic<uint64_t> coalesced{ 0 };
+    std::atomic<uint64_t> failures{ 0 };
+    std::thread thread;              // последним: стартует, когда остальное готово
+
+    Pending& slot(const std::string& path) {
+        auto it = pending.find(path);
+        if (it != pending.end()) {
+            ++coalesced;
+            return it->second;
+        }
+        order.push_back(path);
+        return pending[path];
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::map<std::string, Pending> batch;
+        std::vector<std::string> batchOrder;
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || !order.empty(); });
+            if (order.empty()) return;
+            batch.swap(pending);
+            batchOrder.swap(order);
+            uint64_t upTo = submitted;
+            lock.unlock();
+
+            for (const std::string& path : batchOrder) {
+                const Pending& request = batch[path];
+                bool ok = request.replace ? commitFile(path, request.data) : appendFile(path, request.data);
+                ++(ok ? commits : failures);
+            }
+            batch.clear();
+            batchOrder.clear();
+
+            lock.lock();
+            completed = upTo;
+            done.notify_all();
+        }
+    }
+
+public:
+    PersistenceWorker() : thread([this] { run(); }) {}
+
+    ~PersistenceWorker() {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    PersistenceWorker(const PersistenceWorker&) = delete;
+    PersistenceWorker& operator=(const PersistenceWorker&) = delete;
+
+    // Полностью заменить содержимое файла
+    void write(const std::string& path, std::string contents) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Pending& request = slot(path);
+            request.replace = true;
+            request.data = std::move(contents);
+            ++submitted;
+        }
+        wake.notify_one();
+    }
+
+    // Дописать в конец; после ещё не выполненной write - в конец её содержимого
+    void append(const std::string& path, const std::string& text) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot(path).data += text;
+            ++submitted;
+        }
+        wake.notify_one();
+    }
+
+    // Барьер: возвращается, когда всё поданное до вызова лежит на диске
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t target = submitted;
+        done.wait(lock, [this, target] { return completed >= target; });
+    }
+
+    uint64_t getCommits() const { return commits; }
+    uint64_t getCoalesced() const { return coalesced; }
+    uint64_t getFailures() const { return failures; }
+
+    // Синхронная запись через временный файл; пригодна и без рабочего потока
+    static bool commitFile(const std::string& path, const std::string& contents) {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) return false;
+            file << contents;
+            file.flush();
+            if (!file) return false;
+        }
+        // filesystem::rename заменяет существующий файл и на Windows
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        return !error;
+    }
+
+    static bool appendFile(const std::string& path, const std::string& text) {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        if (!file.is_open()) return false;
+        file << text;
+        file.flush();
+        return static_cast<bool>(file);
+    }
+};
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <SFML/Network/Packet.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+#include "Arena.h"
+#include "BitStream.h"
+
+// Репликация состояния арены для удалённых клиентов и зрителей.
+// За тик змейка только добавляет голову и теряет хвост, поэтому дельта тика -
+// 2 бита кода на змейку плюс направление и число снятых с хвоста клеток,
+// изменения счёта и предметов. Ключевой кадр содержит всё состояние
+// (тела цепочкой направлений) и нужен при подключении и после пропуска дельты.
+//
+// Кадр в sf::Packet: тип сообщения (Uint8), длина (Uint32), упакованные биты.
+
+namespace replication {
+
+enum SnakeCode {
+    SNAKE_SAME = 0,
+    SNAKE_MOVED = 1,
+    SNAKE_DIED = 2,
+    SNAKE_FULL = 3   // появилась или возродилась: тело целиком
+};
+
+inline int bitsFor(int maxValue) {
+    int bits = 1;
+    while ((1 << bits) <= maxValue) ++bits;
+    return bits;
+}
+
+inline int32_t stepCell(int32_t cell, int direction) {
+    int x = Arena::cellX(cell);
+    int y = Arena::cellY(cell);
+    switch (direction) {
+    case UP: --y; break;
+    case DOWN: ++y; break;
+    case LEFT: --x; break;
+    default: ++x; break;
+    }
+    return Arena::cellId(x, y);
+}
+
+// Направление между соседними клетками
+inline int directionBetween(int32_t from, int32_t to) {
+    int dx = Arena::cellX(to) - Arena::cellX(from);
+    int dy = Arena::cellY(to) - Arena::cellY(from);
+    if (dy < 0) return UP;
+    if (dy > 0) return DOWN;
+    if (dx < 0) return LEFT;
+    return RIGHT;
+}
+
+inline void packFrame(sf::Packet& packet, sf::Uint8 type, BitWriter& bits) {
+    const std::vector<uint8_t>& bytes = bits.finish();
+    packet << type << static_cast<sf::Uint32>(bytes.size());
+    if (!bytes.empty()) packet.append(bytes.data(), bytes.size());
+}
+
+// Разбирает заголовок кадра; payload указывает внутрь пакета
+inline bool unpackFrame(const sf::Packet& packet, sf::Uint8& type, const uint8_t*& payload, size_t& size) {
+    const uint8_t* data = static_cast<const uint8_t*>(packet.getData());
+    if (packet.getDataSize() < 5) return false;
+    type = data[0];
+    size = (static_cast<size_t>(data[1]) << 24) | (static_cast<size_t>(data[2]) << 16) |
+        (static_cast<size_t>(data[3]) << 8) | data[4];
+    if (packet.getDataSize() - 5 < size) return false;
+    payload = data + 5;
+    return true;
+}
+
+} // namespace replication
+
+// Серверная сторона: помнит, что уже отправлено, и кодирует разницу.
+// writeDelta вызывается ровно один раз после каждого тика арены;
+// writeKeyframe - когда угодно после writeDelta этого тика.
+class ArenaEncoder {
+private:
+    struct Known {
+        bool alive = false;
+        int32_t head = 0;
+        size_t length = 0;
+        int score = 0;
+        uint32_t spawns = 0;
+    };
+
+    Arena& arena;
+    int xBits;
+    int yBits;
+    std::vector<Known> known;
+    std::vector<int32_t> itemLog;
+    std::map<int32_t, uint8_t> items; // упорядочены по клетке - кадр однозначен
+
+    void writeCell(BitWriter& out, int32_t cell) const {
+        out.write(static_cast<uint32_t>(Arena::cellX(cell)), xBits);
+        out.write(static_cast<uint32_t>(Arena::cellY(cell)), yBits);
+    }
+
+    void writeBody(BitWriter& out, const Arena::ArenaSnake& snake) const {
+        out.writeVarint(static_cast<uint32_t>(snake.body.size()), 4);
+        writeCell(out, snake.body.front());
+        for (size_t i = 1; i < snake.body.size(); ++i) {
+            out.write(static_cast<uint32_t>(replication::directionBetween(snake.body[i - 1], snake.body[i])), 2);
+        }
+    }
+
+    static Known snapshot(const Arena::ArenaSnake& snake) {
+        Known state;
+        state.alive = snake.alive;
+        state.head = snake.alive ? snake.body.front() : 0;
+        state.length = snake.body.size();
+        state.score = snake.score;
+        state.spawns = snake.spawns;
+        return state;
+    }
+
+public:
+    explicit ArenaEncoder(Arena& arena)
+        : arena(arena), xBits(replication::bitsFor(arena.getCols() - 1)), yBits(replication::bitsFor(arena.getRows() - 1)) {
+        arena.setItemLog(&itemLog);
+        arena.getGrid().forEachChunk(0, 0, arena.getCols(), arena.getRows(),
+            [this](int originX, int originY, const ChunkedGrid<Arena::CellState>::Chunk& chunk) {
+                typedef ChunkedGrid<Arena::CellState> Grid;
+                for (int i = 0; i < Grid::CHUNK_CELLS; ++i) {
+                    if (chunk.cells[i].item == Arena::ITEM_NONE) continue;
+                    items[Arena::cellId(originX + (i & Grid::CHUNK_MASK), originY + (i >> Grid::CHUNK_SHIFT))] = chunk.cells[i].item;
+                }
+            });
+        for (int id = 0; id < arena.getSnakeCount(); ++id) known.push_back(snapshot(arena.getSnake(id)));
+    }
+
+    ~ArenaEncoder() { arena.setItemLog(nullptr); }
+
+    ArenaEncoder(const ArenaEncoder&) = delete;
+    ArenaEncoder& operator=(const ArenaEncoder&) = delete;
+
+    void writeKeyframe(BitWriter& out) const {
+        out.write(arena.getTick(), 32);
+        out.writeVarint(static_cast<uint32_t>(arena.getSnakeCount()), 4);
+        for (int id = 0; id < arena.getSnakeCount(); ++id) {
+            const Arena::ArenaSnake& snake = arena.getSnake(id);
+            out.writeBit(snake.alive);
+            if (snake.alive) writeBody(out, snake);
+            out.writeSigned(snake.score, 4);
+        }
+        out.writeVarint(static_cast<uint32_t>(items.size()), 6);
+        for (const auto& item : items) {
+            writeCell(out, item.first);
+            out.write(item.second, 2);
+        }
+    }
+
+    void writeDelta(BitWriter& out) {
+        out.write(arena.getTick(), 32);
+        for (int id = 0; id < arena.getSnakeCount(); ++id) {
+            const Arena::ArenaSnake& snake = arena.getSnake(id);
+            Known& last = known[id];
+            if (snake.alive && (!last.alive || snake.spawns != last.spawns)) {
+                out.write(replication::SNAKE_FULL, 2);
+                writeBody(out, snake);
+            }
+            else if (!snake.alive && last.alive) {
+                out.write(replication::SNAKE_DIED, 2);
+            }
+            else if (snake.alive && snake.body.front() != last.head) {
+                out.write(replication::SNAKE_MOVED, 2);
+                out.write(static_cast<uint32_t>(replication::directionBetween(last.head, snake.body.front())), 2);
+                out.writeVarint(static_cast<uint32_t>(last.length + 1 - snake.body.size()), 1);
+            }
+            else {
+                out.write(replication::SNAKE_SAME, 2);
+            }
+            out.writeBit(snake.score != last.score);
+            if (snake.score != last.score) out.writeSigned(snake.score - last.score, 3);
+            last = snapshot(snake);
+        }
+
+        // Клетка могла меняться в тике несколько раз - в кадр идёт только итог
+        std::sort(itemLog.begin(), itemLog.end());
+        itemLog.erase(std::unique(itemLog.begin(), itemLog.end()), itemLog.end());
+        std::vector<int32_t> cleared;
+        std::vector<int32_t> placed;
+        for (int32_t cell : itemLog) {
+            uint8_t now = arena.getCell(Arena::cellX(cell), Arena::cellY(cell)).item;
+            auto it = items.find(cell);
+            uint8_t before = it == items.end() ? Arena::ITEM_NONE : it->second;
+            if (now == before) continue;
+            if (now == Arena::ITEM_NONE) {
+                cleared.push_back(cell);
+                items.erase(it);
+            }
+            else {
+                placed.push_back(cell);
+                items[cell] = now;
+            }
+        }
+        itemLog.clear();
+
+        out.writeVarint(static_cast<uint32_t>(cleared.size()), 3);
+        for (int32_t cell : cleared) writeCell(out, cell);
+        out.writeVarint(static_cast<uint32_t>(placed.size()), 3);
+        for (int32_t cell : placed) {
+            writeCell(out, cell);
+            out.write(items[cell], 2);
+        }
+    }
+};
+
+// Клиентская сторона: восстанавливает состояние из кадров
+class ArenaReplica {
+public:
+    struct Snake {
+        std::deque<int32_t> body;
+        bool alive = false;
+        int score = 0;
+    };
+
+private:
+    int xBits;
+    int yBits;
+    uint32_t tick = 0;
+    bool synced = false;
+    std::vector<Snake> snakes;
+    std::map<int32_t, uint8_t> items;
+
+    int32_t readCell(BitReader& in) const {
+        int x = static_cast<int>(in.read(xBits));
+        int y = static_cast<int>(in.read(yBits));
+        return Arena::cellId(x, y);
+    }
+
+    void readBody(BitReader& in, Snake& snake) const {
+        uint32_t length = in.readVarint(4);
+        snake.body.clear();
+        snake.body.push_back(readCell(in));
+        for (uint32_t i = 1; i < length && in.ok(); ++i) {
+            snake.body.push_back(replication::stepCell(snake.body.back(), static_cast<int>(in.read(2))));
+        }
+        snake.alive = true;
+    }
+
+public:
+    ArenaReplica(int cols, int rows)
+        : xBits(replication::bitsFor(cols - 1)), yBits(replication::bitsFor(rows - 1)) {
+    }
+
+    bool readKeyframe(BitReader& in) {
+        tick = in.read(32);
+        uint32_t count = in.readVarint(4);
+        if (!in.ok() || count > 65535) return synced = false;
+        snakes.assign(count, Snake());
+        for (Snake& snake : snakes) {
+            if (in.readBit()) readBody(in, snake);
+            snake.score = in.readSigned(4);
+        }
+        items.clear();
+        uint32_t itemCount = in.readVarint(6);
+        for (uint32_t i = 0; i < itemCount && in.ok(); ++i) {
+            int32_t cell = readCell(in);
+            items[cell] = static_cast<uint8_t>(in.read(2));
+        }
+        return synced = in.ok();
+    }
+
+    // false - дельта не к текущему состоянию (пропуск или порча); ждём ключевой кадр
+    bool readDelta(BitReader& in) {
+        uint32_t frameTick = in.read(32);
+        if (!synced || frameTick != tick + 1) return synced = false;
+        tick = frameTick;
+        for (Snake& snake : snakes) {
+            switch (in.read(2)) {
+            case replication::SNAKE_FULL:
+                readBody(in, snake);
+                break;
+            case replication::SNAKE_DIED:
+                snake.alive = false;
+                snake.body.clear();
+                break;
+            case replication::SNAKE_MOVED: {
+                int direction = static_cast<int>(in.read(2));
+                uint32_t pops = in.readVarint(1);
+                if (snake.body.empty() || pops > snake.body.size()) return synced = false;
+                snake.body.push_front(replication::stepCell(snake.body.front(), direction));
+                for (uint32_t i = 0; i < pops; ++i) snake.body.pop_back();
+                break;
+            }
+            default:
+                break;
+            }
+            if (in.readBit()) snake.score += in.readSigned(3);
+        }
+        uint32_t cleared = in.readVarint(3);
+        for (uint32_t i = 0; i < cleared && in.ok(); ++i) items.erase(readCell(in));
+        uint32_t placed = in.readVarint(3);
+        for (uint32_t i = 0; i < placed && in.ok(); ++i) {
+            int32_t cell = readCell(in);
+            items[cell] = static_cast<uint8_t>(in.read(2));
+        }
+        return synced = in.ok();
+    }
+
+    // Побитовая сверка с авторитетным состоянием
+    bool matches(const Arena& arena) const {
+        if (!synced || tick != arena.getTick() || static_cast<int>(snakes.size()) != arena.getSnakeCount()) return false;
+        for (int id = 0; id < arena.getSnakeCount(); ++id) {
+            const Arena::ArenaSnake& snake = arena.getSnake(id);
+            const Snake& copy = snakes[id];
+            if (copy.alive != snake.alive || copy.score != snake.score || copy.body != snake.body) return false;
+        }
+        if (static_cast<int>(items.size()) != arena.getItemCount()) return false;
+        for (const auto& item : items) {
+            if (arena.getCell(Arena::cellX(item.first), Arena::cellY(item.first)).item != item.second) return false;
+        }
+        return true;
+    }
+
+    bool isSynced() const { return synced; }
+    uint32_t getTick() const { return tick; }
+    const std::vector<Snake>& getSnakes() const { return snakes; }
+    const std::map<int32_t, uint8_t>& getItems() const { return items; }
+};
@@ -0,0 +1,570 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MappedFile.h"
+#include "PersistenceWorker.h"
+#include "SnakeCore.h"
+
+// Таблица рекордов: двоичный файл записей фиксированной длины, в который только
+// дописывают, и отсортированный индекс к нему. Оба отображаются в память, так
+// что загрузка не зависит от длины истории: проверить заголовки и подхватить
+// записи, дописанные после построения индекса ("хвост"). Хвост живёт в памяти -
+// топ и дерево Фенвика по каждой сложности и по всем вместе, личные рекорды.
+// Запросы складывают ответ индекса (бинарный поиск) и хвоста.
+// Индекс перестраивается при загрузке, когда хвост разросся.
+//
+// scores.bin: ScoreFileHeader, затем ScoreRecord подряд. Число записей -
+//   по размеру файла; недописанная последняя запись (падение) отрезается при
+//   загрузке, чтобы следующие дописывались ровно по границе записей.
+// scores.idx: ScoreIndexHeader; по виду таблицы (все сложности, затем каждая)
+//   ScoreIndexEntry по убыванию счёта, при равенстве - по порядку записи;
+//   затем ScoreIndexUser по возрастанию имени.
+// Порядок байт - родной (little-endian на всех наших платформах).
+// Старый текстовый журнал scores.txt переносится один раз - importText.
+
+const int DIFFICULTY_COUNT = 3;
+const int ALL_DIFFICULTIES = -1; // вид таблицы по всем сложностям
+const int SCORE_VIEW_COUNT = DIFFICULTY_COUNT + 1;
+// Наибольший счёт, который различает дерево мест: выше (порча файла или
+// подделка) считается равным ему, чтобы одна строка не раздула дерево до гигабайт
+const int MAX_RANKED_SCORE = 1 << 20;
+
+struct ScoreEntry {
+    std::string name;
+    int score;
+    int difficulty = NORMAL;
+    int64_t timestamp = 0;     // секунды с эпохи; 0 - неизвестно
+};
+
+struct ScoreRecord {
+    static const int NAME_CAPACITY = 26; // с завершающим нулём; длиннее - обрезается
+    char name[NAME_CAPACITY];
+    uint8_t difficulty;
+    uint8_t reserved;
+    int32_t score;
+    int64_t timestamp;
+};
+
+struct ScoreFileHeader {
+    char magic[4];             // "SNKB"
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+};
+
+struct ScoreIndexHeader {
+    char magic[4];             // "SNKI"
+    uint32_t version;
+    uint64_t records;          // сколько первых записей scores.bin покрыто индексом
+    uint64_t sections[SCORE_VIEW_COUNT];
+    uint64_t users;
+    uint64_t reserved;
+};
+
+struct ScoreIndexEntry {
+    int32_t score;
+    uint32_t record;
+};
+
+struct ScoreIndexUser {
+    char name[ScoreRecord::NAME_CAPACITY];
+    uint8_t reserved[2];
+    int32_t best[DIFFICULTY_COUNT];      // -1 - не играл
+    int64_t timestamp[DIFFICULTY_COUNT];
+};
+
+static_assert(sizeof(ScoreRecord) == 40, "score record layout is part of the file format");
+static_assert(sizeof(ScoreFileHeader) == 16, "score file header layout is part of the file format");
+static_assert(sizeof(ScoreIndexHeader) == 64, "score index header layout is part of the file format");
+static_assert(sizeof(ScoreIndexUser) == 64, "score index user layout is part of the file format");
+
+// Количество результатов по значению счёта (дерево Фенвика).
+// Индекс растёт удвоением под максимальный встреченный счёт, но не дальше
+// MAX_RANKED_SCORE (4 МБ): счёт приводится к [0, MAX_RANKED_SCORE].
+class ScoreRankIndex {
+private:
+    std::vector<uint32_t> tree; // tree[i] - сумма по отрезку, оканчивающемуся на счёт i - 1
+    size_t total = 0;
+
+    void grow(int score) {
+        size_t needed = static_cast<size_t>(score) + 2;
+        if (needed <= tree.size()) return;
+        size_t size = std::max<size_t>(tree.size(), 64);
+        while (size < needed) size *= 2;
+        // Перестройка за O(size): восстанавливаем счётчики и собираем дерево заново
+        std::vector<uint32_t> counts(size, 0);
+        for (size_t i = 1; i < tree.size(); ++i) counts[i] = static_cast<uint32_t>(prefix(i) - prefix(i - 1));
+        tree.assign(size, 0);
+        for (size_t i = 1; i < size; ++i) {
+            tree[i] += counts[i];
+            size_t parent = i + (i & (0 - i));
+            if (parent < size) tree[parent] += tree[i];
+        }
+    }
+
+    // Число результатов со счётом < i
+    size_t prefix(size_t i) const {
+        size_t sum = 0;
+        for (i = std::min(i, tree.size() - 1); i > 0; i -= i & (0 - i)) sum += tree[i];
+        return sum;
+    }
+
+public:
+    static int clamp(int score) { return std::min(MAX_RANKED_SCORE, std::max(0, score)); }
+
+    void add(int score, uint32_t count = 1) {
+        score = clamp(score);
+        grow(score);
+        for (size_t i = static_cast<size_t>(score) + 1; i < tree.size(); i += i & (0 - i)) tree[i] += count;
+        total += count;
+    }
+
+    // Сколько результатов строго лучше
+    size_t countAbove(int score) const {
+        if (tree.empty()) return 0;
+        return total - prefix(static_cast<size_t>(clamp(score)) + 1);
+    }
+
+    size_t rankOf(int score) const { return countAbove(score) + 1; }
+
+    // Счёт k-го лучшего результата (с нуля); -1, если столько нет
+    int scoreAt(size_t k) const {
+        if (k >= total) return -1;
+        size_t target = total - k; // ищем наименьший счёт с (числом результатов <= счёта) >= target
+        size_t position = 0;
+        size_t step = 1;
+        while (step * 2 < tree.size()) step *= 2;
+        for (; step > 0; step /= 2) {
+            if (position + step < tree.size() && tree[position + step] < target) {
+                position += step;
+                target -= tree[position];
+            }
+        }
+        return static_cast<int>(position);
+    }
+
+    size_t size() const { return total; }
+};
+
+// Лучшие результаты одного вида таблицы, по убыванию; при равенстве выше
+// добавленный раньше
+class TopScores {
+private:
+    size_t capacity;
+    std::vector<ScoreEntry> entries;
+
+public:
+    explicit TopScores(size_t capacity = 10) : capacity(capacity) {}
+
+    void add(const ScoreEntry& entry, uint32_t count = 1) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (entries.size() >= capacity && entry.score <= entries.back().score) return;
+            auto position = std::upper_bound(entries.begin(), entries.end(), entry.score,
+                [](int value, const ScoreEntry& other) { return value > other.score; });
+            entries.insert(position, entry);
+            if (entries.size() > capacity) entries.pop_back();
+        }
+    }
+
+    const std::vector<ScoreEntry>& get() const { return entries; }
+};
+
+class ScoreBoard {
+private:
+    static const uint32_t FILE_VERSION = 1;
+    static const size_t REBUILD_TAIL = 50000; // хвост длиннее - перестроить индекс при загрузке
+    static const long long MAX_IMPORT_REPEAT = 1000000; // больше повторов в строке - порча
+
+    // Индексы хвоста одного вида таблицы
+    struct View {
+        TopScores top;
+        ScoreRankIndex ranks;
+
+        explicit View(size_t topCount) : top(topCount) {}
+    };
+
+    std::string path;
+    std::string indexPath;
+    size_t topCount;
+    PersistenceWorker* writer = nullptr;
+
+    MappedFile data;
+    MappedFile index;
+    const ScoreRecord* records = nullptr;
+    size_t diskRecords = 0;
+    bool fileStarted = false;  // заголовок scores.bin уже записан или поставлен в очередь
+    size_t indexRecords = 0;
+    const ScoreIndexEntry* sections[SCORE_VIEW_COUNT] = {};
+    size_t sectionSizes[SCORE_VIEW_COUNT] = {};
+    const ScoreIndexUser* users = nullptr;
+    size_t userCount = 0;
+
+    std::vector<View> tail;    // [0] - все сложности, [1 + d] - сложность d
+    std::unordered_map<std::string, std::vector<ScoreEntry>> tailBest; // по сложностям; score -1 - нет
+    mutable std::vector<ScoreEntry> topCache[SCORE_VIEW_COUNT];
+    mutable bool topValid[SCORE_VIEW_COUNT] = {};
+
+    static bool validDifficulty(int difficulty) { return difficulty >= 0 && difficulty < DIFFICULTY_COUNT; }
+    static int viewOf(int difficulty) { return validDifficulty(difficulty) ? difficulty + 1 : 0; }
+
+    static std::string recordName(const char* name) {
+        return std::string(name, strnlen(name, ScoreRecord::NAME_CAPACITY));
+    }
+
+    // Неизвестная сложность (порча) читается как нормальная - так запись не выпадает из индекса
+    static int recordDifficulty(const ScoreRecord& record) {
+        return validDifficulty(record.difficulty) ? record.difficulty : static_cast<int>(NORMAL);
+    }
+
+    static ScoreEntry toEntry(const ScoreRecord& record) {
+        return ScoreEntry{ recordName(record.name), record.score, recordDifficulty(record), record.timestamp };
+    }
+
+    static ScoreRecord toRecord(const ScoreEntry& entry) {
+        ScoreRecord record;
+        std::memset(&record, 0, sizeof(record));
+        std::memcpy(record.name, entry.name.data(), std::min(entry.name.size(), sizeof(record.name) - 1));
+        record.difficulty = static_cast<uint8_t>(entry.difficulty);
+        record.score = entry.score;
+        record.timestamp = entry.timestamp;
+        return record;
+    }
+
+    static std::string fileHeader() {
+        ScoreFileHeader header = { { 'S', 'N', 'K', 'B' }, FILE_VERSION, sizeof(ScoreRecord), 0 };
+        return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void insertTail(const ScoreEntry& entry) {
+        for (int view : { 0, viewOf(entry.difficulty) }) {
+            tail[view].ranks.add(entry.score);
+            tail[view].top.add(entry);
+            topValid[view] = false;
+        }
+        std::vector<ScoreEntry>& best = tailBest[entry.name];
+        if (best.empty()) best.assign(DIFFICULTY_COUNT, ScoreEntry{ entry.name, -1 });
+        if (entry.score > best[entry.difficulty].score) best[entry.difficulty] = entry;
+    }
+
+    bool openIndex() {
+        indexRecords = 0;
+        users = nullptr;
+        userCount = 0;
+        for (int view = 0; view < SCORE_VIEW_COUNT; ++view) {
+            sections[view] = nullptr;
+            sectionSizes[view] = 0;
+        }
+        if (!index.open(indexPath) || index.size() < sizeof(ScoreIndexHeader)) {
+            index.close();
+            return false;
+        }
+        const ScoreIndexHeader* header = reinterpret_cast<const ScoreIndexHeader*>(index.data());
+        uint64_t entries = 0;
+        uint64_t perDifficulty = 0;
+        for (int view = 0; view < SCORE_VIEW_COUNT; ++view) {
+            entries += header->sections[view];
+            if (view > 0) perDifficulty += header->sections[view];
+        }
+        bool valid = std::memcmp(header->magic, "SNKI", 4) == 0 && header->version == FILE_VERSION &&
+            header->records <= diskRecords && header->sections[0] == header->records && perDifficulty == header->records &&
+            index.size() == sizeof(ScoreIndexHeader) + entries * sizeof(ScoreIndexEntry) + header->users * sizeof(ScoreIndexUser);
+        if (!valid) {
+            index.close();
+            return false;
+        }
+        const uint8_t* cursor = index.data() + sizeof(ScoreIndexHeader);
+        for (int view = 0; view < SCORE_VIEW_COUNT; ++view) {
+            sections[view] = reinterpret_cast<const ScoreIndexEntry*>(cursor);
+            sectionSizes[view] = static_cast<size_t>(header->sections[view]);
+            cursor += sectionSizes[view] * sizeof(ScoreIndexEntry);
+        }
+        users = reinterpret_cast<const ScoreIndexUser*>(cursor);
+        userCount = static_cast<size_t>(header->users);
+        indexRecords = static_cast<size_t>(header->records);
+        return true;
+    }
+
+    // Сколько результатов индекса строго лучше score
+    size_t indexAbove(int view, int score) const {
+        const ScoreIndexEntry* begin = sections[view];
+        const ScoreIndexEntry* end = begin + sectionSizes[view];
+        return static_cast<size_t>(std::partition_point(begin, end,
+            [score](const ScoreIndexEntry& entry) { return entry.score > score; }) - begin);
+    }
+
+    const ScoreIndexUser* findUser(const std::string& name) const {
+        const ScoreIndexUser* end = users + userCount;
+        const ScoreIndexUser* found = std::lower_bound(users, end, name, [](const ScoreIndexUser& user, const std::string& key) {
+            return std::strncmp(user.name, key.c_str(), ScoreRecord::NAME_CAPACITY) < 0;
+            });
+        if (found == end || std::strncmp(found->name, name.c_str(), ScoreRecord::NAME_CAPACITY) != 0) return nullptr;
+        return found;
+    }
+
+    void load(bool allowRebuild) {
+        data.close();
+        index.close();
+        records = nullptr;
+        diskRecords = 0;
+        fileStarted = false;
+        tail.assign(SCORE_VIEW_COUNT, View(topCount));
+        tailBest.clear();
+        for (int view = 0; view < SCORE_VIEW_COUNT; ++view) topValid[view] = false;
+
+        if (data.open(path) && data.size() > 0) {
+            const ScoreFileHeader* header = reinterpret_cast<const ScoreFileHeader*>(data.data());
+            if (data.size() < sizeof(ScoreFileHeader) || std::memcmp(header->magic, "SNKB", 4) != 0 ||
+                header->version != FILE_VERSION || header->recordSize != sizeof(ScoreRecord)) {
+                // Чужой или битый файл не трогаем: откладываем в сторону и начинаем заново
+                std::cerr << "Unrecognized score file " << path << ", moved to " << path << ".bad" << std::endl;
+                data.close();
+                std::remove((path + ".bad").c_str());
+                std::rename(path.c_str(), (path + ".bad").c_str());
+            }
+            else {
+                diskRecords = (data.size() - sizeof(ScoreFileHeader)) / sizeof(ScoreRecord);
+                size_t whole = sizeof(ScoreFileHeader) + diskRecords * sizeof(ScoreRecord);
+                if (data.size() != whole) {
+                    // Хвост недописанной записи: без обрезки add() допишет со сдвигом,
+                    // и все следующие записи прочитаются мусором
+                    data.close();
+                    std::error_code error;
+                    std::filesystem::resize_file(path, whole, error);
+                    if (error || !data.open(path) || data.size() != whole) {
+                        // Обрезать не вышло - как с битым файлом: в сторону и заново
+                        std::cerr << "Cannot truncate torn record in " << path << ", moved to " << path << ".bad" << std::endl;
+                        data.close();
+                        diskRecords = 0;
+                        std::remove((path + ".bad").c_str());
+                        std::rename(path.c_str(), (path + ".bad").c_str());
+                    }
+                }
+                if (data.isOpen()) {
+                    records = reinterpret_cast<const ScoreRecord*>(data.data() + sizeof(ScoreFileHeader));
+                    fileStarted = true;
+                }
+            }
+        }
+        else if (data.isOpen()) {
+            data.close();
+        }
+
+        openIndex();
+        if (allowRebuild && diskRecords - indexRecords > REBUILD_TAIL) {
+            buildIndex();
+            return;
+        }
+        for (size_t i = indexRecords; i < diskRecords; ++i) insertTail(toEntry(records[i]));
+    }
+
+    // Индекс по отображённым записям; затем таблица перечитывается
+    bool buildIndex() {
+        index.close();
+        std::vector<ScoreIndexEntry> views[SCORE_VIEW_COUNT];
+        std::unordered_map<std::string, ScoreIndexUser> best;
+        views[0].reserve(diskRecords);
+        for (size_t i = 0; i < diskRecords; ++i) {
+            const ScoreRecord& record = records[i];
+            int difficulty = recordDifficulty(record);
+            ScoreIndexEntry entry = { record.score, static_cast<uint32_t>(i) };
+            views[0].push_back(entry);
+            views[viewOf(difficulty)].push_back(entry);
+            auto found = best.find(recordName(record.name));
+            if (found == best.end()) {
+                ScoreIndexUser user;
+                std::memset(&user, 0, sizeof(user));
+                std::memcpy(user.name, record.name, sizeof(user.name));
+                for (int d = 0; d < DIFFICULTY_COUNT; ++d) user.best[d] = -1;
+                found = best.emplace(recordName(record.name), user).first;
+            }
+            ScoreIndexUser& user = found->second;
+            if (record.score > user.best[difficulty]) {
+                user.best[difficulty] = record.score;
+                user.timestamp[difficulty] = record.timestamp;
+            }
+        }
+
+        ScoreIndexHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "SNKI", 4);
+        header.version = FILE_VERSION;
+        header.records = views[0].size();
+        header.users = best.size();
+        std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (int view = 0; view < SCORE_VIEW_COUNT; ++view) {
+            std::vector<ScoreIndexEntry>& entries = views[view];
+            std::stable_sort(entries.begin(), entries.end(), [](const ScoreIndexEntry& a, const ScoreIndexEntry& b) {
+                return a.score > b.score;
+                });
+            reinterpret_cast<ScoreIndexHeader*>(&contents[0])->sections[view] = entries.size();
+            contents.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ScoreIndexEntry));
+            std::vector<ScoreIndexEntry>().swap(entries);
+        }
+        std::vector<ScoreIndexUser> sortedUsers;
+        sortedUsers.reserve(best.size());
+        for (const auto& user : best) sortedUsers.push_back(user.second);
+        std::sort(sortedUsers.begin(), sortedUsers.end(), [](const ScoreIndexUser& a, const ScoreIndexUser& b) {
+            return std::strncmp(a.name, b.name, ScoreRecord::NAME_CAPACITY) < 0;
+            });
+        contents.append(reinterpret_cast<const char*>(sortedUsers.data()), sortedUsers.size() * sizeof(ScoreIndexUser));
+
+        bool ok = PersistenceWorker::commitFile(indexPath, contents);
+        load(false);
+        return ok;
+    }
+
+public:
+    explicit ScoreBoard(const std::string& path, size_t topCount = 10) : path(path), topCount(topCount) {
+        size_t dot = path.find_last_of('.');
+        indexPath = (dot == std::string::npos ? path : path.substr(0, dot)) + ".idx";
+        tail.assign(SCORE_VIEW_COUNT, View(topCount));
+    }
+
+    // nullptr - писать синхронно
+    void setWriter(PersistenceWorker* worker) { writer = worker; }
+
+    // Отображает файлы и подхватывает хвост. С фоновой записью вызывать
+    // до первого add или после flush()
+    void load() { load(true); }
+
+    // Строит индекс по всем записям файла заново и перечитывает таблицу.
+    // С фоновой записью - только после flush()
+    bool rebuildIndex() {
+        load(false);
+        return buildIndex();
+    }
+
+    // Место нового результата среди результатов той же сложности (с единицы)
+    size_t add(const std::string& name, int score, int difficulty, int64_t timestamp) {
+        if (!validDifficulty(difficulty)) difficulty = NORMAL;
+        ScoreRecord record = toRecord(ScoreEntry{ name, score, difficulty, timestamp });
+        std::string bytes;
+        if (!fileStarted) bytes = fileHeader();
+        fileStarted = true;
+        bytes.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        if (writer) writer->append(path, bytes);
+        else PersistenceWorker::appendFile(path, bytes);
+        insertTail(toEntry(record));
+        return rankOf(score, difficulty);
+    }
+
+    // Разовый перенос старого текстового журнала ("name score [count]" или
+    // "name score difficulty timestamp [count]") в двоичный файл
+    static bool importText(const std::string& textPath, const std::string& binaryPath, size_t* imported = nullptr) {
+        std::ifstream file(textPath);
+        if (!file.is_open()) return false;
+        std::string contents = fileHeader();
+        size_t count = 0;
+        std::string line;
+        std::vector<long long> numbers;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            ScoreEntry entry;
+            if (!(fields >> entry.name)) continue;
+            numbers.clear();
+            long long value;
+            while (numbers.size() < 4 && fields >> value) numbers.push_back(value);
+            if (numbers.empty()) continue;
+
+            long long repeat = 1;
+            if (numbers[0] < 0 || numbers[0] > MAX_RANKED_SCORE) continue; // битая строка
+            entry.score = static_cast<int>(numbers[0]);
+            if (numbers.size() == 2) repeat = numbers[1];
+            else if (numbers.size() >= 3) {
+                entry.difficulty = static_cast<int>(numbers[1]);
+                entry.timestamp = numbers[2];
+                if (numbers.size() == 4) repeat = numbers[3];
+            }
+            if (repeat > MAX_IMPORT_REPEAT) continue;
+            if (!validDifficulty(entry.difficulty)) continue;
+            ScoreRecord record = toRecord(entry);
+            for (long long i = 0; i < std::max(1LL, repeat); ++i) {
+                contents.append(reinterpret_cast<const char*>(&record), sizeof(record));
+                ++count;
+            }
+        }
+        if (imported) *imported = count;
+        return PersistenceWorker::commitFile(binaryPath, contents);
+    }
+
+    const std::vector<ScoreEntry>& top(int difficulty = ALL_DIFFICULTIES) const {
+        int view = viewOf(difficulty);
+        if (topValid[view]) return topCache[view];
+        // Слияние начала индекса с топом хвоста; хвост новее, при равенстве выше индекс
+        std::vector<ScoreEntry>& merged = topCache[view];
+        merged.clear();
+        const std::vector<ScoreEntry>& recent = tail[view].top.get();
+        size_t fromIndex = 0, fromTail = 0;
+        while (merged.size() < topCount && (fromIndex < sectionSizes[view] || fromTail < recent.size())) {
+            bool takeIndex = fromTail >= recent.size() ||
+                (fromIndex < sectionSizes[view] && sections[view][fromIndex].score >= recent[fromTail].score);
+            if (takeIndex) merged.push_back(toEntry(records[sections[view][fromIndex++].record]));
+            else merged.push_back(recent[fromTail++]);
+        }
+        topValid[view] = true;
+        return merged;
+    }
+
+    // Сколько результатов строго лучше
+    size_t countAbove(int score, int difficulty = ALL_DIFFICULTIES) const {
+        int view = viewOf(difficulty);
+        return indexAbove(view, score) + tail[view].ranks.countAbove(score);
+    }
+
+    // Какое место занял бы такой счёт: 1 + число строго лучших результатов
+    size_t rankOf(int score, int difficulty = ALL_DIFFICULTIES) const { return countAbove(score, difficulty) + 1; }
+
+    // Счёт k-го лучшего результата (с нуля); -1, если столько нет
+    int scoreAt(size_t k, int difficulty = ALL_DIFFICULTIES) const {
+        if (k >= size(difficulty)) return -1;
+        const std::vector<ScoreEntry>& best = top(difficulty);
+        if (k < best.size()) return best[k].score;
+        // Наибольший счёт, которого достигли больше k результатов
+        int low = 0, high = best.empty() ? 0 : best.front().score;
+        while (low < high) {
+            int middle = low + (high - low + 1) / 2;
+            if (countAbove(middle - 1, difficulty) > k) low = middle;
+            else high = middle - 1;
+        }
+        return low;
+    }
+
+    size_t size(int difficulty = ALL_DIFFICULTIES) const {
+        int view = viewOf(difficulty);
+        return sectionSizes[view] + tail[view].ranks.size();
+    }
+
+    // Личный рекорд; false, если игрок на этой сложности не играл
+    bool personalBest(const std::string& name, int difficulty, ScoreEntry& best) const {
+        std::string key = recordName(toRecord(ScoreEntry{ name, 0 }).name);
+        best = ScoreEntry{ key, -1 };
+        if (const ScoreIndexUser* user = findUser(key)) {
+            for (int d = 0; d < DIFFICULTY_COUNT; ++d) {
+                if ((validDifficulty(difficulty) && d != difficulty) || user->best[d] <= best.score) continue;
+                best = ScoreEntry{ key, user->best[d], d, user->timestamp[d] };
+            }
+        }
+        auto recent = tailBest.find(key);
+        if (recent != tailBest.end()) {
+            for (const ScoreEntry& entry : recent->second) {
+                if ((validDifficulty(difficulty) && entry.difficulty != difficulty) || entry.score <= best.score) continue;
+                best = entry;
+            }
+        }
+        return best.score >= 0;
+    }
+
+    size_t getIndexedCount() const { return indexRecords; }
+    size_t getTailCount() const { return tail[0].ranks.size(); }
+    const std::string& getPath() const { return path; }
+    const std::string& getIndexPath() const { return indexPath; }
+};
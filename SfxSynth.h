@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Короткие звуки игры синтезом, без файлов: осциллятор со свипом частоты и
+// огибающая нарастание/спад. Фаза свипа считается по формуле от номера
+// выборки, а шум - хэшем номера, так что render() не хранит состояния и не
+// выделяет память: звук можно считать целиком в буфер (SoundBuffer) или
+// кусками из колбэка SoundStream - результат один и тот же.
+namespace synth {
+
+const unsigned int SAMPLE_RATE = 44100;
+
+enum Waveform { WAVE_SINE, WAVE_SQUARE, WAVE_TRIANGLE, WAVE_SAW, WAVE_NOISE };
+
+struct Patch {
+    Waveform wave;
+    float startHz;
+    float endHz;            // частота меняется экспоненциально от startHz к endHz
+    float durationMs;
+    float attackMs;         // линейное нарастание в начале
+    float releaseMs;        // линейный спад в конце
+    float volume;           // 0..1
+};
+
+// Звуки игры
+const Patch CLICK = { WAVE_TRIANGLE, 1800.0f, 1100.0f, 28.0f, 1.0f, 22.0f, 0.5f };
+const Patch APPLE = { WAVE_SINE, 520.0f, 1040.0f, 110.0f, 3.0f, 80.0f, 0.8f };
+const Patch BONUS = { WAVE_SQUARE, 440.0f, 1760.0f, 260.0f, 5.0f, 120.0f, 0.35f };
+const Patch ANTIBONUS = { WAVE_SAW, 600.0f, 150.0f, 320.0f, 5.0f, 150.0f, 0.4f };
+
+inline size_t sampleCount(const Patch& patch, unsigned int rate = SAMPLE_RATE) {
+    return static_cast<size_t>(patch.durationMs * rate / 1000.0f);
+}
+
+// Выборки [offset, offset + count) звука, моно 16 бит. pitch - множитель частоты
+inline void render(const Patch& patch, float pitch, unsigned int rate, size_t offset, int16_t* out, size_t count) {
+    const double PI = 3.14159265358979323846;
+    size_t total = sampleCount(patch, rate);
+    double duration = patch.durationMs / 1000.0;
+    double f0 = patch.startHz * pitch;
+    double ratio = static_cast<double>(patch.endHz) / patch.startHz;
+    double logRatio = std::log(ratio);
+    for (size_t i = 0; i < count; ++i) {
+        size_t n = offset + i;
+        if (n >= total) {
+            out[i] = 0;
+            continue;
+        }
+        double t = static_cast<double>(n) / rate;
+        // Число оборотов с начала: интеграл f0 * ratio^(t/T)
+        double cycles = std::fabs(logRatio) < 1e-9 ? f0 * t : f0 * duration / logRatio * (std::pow(ratio, t / duration) - 1.0);
+        double phase = cycles - std::floor(cycles);
+        double value;
+        switch (patch.wave) {
+        case WAVE_SINE: value = std::sin(2.0 * PI * phase); break;
+        case WAVE_SQUARE: value = phase < 0.5 ? 1.0 : -1.0; break;
+        case WAVE_TRIANGLE: value = 1.0 - 4.0 * std::fabs(phase - 0.5); break;
+        case WAVE_SAW: value = 2.0 * phase - 1.0; break;
+        default: {
+            uint32_t hash = static_cast<uint32_t>(n) * 2654435761u;
+            hash ^= hash >> 15;
+            hash *= 2246822519u;
+            hash ^= hash >> 13;
+            value = static_cast<double>(hash) / 2147483647.5 - 1.0;
+        }
+        }
+        double ms = t * 1000.0;
+        double envelope = 1.0;
+        if (patch.attackMs > 0.0f && ms < patch.attackMs) envelope = ms / patch.attackMs;
+        if (patch.releaseMs > 0.0f && patch.durationMs - ms < patch.releaseMs) {
+            envelope = std::min(envelope, (patch.durationMs - ms) / patch.releaseMs);
+        }
+        out[i] = static_cast<int16_t>(std::max(-1.0, std::min(1.0, value * envelope * patch.volume)) * 32767.0);
+    }
+}
+
+// Серия яблок: каждое следующее в пределах windowMs от предыдущего звучит на
+// полутон выше, не больше чем на maxSteps полутонов
+class ComboPitch {
+private:
+    int streak = 0;
+    std::chrono::steady_clock::time_point last;
+    const double windowMs;
+    const int maxSteps;
+
+public:
+    explicit ComboPitch(double windowMs = 2500.0, int maxSteps = 12) : windowMs(windowMs), maxSteps(maxSteps) {}
+
+    // Множитель частоты для очередного яблока
+    float hit() {
+        auto now = std::chrono::steady_clock::now();
+        bool inCombo = streak > 0 && std::chrono::duration<double, std::milli>(now - last).count() <= windowMs;
+        streak = inCombo ? streak + 1 : 1;
+        last = now;
+        return static_cast<float>(std::pow(2.0, std::min(streak - 1, maxSteps) / 12.0));
+    }
+
+    void reset() { streak = 0; }
+    int getStreak() const { return streak; }
+};
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdlib>
+#include "SnakeCore.h"
+
+// Простой жадный бот: идёт к ближайшей цели (бонус или еда), избегая
+// мгновенной смерти и антибонуса. Используется симулятором и ареной.
+class SnakeBot {
+private:
+    static int distance(const Cell& a, const Cell& b) {
+        return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+    }
+
+    static bool isOpposite(Direction a, Direction b) {
+        return (a == UP && b == DOWN) || (a == DOWN && b == UP) ||
+            (a == LEFT && b == RIGHT) || (a == RIGHT && b == LEFT);
+    }
+
+public:
+    static Direction choose(const SnakeCore& core) {
+        const Cell head = core.getHead();
+        Cell target = core.getFood();
+        if (core.hasBonus() && distance(head, core.getBonus()) < distance(head, target)) {
+            target = core.getBonus();
+        }
+
+        static const Direction directions[] = { UP, DOWN, LEFT, RIGHT };
+        Direction best = core.getDirection();
+        int bestCost = 1 << 30;
+        for (Direction dir : directions) {
+            if (isOpposite(dir, core.getDirection())) continue;
+
+            Cell next = SnakeCore::step(head, dir);
+            int cost = distance(next, target);
+            if (core.isBlocked(next)) cost += 1 << 20;
+            else if (core.hasAntiBonus() && next == core.getAntiBonus()) cost += 1 << 10;
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = dir;
+            }
+        }
+        return best;
+    }
+};
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Headless game core: Snake rules without SFML, clocks or rand(), so the
+// same logic can be driven by the window loop, bots and the batch simulator.
+
+enum Direction { UP, DOWN, LEFT, RIGHT };
+enum Difficulty { EASY, NORMAL, HARD };
+
+const int BONUS_GROW = 3;
+const int ANTIBONUS_SHRINK = 3;
+const float BONUS_INTERVAL = 30.0f;
+const float ANTI_BONUS_INTERVAL = 30.0f;
+const float BONUS_DELAY = 30.0f;
+const float EASY_SPEED = 0.2f;
+const float NORMAL_SPEED = 0.1f;
+const float HARD_SPEED = 0.05f;
+
+// Tunable rule set; defaults are the constants above.
+struct GameRules {
+    int bonusGrow = BONUS_GROW;
+    int antiBonusShrink = ANTIBONUS_SHRINK;
+    float bonusInterval = BONUS_INTERVAL;
+    float antiBonusInterval = ANTI_BONUS_INTERVAL;
+    float bonusDelay = BONUS_DELAY;
+    float easySpeed = EASY_SPEED;
+    float normalSpeed = NORMAL_SPEED;
+    float hardSpeed = HARD_SPEED;
+
+    float speedFor(Difficulty difficulty) const {
+        switch (difficulty) {
+        case EASY: return easySpeed;
+        case HARD: return hardSpeed;
+        default: return normalSpeed;
+        }
+    }
+};
+
+struct Cell {
+    int x = 0;
+    int y = 0;
+
+    bool operator==(const Cell& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const Cell& other) const { return !(*this == other); }
+};
+
+enum StepEvent { STEP_NONE, STEP_FOOD, STEP_BONUS, STEP_ANTIBONUS, STEP_DIED };
+
+// Маленький детерминированный генератор (xorshift64*), одинаковый на всех платформах
+struct Rng {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+
+    void seed(uint64_t value) {
+        // splitmix64, чтобы соседние сиды давали несвязанные последовательности
+        uint64_t z = value + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        state = (z ^ (z >> 31)) | 1ull;
+    }
+
+    uint32_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<uint32_t>((state * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+
+    int nextInt(int bound) {
+        return static_cast<int>((static_cast<uint64_t>(next()) * static_cast<uint64_t>(bound)) >> 32);
+    }
+};
+
+// Состояние N независимых досок в раскладке структура-массивов (SoA).
+// Это единственная реализация правил: SnakeCore - фасад над одной доской,
+// VecEnv - пакетный интерфейс для обучения агентов.
+// Тело хранится кольцевым буфером индексов клеток (y * cols + x), голова в head.
+class SnakeBoards {
+public:
+    static const int OBSERVATION_PLANES = 3; // занятость, голова, предметы
+    static const uint8_t ITEM_FOOD = 1;
+    static const uint8_t ITEM_BONUS = 2;
+    static const uint8_t ITEM_ANTIBONUS = 3;
+
+private:
+    GameRules rules;
+    int count;
+    int cols;
+    int rows;
+    int cells;
+    int capacity;
+    float stepSeconds;
+
+    std::vector<int32_t> ring;
+    std::vector<uint16_t> occupancy; // Сколько сегментов занимает клетку (после grow бывают дубликаты)
+    std::vector<int32_t> head;
+    std::vector<int32_t> length;
+    std::vector<uint8_t> direction;
+    std::vector<int32_t> food;       // -1 - предмета нет
+    std::vector<int32_t> bonus;
+    std::vector<int32_t> antiBonus;
+    std::vector<float> elapsed;
+    std::vector<float> bonusTimer;
+    std::vector<float> antiBonusTimer;
+    std::vector<uint32_t> ticks;
+    std::vector<int32_t> scores;
+    std::vector<uint8_t> over;
+    std::vector<Rng> rngs;
+
+    // Необязательный буфер наблюдений вызывающей стороны: [count][3][rows][cols],
+    // обновляется инкрементально, только изменившиеся клетки.
+    uint8_t* observations = nullptr;
+
+    // Позиция i-го сегмента в кольце без деления (i < capacity)
+    size_t slot(int b, int i) const {
+        int index = head[b] + i;
+        if (index >= capacity) index -= capacity;
+        return static_cast<size_t>(b) * capacity + index;
+    }
+
+    uint8_t* planes(int b) { return observations + static_cast<size_t>(b) * OBSERVATION_PLANES * cells; }
+
+    void setItem(int b, int cell, uint8_t item) {
+        if (observations && cell >= 0) planes(b)[2 * cells + cell] = item;
+    }
+
+    void pushFront(int b, int cell) {
+        int32_t& h = head[b];
+        if (observations && length[b] > 0) planes(b)[cells + ring[static_cast<size_t>(b) * capacity + h]] = 0;
+        h = h == 0 ? capacity - 1 : h - 1;
+        ring[static_cast<size_t>(b) * capacity + h] = cell;
+        ++length[b];
+        if (occupancy[static_cast<size_t>(b) * cells + cell]++ == 0 && observations) planes(b)[cell] = 1;
+        if (observations) planes(b)[cells + cell] = 1;
+    }
+
+    void pushBack(int b, int cell) {
+        ring[slot(b, length[b])] = cell;
+        ++length[b];
+        if (occupancy[static_cast<size_t>(b) * cells + cell]++ == 0 && observations) planes(b)[cell] = 1;
+    }
+
+    void popBack(int b) {
+        int cell = ring[slot(b, length[b] - 1)];
+        --length[b];
+        if (--occupancy[static_cast<size_t>(b) * cells + cell] == 0 && observations) planes(b)[cell] = 0;
+    }
+
+    bool isFree(int b, int cell) const {
+        return occupancy[static_cast<size_t>(b) * cells + cell] == 0 &&
+            cell != food[b] && cell != bonus[b] && cell != antiBonus[b];
+    }
+
+    int randomFreeCell(int b) {
+        Rng& rng = rngs[b];
+        // Сначала случайные попытки, при почти заполненном поле - линейный поиск
+        for (int attempt = 0; attempt < 64; ++attempt) {
+            int x = rng.nextInt(cols);
+            int y = rng.nextInt(rows);
+            if (isFree(b, y * cols + x)) return y * cols + x;
+        }
+        int start = rng.nextInt(cells);
+        for (int i = 0; i < cells; ++i) {
+            int cell = (start + i) % cells;
+            if (isFree(b, cell)) return cell;
+        }
+        return -1;
+    }
+
+    void spawn(int b, std::vector<int32_t>& item, uint8_t kind) {
+        item[b] = randomFreeCell(b);
+        setItem(b, item[b], kind);
+    }
+
+public:
+    SnakeBoards(int count, int cols, int rows, uint64_t seed = 1, const GameRules& rules = GameRules())
+        : rules(rules), count(count), cols(cols), rows(rows), cells(cols * rows),
+        capacity(cols * rows + 1), stepSeconds(rules.normalSpeed),
+        ring(static_cast<size_t>(count) * capacity), occupancy(static_cast<size_t>(count) * cells),
+        head(count), length(count), direction(count), food(count), bonus(count), antiBonus(count),
+        elapsed(count), bonusTimer(count), antiBonusTimer(count), ticks(count), scores(count),
+        over(count), rngs(count) {
+        for (int b = 0; b < count; ++b) {
+            rngs[b].seed(seed + static_cast<uint64_t>(b));
+            reset(b);
+        }
+    }
+
+    void setRules(const GameRules& newRules) { rules = newRules; }
+    const GameRules& getRules() const { return rules; }
+
+    void setDifficulty(Difficulty difficulty) { stepSeconds = rules.speedFor(difficulty); }
+    float getSpeed() const { return stepSeconds; }
+
+    void reseed(int b, uint64_t seed) { rngs[b].seed(seed); }
+
+    // Подключает (или отключает при nullptr) буфер наблюдений и заполняет его целиком
+    void bindObservations(uint8_t* buffer) {
+        observations = buffer;
+        if (observations) {
+            for (int b = 0; b < count; ++b) writeObservation(b, planes(b));
+        }
+    }
+
+    void writeObservation(int b, uint8_t* out) const {
+        std::fill(out, out + static_cast<size_t>(OBSERVATION_PLANES) * cells, 0);
+        const uint16_t* occ = &occupancy[static_cast<size_t>(b) * cells];
+        for (int cell = 0; cell < cells; ++cell) out[cell] = occ[cell] != 0;
+        if (length[b] > 0) out[cells + segment(b, 0)] = 1;
+        if (food[b] >= 0) out[2 * cells + food[b]] = ITEM_FOOD;
+        if (bonus[b] >= 0) out[2 * cells + bonus[b]] = ITEM_BONUS;
+        if (antiBonus[b] >= 0) out[2 * cells + antiBonus[b]] = ITEM_ANTIBONUS;
+    }
+
+    void reset(int b) {
+        while (length[b] > 0) popBack(b);
+        if (observations) std::fill(planes(b), planes(b) + static_cast<size_t>(OBSERVATION_PLANES) * cells, 0);
+        // Всегда добавляем минимум 3 сегмента
+        int centerX = cols / 2;
+        int centerY = rows / 2;
+        head[b] = 0;
+        pushFront(b, centerY * cols + centerX - 2);
+        pushFront(b, centerY * cols + centerX - 1);
+        pushFront(b, centerY * cols + centerX);
+
+        direction[b] = RIGHT;
+        bonus[b] = -1;
+        antiBonus[b] = -1;
+        food[b] = -1;
+        spawn(b, food, ITEM_FOOD);
+        elapsed[b] = 0.f;
+        bonusTimer[b] = 0.f;
+        antiBonusTimer[b] = 0.f;
+        ticks[b] = 0;
+        over[b] = 0;
+        scores[b] = 0;
+    }
+
+    bool isBlocked(int b, const Cell& cell) const {
+        return cell.x < 0 || cell.x >= cols || cell.y < 0 || cell.y >= rows ||
+            occupancy[static_cast<size_t>(b) * cells + cell.y * cols + cell.x] != 0;
+    }
+
+    StepEvent move(int b) {
+        if (over[b] || length[b] == 0) return STEP_NONE;
+
+        int current = segment(b, 0);
+        int x = current % cols;
+        int y = current / cols;
+        switch (direction[b]) {
+        case UP: --y; break;
+        case DOWN: ++y; break;
+        case LEFT: --x; break;
+        case RIGHT: ++x; break;
+        }
+        if (x < 0 || x >= cols || y < 0 || y >= rows ||
+            occupancy[static_cast<size_t>(b) * cells + y * cols + x] != 0) {
+            over[b] = 1;
+            return STEP_DIED;
+        }
+
+        int cell = y * cols + x;
+        StepEvent event = STEP_NONE;
+        pushFront(b, cell);
+        if (cell == food[b] || cell == bonus[b] || cell == antiBonus[b]) setItem(b, cell, 0);
+
+        if (cell == food[b]) {
+            spawn(b, food, ITEM_FOOD);
+            scores[b] += 1;
+            event = STEP_FOOD;
+        }
+        else if (cell == bonus[b]) {
+            // Дубликаты хвоста; ёмкость кольца ограничивает рост размером поля
+            int tail = segment(b, length[b] - 1);
+            for (int i = 0; i < rules.bonusGrow && length[b] < capacity; ++i) pushBack(b, tail);
+            bonus[b] = -1;
+            bonusTimer[b] = 0.f;
+            scores[b] += 3;
+            event = STEP_BONUS;
+        }
+        else if (cell == antiBonus[b]) {
+            for (int i = 0; i < rules.antiBonusShrink && length[b] > 3; ++i) popBack(b);
+            antiBonus[b] = -1;
+            antiBonusTimer[b] = 0.f;
+            scores[b] = scores[b] > 3 ? scores[b] - 3 : 0;
+            event = STEP_ANTIBONUS;
+        }
+        else {
+            popBack(b);
+        }
+
+        // Таймеры считаются в игровом времени (тики * шаг), а не по Clock
+        ++ticks[b];
+        elapsed[b] += stepSeconds;
+        bonusTimer[b] += stepSeconds;
+        antiBonusTimer[b] += stepSeconds;
+        if (elapsed[b] > rules.bonusDelay) {
+            if (bonus[b] < 0 && bonusTimer[b] > rules.bonusInterval) {
+                spawn(b, bonus, ITEM_BONUS);
+                if (bonus[b] >= 0) bonusTimer[b] = 0.f;
+            }
+            if (antiBonus[b] < 0 && antiBonusTimer[b] > rules.antiBonusInterval) {
+                spawn(b, antiBonus, ITEM_ANTIBONUS);
+                if (antiBonus[b] >= 0) antiBonusTimer[b] = 0.f;
+            }
+        }
+        return event;
+    }
+
+    void changeDirection(int b, Direction newDirection) {
+        Direction current = static_cast<Direction>(direction[b]);
+        if ((current == UP && newDirection != DOWN) ||
+            (current == DOWN && newDirection != UP) ||
+            (current == LEFT && newDirection != RIGHT) ||
+            (current == RIGHT && newDirection != LEFT)) {
+            direction[b] = static_cast<uint8_t>(newDirection);
+        }
+    }
+
+    int getCount() const { return count; }
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+    int getCells() const { return cells; }
+    Cell toCell(int index) const { return { index % cols, index / cols }; }
+
+    int segment(int b, int i) const { return ring[slot(b, i)]; }
+    int getLength(int b) const { return length[b]; }
+    Direction getDirection(int b) const { return static_cast<Direction>(direction[b]); }
+    int getFood(int b) const { return food[b]; }
+    int getBonus(int b) const { return bonus[b]; }
+    int getAntiBonus(int b) const { return antiBonus[b]; }
+    int getScore(int b) const { return scores[b]; }
+    bool isOver(int b) const { return over[b] != 0; }
+    uint32_t getTicks(int b) const { return ticks[b]; }
+    float getElapsed(int b) const { return elapsed[b]; }
+};
+
+// Одна доска с удобным интерфейсом в клетках: для окна игры, ботов и симулятора.
+class SnakeCore {
+private:
+    SnakeBoards board;
+
+    void sync() {
+        gameOver = board.isOver(0);
+        score = board.getScore(0);
+    }
+
+public:
+    bool gameOver = false;
+    int score = 0;
+
+    SnakeCore(int cols, int rows, uint64_t seed = 1, const GameRules& rules = GameRules())
+        : board(1, cols, rows, seed, rules) {
+    }
+
+    void setRules(const GameRules& newRules) { board.setRules(newRules); }
+    const GameRules& getRules() const { return board.getRules(); }
+
+    void setDifficulty(Difficulty difficulty) { board.setDifficulty(difficulty); }
+    float getSpeed() const { return board.getSpeed(); }
+
+    void reseed(uint64_t seed) { board.reseed(0, seed); }
+
+    void reset() {
+        board.reset(0);
+        sync();
+    }
+
+    bool isBlocked(const Cell& cell) const { return board.isBlocked(0, cell); }
+
+    static Cell step(Cell cell, Direction dir) {
+        switch (dir) {
+        case UP: --cell.y; break;
+        case DOWN: ++cell.y; break;
+        case LEFT: --cell.x; break;
+        case RIGHT: ++cell.x; break;
+        }
+        return cell;
+    }
+
+    StepEvent move() {
+        StepEvent event = board.move(0);
+        sync();
+        return event;
+    }
+
+    void changeDirection(Direction newDirection) { board.changeDirection(0, newDirection); }
+
+    int getCols() const { return board.getCols(); }
+    int getRows() const { return board.getRows(); }
+    int getLength() const { return board.getLength(0); }
+    Cell getSegment(int i) const { return board.toCell(board.segment(0, i)); }
+    Cell getHead() const { return getSegment(0); }
+    Direction getDirection() const { return board.getDirection(0); }
+    Cell getFood() const { return board.toCell(board.getFood(0)); }
+    bool hasBonus() const { return board.getBonus(0) >= 0; }
+    Cell getBonus() const { return board.toCell(board.getBonus(0)); }
+    bool hasAntiBonus() const { return board.getAntiBonus(0) >= 0; }
+    Cell getAntiBonus() const { return board.toCell(board.getAntiBonus(0)); }
+    uint32_t getTicks() const { return board.getTicks(0); }
+    float getElapsed() const { return board.getElapsed(0); }
+};
@@ -0,0 +1,104 @@
+#include <memory>
+#include "SnakeEnvApi.h"
+#include "VecEnv.h"
+
+struct snake_env {
+    VecEnv env;
+    std::unique_ptr<ThreadPool> pool;
+    float* rewards = nullptr;
+    uint8_t* dones = nullptr;
+    int32_t* finalScores = nullptr;
+
+    snake_env(int count, int cols, int rows, uint64_t seed, Difficulty difficulty)
+        : env(count, cols, rows, seed, difficulty) {
+    }
+};
+
+static bool validIndex(const snake_env* env, int index) {
+    return env && index >= 0 && index < env->env.size();
+}
+
+extern "C" {
+
+int snake_env_abi_version(void) {
+    return SNAKE_ENV_ABI_VERSION;
+}
+
+snake_env* snake_env_create(int num_envs, int cols, int rows, uint64_t seed, int difficulty) {
+    if (num_envs <= 0 || cols < 4 || rows < 4 || difficulty < EASY || difficulty > HARD) return nullptr;
+    try {
+        return new snake_env(num_envs, cols, rows, seed, static_cast<Difficulty>(difficulty));
+    }
+    catch (...) {
+        return nullptr; // исключения не должны пересекать границу C ABI
+    }
+}
+
+void snake_env_destroy(snake_env* env) {
+    delete env;
+}
+
+int snake_env_num_envs(const snake_env* env) {
+    return env ? env->env.size() : 0;
+}
+
+int snake_env_observation_size(const snake_env* env) {
+    return env ? static_cast<int>(env->env.observationSize()) : 0;
+}
+
+void snake_env_set_threads(snake_env* env, int threads) {
+    if (!env) return;
+    if (threads == 1) env->pool.reset();
+    else env->pool = std::make_unique<ThreadPool>(threads > 0 ? static_cast<unsigned>(threads) : 0u);
+}
+
+int snake_env_bind(snake_env* env, uint8_t* observations, float* rewards, uint8_t* dones, int32_t* final_scores) {
+    if (!env || !rewards || !dones) return -1;
+    env->rewards = rewards;
+    env->dones = dones;
+    env->finalScores = final_scores;
+    env->env.bindObservations(observations);
+    return 0;
+}
+
+void snake_env_reset(snake_env* env, int index, uint64_t seed) {
+    if (!validIndex(env, index)) return;
+    env->env.reseed(index, seed);
+    env->env.reset(index);
+}
+
+void snake_env_reset_all(snake_env* env, uint64_t seed) {
+    if (!env) return;
+    for (int i = 0; i < env->env.size(); ++i) {
+        env->env.reseed(i, seed + static_cast<uint64_t>(i));
+        env->env.reset(i);
+    }
+}
+
+int snake_env_step(snake_env* env, int index, int action) {
+    if (!validIndex(env, index) || !env->rewards || !VecEnv::validAction(action)) return -1;
+    env->env.stepOne(index, static_cast<int8_t>(action), env->rewards[index], env->dones[index],
+        env->finalScores ? &env->finalScores[index] : nullptr);
+    return env->dones[index];
+}
+
+int snake_env_step_all(snake_env* env, const int8_t* actions) {
+    if (!env || !actions || !env->rewards) return -1;
+    for (int i = 0; i < env->env.size(); ++i) {
+        if (!VecEnv::validAction(actions[i])) return -1;
+    }
+    if (env->pool) env->env.step(*env->pool, actions, env->rewards, env->dones, env->finalScores);
+    else env->env.step(actions, env->rewards, env->dones, env->finalScores);
+    return 0;
+}
+
+void snake_env_observe(const snake_env* env, int index, uint8_t* out) {
+    if (!validIndex(env, index) || !out) return;
+    env->env.observe(index, out);
+}
+
+int snake_env_score(const snake_env* env, int index) {
+    return validIndex(env, index) ? env->env.getBoards().getScore(index) : 0;
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+ * Stable C ABI over the headless game core (VecEnv / SnakeBoards), for
+ * training code in other languages (Python ctypes/cffi and similar).
+ *
+ * Buffers are owned by the caller and bound once; batched steps write
+ * observations, rewards and done flags straight into them, nothing is copied
+ * or allocated per step. Game rules are the same code the window game runs.
+ *
+ * Observation layout per env: 3 planes of rows*cols bytes -
+ * occupancy (0/1), head (0/1), items (0 none, 1 food, 2 bonus, 3 antibonus).
+ * Actions: 0 up, 1 down, 2 left, 3 right, -1 keep direction.
+ */
+
+#include <stdint.h>
+
+#if defined(SNAKE_ENV_STATIC)
+#define SNAKE_ENV_API
+#elif defined(_WIN32)
+#if defined(SNAKE_ENV_EXPORTS)
+#define SNAKE_ENV_API __declspec(dllexport)
+#else
+#define SNAKE_ENV_API __declspec(dllimport)
+#endif
+#else
+#define SNAKE_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SNAKE_ENV_ABI_VERSION 1
+
+typedef struct snake_env snake_env;
+
+SNAKE_ENV_API int snake_env_abi_version(void);
+
+/* difficulty: 0 easy, 1 normal, 2 hard. Returns NULL on invalid arguments. */
+SNAKE_ENV_API snake_env* snake_env_create(int num_envs, int cols, int rows, uint64_t seed, int difficulty);
+SNAKE_ENV_API void snake_env_destroy(snake_env* env);
+
+SNAKE_ENV_API int snake_env_num_envs(const snake_env* env);
+SNAKE_ENV_API int snake_env_observation_size(const snake_env* env);
+
+/* Worker threads for snake_env_step_all; 1 (default) steps on the calling thread, 0 - all cores. */
+SNAKE_ENV_API void snake_env_set_threads(snake_env* env, int threads);
+
+/*
+ * Binds caller-owned buffers: observations [num_envs * observation_size],
+ * rewards [num_envs], dones [num_envs], final_scores [num_envs] (may be NULL).
+ * observations may be NULL to disable incremental observation updates.
+ * Buffers must stay valid until rebound or the env is destroyed.
+ * Returns 0 on success, -1 if rewards/dones are missing.
+ */
+SNAKE_ENV_API int snake_env_bind(snake_env* env, uint8_t* observations, float* rewards,
+    uint8_t* dones, int32_t* final_scores);
+
+SNAKE_ENV_API void snake_env_reset(snake_env* env, int index, uint64_t seed);
+SNAKE_ENV_API void snake_env_reset_all(snake_env* env, uint64_t seed);
+
+/*
+ * Single env step into the bound buffers. action: 0..3 (up, down, left, right)
+ * or -1 to keep the direction. Returns the done flag, or -1 on error
+ * (bad index, unbound buffers, action out of range - nothing is stepped).
+ */
+SNAKE_ENV_API int snake_env_step(snake_env* env, int index, int action);
+
+/*
+ * Batched step of all envs into the bound buffers; actions has num_envs entries,
+ * each as in snake_env_step. Returns 0, or -1 if any action is out of range
+ * (then no env is stepped).
+ */
+SNAKE_ENV_API int snake_env_step_all(snake_env* env, const int8_t* actions);
+
+/* Full observation of one env into out [observation_size]. */
+SNAKE_ENV_API void snake_env_observe(const snake_env* env, int index, uint8_t* out);
+
+SNAKE_ENV_API int snake_env_score(const snake_env* env, int index);
+
+#ifdef __cplusplus
+}
+#endif
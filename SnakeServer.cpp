@@ -0,0 +1,334 @@
+#include <SFML/Network.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MatchServer.h"
+
+// Сервер матчей и генератор нагрузки из ботов-клиентов.
+//   SnakeServer serve [--port N] [--threads N] [--players N] [--bots N] [--tick-ms N] [--seconds N]
+//   SnakeServer loadgen [--host A] [--port N] [--matches N] [--players N] [--spectators N]
+//                       [--threads N] [--seconds N]
+//   SnakeServer bench [--matches N,N,...] [--players N] [--spectators N] [--threads N] [--seconds N] [--port N]
+// bench поднимает сервер в этом же процессе и гоняет против него loadgen на localhost.
+// Клиенты loadgen восстанавливают арену из кадров репликации и считают разрывы.
+
+static void printUsage() {
+    std::cout << "Usage: SnakeServer <command> [options]\n"
+        << "Commands:\n"
+        << "  serve    host arena matches, print tick jitter every 5 seconds\n"
+        << "  loadgen  connect bot clients to a running server\n"
+        << "  bench    run server and load generator in-process, report matches per core\n";
+}
+
+struct LoadStats {
+    std::atomic<int> connected{ 0 };
+    std::atomic<int> spectators{ 0 };
+    std::atomic<int> failed{ 0 };
+    std::atomic<uint64_t> states{ 0 };    // применённые кадры
+    std::atomic<uint64_t> keyframes{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> gaps{ 0 };      // дельта не легла на реплику - ждём ключевой кадр
+    std::atomic<uint64_t> corrupt{ 0 };
+    std::atomic<uint64_t> inputs{ 0 };
+};
+
+struct LoadClient {
+    std::unique_ptr<sf::TcpSocket> socket;
+    std::unique_ptr<ArenaReplica> replica;
+    bool spectator = false;
+    sf::Packet pending;     // недоотправленный ввод (Partial)
+    bool hasPending = false;
+};
+
+// Досылает хвост ввода, как Client::pending на сервере: пока он не ушёл целиком,
+// новый пакет слать нельзя - половина старого уже в потоке TCP. true - хвоста нет
+static bool flushInput(LoadClient& client) {
+    if (!client.hasPending) return true;
+    if (client.socket->send(client.pending) != sf::Socket::Done) return false;
+    client.hasPending = false;
+    return true;
+}
+
+// Подключение и рукопожатие; watch < 0 - игрок, иначе номер матча для наблюдения
+static std::unique_ptr<LoadClient> connectClient(const sf::IpAddress& host, unsigned short port, int watch) {
+    std::unique_ptr<LoadClient> client = std::make_unique<LoadClient>();
+    client->socket = std::make_unique<sf::TcpSocket>();
+    client->spectator = watch >= 0;
+    sf::Packet packet;
+    packet << static_cast<sf::Uint8>(MSG_HELLO) << MATCH_PROTOCOL_MAGIC;
+    if (client->spectator) packet << static_cast<sf::Uint8>(ROLE_SPECTATOR) << static_cast<sf::Int32>(watch);
+    sf::Uint8 type = 0, player = 0, snakes = 0;
+    sf::Int32 matchId = 0;
+    sf::Uint16 cols = 0, rows = 0;
+    if (client->socket->connect(host, port, sf::seconds(5)) != sf::Socket::Done || client->socket->send(packet) != sf::Socket::Done ||
+        client->socket->receive(packet) != sf::Socket::Done ||
+        !(packet >> type >> matchId >> player >> snakes >> cols >> rows) || type != MSG_WELCOME) {
+        return nullptr;
+    }
+    client->socket->setBlocking(false);
+    client->replica = std::make_unique<ArenaReplica>(cols, rows);
+    return client;
+}
+
+// Клиенты-боты: разбирают кадры в реплику и на каждый кадр изредка
+// поворачивают. Каждый поток обслуживает свою долю соединений.
+static void runLoadThread(std::vector<std::unique_ptr<LoadClient>>& clients, double seconds, uint64_t seed, LoadStats& stats) {
+    Rng rng;
+    rng.seed(seed);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    sf::Packet packet;
+    while (std::chrono::steady_clock::now() < deadline) {
+        bool received = false;
+        for (auto& client : clients) {
+            if (client->hasPending && flushInput(*client)) ++stats.inputs;
+            while (client->socket->receive(packet) == sf::Socket::Done) {
+                received = true;
+                sf::Uint8 type = 0;
+                const uint8_t* payload = nullptr;
+                size_t size = 0;
+                if (!replication::unpackFrame(packet, type, payload, size)) {
+                    ++stats.corrupt;
+                    continue;
+                }
+                stats.bytes += packet.getDataSize();
+                BitReader reader(payload, size);
+                if (type == MSG_KEYFRAME) {
+                    ++stats.keyframes;
+                    if (!client->replica->readKeyframe(reader)) {
+                        ++stats.corrupt;
+                        continue;
+                    }
+                }
+                else if (type == MSG_DELTA) {
+                    // Вслед за пропуском сервер сам пришлёт ключевой кадр
+                    if (!client->replica->isSynced()) continue;
+                    if (!client->replica->readDelta(reader)) {
+                        ++stats.gaps;
+                        continue;
+                    }
+                }
+                else continue;
+                ++stats.states;
+                if (!client->spectator && rng.nextInt(4) == 0 && flushInput(*client)) {
+                    client->pending.clear();
+                    client->pending << static_cast<sf::Uint8>(MSG_INPUT) << static_cast<sf::Uint8>(rng.nextInt(4));
+                    sf::Socket::Status status = client->socket->send(client->pending);
+                    if (status == sf::Socket::Done) ++stats.inputs;
+                    // Ушёл частично - считается, когда дошлётся
+                    else if (status == sf::Socket::Partial) client->hasPending = true;
+                }
+            }
+        }
+        if (!received) sf::sleep(sf::milliseconds(1));
+    }
+}
+
+// Сначала подключаются все игроки, затем зрители: смотреть можно только
+// матч, в который сервер уже кого-то назначил
+static bool runLoad(const sf::IpAddress& host, unsigned short port, int matches, int players, int spectators,
+    unsigned threads, double seconds, LoadStats& stats) {
+    std::vector<std::vector<std::unique_ptr<LoadClient>>> groups(threads);
+    auto connectAll = [&](int count, bool spectator) {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = static_cast<int>(t); i < count; i += static_cast<int>(threads)) {
+                    std::unique_ptr<LoadClient> client = connectClient(host, port, spectator ? i / spectators : -1);
+                    if (!client) {
+                        ++stats.failed;
+                        continue;
+                    }
+                    ++(spectator ? stats.spectators : stats.connected);
+                    groups[t].push_back(std::move(client));
+                }
+                });
+        }
+        for (std::thread& worker : workers) worker.join();
+    };
+    connectAll(matches * players, false);
+    connectAll(matches * spectators, true);
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] { runLoadThread(groups[t], seconds, 1000 + t, stats); });
+    }
+    for (std::thread& worker : workers) worker.join();
+    return stats.failed == 0;
+}
+
+static void printReport(const MatchServerReport& report, int worst) {
+    std::cout << "matches " << report.matches << ", clients " << report.clients << ", spectators " << report.spectators
+        << ", ticks/s " << std::fixed << std::setprecision(0) << (report.wallSeconds > 0 ? report.ticks / report.wallSeconds : 0.0)
+        << ", jitter us mean " << report.jitter.mean() << " p99 " << report.jitter.percentile(0.99)
+        << " max " << (report.jitter.count ? report.jitter.maxValue : 0)
+        << ", busy " << std::setprecision(1) << (report.wallSeconds > 0 ? 100.0 * report.busySeconds / report.wallSeconds : 0.0) << "%"
+        << ", matches/core " << std::setprecision(0) << report.matchesPerCore()
+        << ", bytes/client/tick " << std::setprecision(1) << report.bytesPerClientTick()
+        << " (keyframes " << report.keyframes << ", deltas " << report.deltas << ")\n";
+
+    std::vector<MatchSummary> list = report.matchList;
+    std::sort(list.begin(), list.end(), [](const MatchSummary& a, const MatchSummary& b) { return a.jitterP99 > b.jitterP99; });
+    for (int i = 0; i < worst && i < static_cast<int>(list.size()); ++i) {
+        std::cout << "  match " << std::setw(5) << list[i].id << ": clients " << list[i].clients
+            << ", spectators " << list[i].spectators << ", ticks " << list[i].ticks << ", jitter us mean " << std::setprecision(0) << list[i].jitterMean
+            << " p99 " << list[i].jitterP99 << " max " << list[i].jitterMax << "\n";
+    }
+}
+
+static void printLoadStats(const LoadStats& stats, double seconds) {
+    int clients = stats.connected + stats.spectators;
+    std::cout << "Clients connected: " << stats.connected << " + " << stats.spectators << " spectators, failed: " << stats.failed
+        << ", frames/s per client: " << std::fixed << std::setprecision(1)
+        << (clients ? stats.states / seconds / clients : 0.0)
+        << ", bytes/s per client: " << std::setprecision(0) << (clients ? stats.bytes / seconds / clients : 0.0)
+        << ", keyframes: " << stats.keyframes << ", gaps: " << stats.gaps << ", corrupt: " << stats.corrupt
+        << ", inputs sent: " << stats.inputs << "\n";
+}
+
+static bool readServerOption(MatchServerConfig& config, const std::string& option, const std::string& value) {
+    if (option == "--port") config.port = static_cast<unsigned short>(std::atoi(value.c_str()));
+    else if (option == "--threads") config.threads = static_cast<unsigned>(std::max(0, std::atoi(value.c_str())));
+    else if (option == "--players") config.playersPerMatch = std::max(1, std::atoi(value.c_str()));
+    else if (option == "--bots") config.botsPerMatch = std::max(0, std::atoi(value.c_str()));
+    else if (option == "--tick-ms") config.tickMicros = std::max(1, std::atoi(value.c_str())) * 1000;
+    else if (option == "--keyframe") config.keyframeTicks = std::max(0, std::atoi(value.c_str()));
+    else return false;
+    return true;
+}
+
+static int runServe(int argc, char** argv) {
+    MatchServerConfig config;
+    double seconds = 0.0;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--seconds") seconds = std::atof(argv[i + 1]);
+        else if (!readServerOption(config, option, argv[i + 1])) {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    MatchServer server(config);
+    if (!server.start()) {
+        std::cerr << "Cannot listen on port " << config.port << std::endl;
+        return 1;
+    }
+    std::cout << "Listening on " << config.port << ", " << server.getConfig().threads << " shards, "
+        << config.playersPerMatch << " players + " << config.botsPerMatch << " bots per match" << std::endl;
+    auto started = std::chrono::steady_clock::now();
+    for (;;) {
+        sf::sleep(sf::seconds(5));
+        printReport(server.report(), 5);
+        std::cout.flush();
+        if (seconds > 0 && std::chrono::steady_clock::now() - started >= std::chrono::duration<double>(seconds)) break;
+    }
+    server.stop();
+    return 0;
+}
+
+static int runLoadGen(int argc, char** argv) {
+    sf::IpAddress host = sf::IpAddress::LocalHost;
+    unsigned short port = 47800;
+    int matches = 100;
+    int players = 2;
+    int spectators = 0;
+    unsigned threads = 4;
+    double seconds = 10.0;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--host") host = sf::IpAddress(value);
+        else if (option == "--port") port = static_cast<unsigned short>(std::atoi(value.c_str()));
+        else if (option == "--matches") matches = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--players") players = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--spectators") spectators = std::max(0, std::atoi(value.c_str()));
+        else if (option == "--threads") threads = static_cast<unsigned>(std::max(1, std::atoi(value.c_str())));
+        else if (option == "--seconds") seconds = std::atof(value.c_str());
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    LoadStats stats;
+    runLoad(host, port, matches, players, spectators, threads, seconds, stats);
+    printLoadStats(stats, seconds);
+    return stats.failed == 0 && stats.corrupt == 0 ? 0 : 1;
+}
+
+static int runBench(int argc, char** argv) {
+    MatchServerConfig config;
+    config.port = 47900;
+    std::vector<int> counts = { 50, 100, 200 };
+    int spectators = 0;
+    double seconds = 5.0;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--seconds") seconds = std::atof(value.c_str());
+        else if (option == "--spectators") spectators = std::max(0, std::atoi(value.c_str()));
+        else if (option == "--matches") {
+            counts.clear();
+            size_t start = 0;
+            while (start < value.size()) {
+                size_t comma = value.find(',', start);
+                if (comma == std::string::npos) comma = value.size();
+                counts.push_back(std::max(1, std::atoi(value.substr(start, comma - start).c_str())));
+                start = comma + 1;
+            }
+        }
+        else if (!readServerOption(config, option, value)) {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    for (size_t run = 0; run < counts.size(); ++run) {
+        MatchServerConfig runConfig = config;
+        runConfig.port = static_cast<unsigned short>(config.port + run);
+        MatchServer server(runConfig);
+        if (!server.start()) {
+            std::cerr << "Cannot listen on port " << runConfig.port << std::endl;
+            return 1;
+        }
+        LoadStats stats;
+        // Первая секунда - подключение клиентов, в отчёт не идёт
+        std::thread load([&] {
+            runLoad(sf::IpAddress::LocalHost, runConfig.port, counts[run], runConfig.playersPerMatch, spectators, 4, seconds + 1.0, stats);
+            });
+        sf::sleep(sf::seconds(1));
+        server.report();
+        sf::sleep(sf::seconds(static_cast<float>(seconds)));
+        MatchServerReport report = server.report();
+        load.join();
+        server.stop();
+
+        std::cout << "[" << counts[run] << " matches requested, " << stats.connected << " clients connected]\n";
+        printReport(report, 3);
+        printLoadStats(stats, seconds + 1.0);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    if (command == "serve") return runServe(argc - 2, argv + 2);
+    if (command == "loadgen") return runLoadGen(argc - 2, argv + 2);
+    if (command == "bench") return runBench(argc - 2, argv + 2);
+
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,1310 @@
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "Arena.h"
+#include "AssetPack.h"
+#include "Audio.h"
+#include "BatchSimulator.h"
+#include "Lockstep.h"
+#include "PasswordHash.h"
+#include "PcmCache.h"
+#include "Replication.h"
+#include "ScoreBoard.h"
+#include "SfxSynth.h"
+#include "SnakeEnvApi.h"
+#include "UserStore.h"
+#include "VecEnv.h"
+
+// Консольные инструменты без окна: пакетная симуляция игр ботом и
+// замеры пропускной способности векторизованного окружения, C ABI и арены,
+// проверка сетевого lockstep на локальной петле, дельта-репликации, таблицы рекордов,
+// журнала учётных записей и цены хэширования паролей; переходы музыки и голоса
+// на записывающем звуке без устройства, синтез звуков, кэш декодированной
+// музыки; сборка пакета ресурсов.
+//   SnakeTool simulate [--games N] [--threads N] [--seed N] [--cols N] [--rows N]
+//                      [--max-ticks N] [--difficulty easy|normal|hard]
+//                      [--bonus-interval S] [--antibonus-interval S] [--bonus-delay S]
+//                      [--bonus-grow N] [--antibonus-shrink N] [--speed S]
+//   SnakeTool vecenv-bench [--envs N] [--steps N] [--threads N] [--cols N] [--rows N]
+//   SnakeTool capi-bench [--envs N] [--steps N]
+//   SnakeTool arena-bench [--ticks N] [--snakes N,N,...] [--world N]
+//   SnakeTool lockstep [--players N] [--ticks N] [--delay N] [--redundancy N] [--loss P]
+//                      [--latency MS] [--jitter MS] [--port N] [--seed N] [--desync-at T]
+//                      [--drop-at T] [--timeout MS]
+//   SnakeTool replicate [--snakes N] [--ticks N] [--world N] [--keyframe N] [--drop P] [--seed N]
+//   SnakeTool scoreboard-bench [--entries N,N,...] [--adds N] [--users N] [--text-max N] [--file PATH] [--async 0|1]
+//   SnakeTool userstore-bench [--users N,N,...] [--adds N] [--text-max N] [--file PATH] [--async 0|1]
+//   SnakeTool password-bench [--iterations N,N,...] [--threads N] [--seconds S]
+//   SnakeTool audio-bench [--rounds N] [--dwell MS] [--crossfade MS] [--start-delay MS]
+//                         [--budget MS] [--prime 0|1] [--sfx N]
+//   SnakeTool sfx-bench [--chunk N] [--repeats N] [--wav DIR]
+//   SnakeTool pcm-cache [--dir DIR] [--seconds S] [--jingle S]
+//   SnakeTool pack [--out PATH] [--root DIR] [--align N] [files...]
+
+static void printUsage() {
+    std::cout << "Usage: SnakeTool <command> [options]\n"
+        << "Commands:\n"
+        << "  simulate      run bot-driven games across all cores and print histograms\n"
+        << "  vecenv-bench  measure VecEnv env-steps/sec with random actions\n"
+        << "  capi-bench    measure per-call overhead of the snake_env C ABI\n"
+        << "  arena-bench   measure arena tick cost at 10/100/1000 snakes (--world N: sparse NxN world)\n"
+        << "  lockstep      run 2-8 lockstep peers over loopback UDP with simulated loss/latency\n"
+        << "  replicate     check delta-compressed arena replication bit for bit, report frame sizes\n"
+        << "  scoreboard-bench  startup and queries of the mmap score store at 10K/1M/10M results vs text parsing\n"
+        << "  userstore-bench   login lookups and registrations on the journaled user store at 10K/1M users\n"
+        << "  password-bench    PBKDF2-SHA256 verifications/sec per work factor (settings.cfg, line 4)\n"
+        << "  audio-bench       music transition latency and voice usage on the null audio backend\n"
+        << "  sfx-bench         synthesize the game sound effects, check chunked rendering, optionally write WAVs\n"
+        << "  pcm-cache         decode, disk and memory hits and invalidation of the decoded music cache\n"
+        << "  pack              build assets.pack from font1.ttf and assets/ (or the listed files) and verify it\n";
+}
+
+static bool parseDifficulty(const std::string& value, Difficulty& difficulty) {
+    if (value == "easy") difficulty = EASY;
+    else if (value == "normal") difficulty = NORMAL;
+    else if (value == "hard") difficulty = HARD;
+    else return false;
+    return true;
+}
+
+static int runSimulate(int argc, char** argv) {
+    SimulationConfig config;
+    for (int i = 0; i < argc; ++i) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (option == "--games") config.games = std::strtoull(value.c_str(), nullptr, 10);
+        else if (option == "--threads") config.threads = static_cast<unsigned>(std::atoi(value.c_str()));
+        else if (option == "--seed") config.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (option == "--cols") config.cols = std::max(4, std::atoi(value.c_str()));
+        else if (option == "--rows") config.rows = std::max(4, std::atoi(value.c_str()));
+        else if (option == "--max-ticks") config.maxTicks = static_cast<uint32_t>(std::atoi(value.c_str()));
+        else if (option == "--bonus-interval") config.rules.bonusInterval = std::stof(value);
+        else if (option == "--antibonus-interval") config.rules.antiBonusInterval = std::stof(value);
+        else if (option == "--bonus-delay") config.rules.bonusDelay = std::stof(value);
+        else if (option == "--bonus-grow") config.rules.bonusGrow = std::atoi(value.c_str());
+        else if (option == "--antibonus-shrink") config.rules.antiBonusShrink = std::atoi(value.c_str());
+        else if (option == "--speed") {
+            float speed = std::stof(value);
+            config.rules.easySpeed = config.rules.normalSpeed = config.rules.hardSpeed = speed;
+        }
+        else if (option == "--difficulty") {
+            if (!parseDifficulty(value, config.difficulty)) {
+                std::cerr << "Unknown difficulty: " << value << std::endl;
+                return 1;
+            }
+        }
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    BatchSimulator simulator(config);
+    double wallSeconds = 0.0;
+    unsigned threads = 0;
+    SimulationStats stats = simulator.run(wallSeconds, threads);
+
+    double gamesPerSecond = wallSeconds > 0.0 ? config.games / wallSeconds : 0.0;
+    std::cout << "Games: " << config.games << " on " << config.cols << "x" << config.rows
+        << ", threads: " << threads << ", wall: " << std::fixed << std::setprecision(3) << wallSeconds << " s\n"
+        << "Games/sec: " << std::setprecision(1) << gamesPerSecond
+        << " (" << gamesPerSecond / threads << " per thread)\n"
+        << "Hit tick limit: " << stats.timedOut << "\n\n";
+    stats.score.print(std::cout, "Score");
+    stats.length.print(std::cout, "Length");
+    stats.duration.print(std::cout, "Duration (ticks)");
+    return 0;
+}
+
+static int runVecEnvBench(int argc, char** argv) {
+    int envs = 4096;
+    int steps = 2000;
+    unsigned threads = 1;
+    int cols = 16;
+    int rows = 16;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = std::atoi(argv[i + 1]);
+        if (option == "--envs") envs = std::max(1, value);
+        else if (option == "--steps") steps = std::max(1, value);
+        else if (option == "--threads") threads = static_cast<unsigned>(std::max(0, value));
+        else if (option == "--cols") cols = std::max(4, value);
+        else if (option == "--rows") rows = std::max(4, value);
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    VecEnv env(envs, cols, rows);
+    std::vector<uint8_t> observations(env.size() * env.observationSize());
+    env.bindObservations(observations.data());
+
+    // Заранее сгенерированные случайные действия, чтобы не мерить генератор
+    const int ACTION_TABLES = 64;
+    std::vector<int8_t> actions(static_cast<size_t>(ACTION_TABLES) * envs);
+    Rng rng;
+    rng.seed(42);
+    for (auto& action : actions) action = static_cast<int8_t>(rng.nextInt(8) - 4); // половина - без поворота
+    std::vector<float> rewards(envs);
+    std::vector<uint8_t> dones(envs);
+
+    uint64_t episodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    if (threads == 1) {
+        for (int s = 0; s < steps; ++s) {
+            env.step(&actions[static_cast<size_t>(s % ACTION_TABLES) * envs], rewards.data(), dones.data());
+            for (uint8_t done : dones) episodes += done;
+        }
+    }
+    else {
+        ThreadPool pool(threads);
+        threads = pool.size();
+        for (int s = 0; s < steps; ++s) {
+            env.step(pool, &actions[static_cast<size_t>(s % ACTION_TABLES) * envs], rewards.data(), dones.data());
+            for (uint8_t done : dones) episodes += done;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double stepsPerSecond = static_cast<double>(envs) * steps / seconds;
+    std::cout << "Envs: " << envs << " on " << cols << "x" << rows << ", steps: " << steps
+        << ", threads: " << threads << "\n"
+        << "Env-steps/sec: " << std::fixed << std::setprecision(0) << stepsPerSecond
+        << ", episodes finished: " << episodes << "\n";
+    return 0;
+}
+
+static int runCApiBench(int argc, char** argv) {
+    int envs = 256;
+    int steps = 4000;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = std::atoi(argv[i + 1]);
+        if (option == "--envs") envs = std::max(1, value);
+        else if (option == "--steps") steps = std::max(1, value);
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    snake_env* env = snake_env_create(envs, 16, 16, 1, NORMAL);
+    std::vector<uint8_t> observations(static_cast<size_t>(envs) * snake_env_observation_size(env));
+    std::vector<float> rewards(envs);
+    std::vector<uint8_t> dones(envs);
+    std::vector<int8_t> actions(envs, VecEnv::ACTION_KEEP);
+    snake_env_bind(env, observations.data(), rewards.data(), dones.data(), nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s) {
+        for (int i = 0; i < envs; ++i) snake_env_step(env, i, (s + i) % 7 == 0 ? (s / 7) % 4 : -1);
+    }
+    double single = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s) snake_env_step_all(env, actions.data());
+    double batched = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    snake_env_destroy(env);
+
+    double calls = static_cast<double>(envs) * steps;
+    std::cout << "ABI version: " << snake_env_abi_version() << ", envs: " << envs << ", steps: " << steps << "\n"
+        << "snake_env_step:     " << std::fixed << std::setprecision(1) << single / calls * 1e9 << " ns/call\n"
+        << "snake_env_step_all: " << batched / calls * 1e9 << " ns/env-step\n";
+    return 0;
+}
+
+static int runArenaBench(int argc, char** argv) {
+    int ticks = 2000;
+    int world = 0; // 0 - поле по плотности, иначе разреженный мир NxN
+    std::vector<int> counts = { 10, 100, 1000 };
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--ticks") ticks = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--world") world = std::min(32767, std::max(0, std::atoi(value.c_str())));
+        else if (option == "--snakes") {
+            counts.clear();
+            size_t start = 0;
+            while (start < value.size()) {
+                size_t comma = value.find(',', start);
+                if (comma == std::string::npos) comma = value.size();
+                counts.push_back(std::max(1, std::atoi(value.substr(start, comma - start).c_str())));
+                start = comma + 1;
+            }
+        }
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << std::setw(8) << "snakes" << std::setw(12) << "board" << std::setw(14) << "us/tick"
+        << std::setw(16) << "ns/moved head" << std::setw(12) << "deaths"
+        << std::setw(10) << "chunks" << std::setw(12) << "grid KB" << "\n";
+    for (int count : counts) {
+        // Плотность поля постоянна: около 300 клеток на змейку
+        int side = world > 0 ? world : std::max(40, static_cast<int>(std::sqrt(count * 300.0)));
+        Arena arena(side, side, count, 7, GameRules(), world > 0 ? 40 : 0);
+        uint64_t moved = 0;
+        uint64_t deaths = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; ++t) {
+            Arena::TickStats stats = arena.step();
+            moved += stats.moved;
+            deaths += stats.died;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::setw(8) << count << std::setw(12) << (std::to_string(side) + "x" + std::to_string(side))
+            << std::setw(14) << std::fixed << std::setprecision(2) << seconds / ticks * 1e6
+            << std::setw(16) << std::setprecision(1) << (moved ? seconds / moved * 1e9 : 0.0)
+            << std::setw(12) << deaths << std::setw(10) << arena.getGrid().chunkCount()
+            << std::setw(12) << arena.getGrid().memoryBytes() / 1024 << "\n";
+    }
+    return 0;
+}
+
+// Все узлы в одном процессе на 127.0.0.1, ввод даёт жадный бот каждого игрока.
+// Проверяет, что при потерях и задержках симуляции совпадают бит в бит.
+static int runLockstep(int argc, char** argv) {
+    LockstepConfig config;
+    int ticks = 2000;
+    int desyncAt = -1;
+    int dropAt = -1; // последний узел замолкает на этом тике, остальные должны доиграть без него
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--players") config.players = std::min(LockstepSession::MAX_PLAYERS, std::max(2, std::atoi(value.c_str())));
+        else if (option == "--ticks") ticks = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--delay") config.inputDelay = std::min(32, std::max(1, std::atoi(value.c_str())));
+        else if (option == "--redundancy") config.redundancy = std::min(64, std::max(1, std::atoi(value.c_str())));
+        else if (option == "--loss") config.loss = static_cast<float>(std::atof(value.c_str()));
+        else if (option == "--latency") config.latencySeconds = static_cast<float>(std::atof(value.c_str())) / 1000.f;
+        else if (option == "--jitter") config.jitterSeconds = static_cast<float>(std::atof(value.c_str())) / 1000.f;
+        else if (option == "--port") config.basePort = static_cast<unsigned short>(std::atoi(value.c_str()));
+        else if (option == "--seed") config.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (option == "--desync-at") desyncAt = std::atoi(value.c_str());
+        else if (option == "--drop-at") dropAt = std::atoi(value.c_str());
+        else if (option == "--timeout") config.peerTimeoutSeconds = static_cast<float>(std::atof(value.c_str())) / 1000.f;
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<LockstepSession>> peers;
+    for (int player = 0; player < config.players; ++player) {
+        LockstepConfig peerConfig = config;
+        peerConfig.localPlayer = player;
+        peers.push_back(std::make_unique<LockstepSession>(peerConfig));
+        if (!peers.back()->start()) {
+            std::cerr << "Cannot bind UDP port " << config.basePort + player << std::endl;
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool running = true;
+    while (running) {
+        running = false;
+        bool progressed = false;
+        for (int player = 0; player < config.players; ++player) {
+            LockstepSession& peer = *peers[player];
+            if (player == config.players - 1 && dropAt >= 0 && static_cast<int>(peer.getTick()) >= dropAt) continue;
+            peer.poll();
+            if (static_cast<int>(peer.getTick()) >= ticks) continue;
+            running = true;
+            peer.setInput(peer.getArena().botDirection(player));
+            if (peer.advance()) {
+                progressed = true;
+                // Проверка детектора: узел 1 локально портит своё состояние
+                if (player == 1 && static_cast<int>(peer.getTick()) == desyncAt) peer.mutableArena().spawnSnake(1);
+            }
+        }
+        if (std::chrono::steady_clock::now() - start > std::chrono::seconds(60)) {
+            std::cerr << "Timed out" << std::endl;
+            return 1;
+        }
+        if (!progressed) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Players: " << config.players << ", ticks: " << ticks << ", input delay: " << config.inputDelay
+        << ", redundancy: " << config.redundancy << ", loss: " << config.loss
+        << ", latency: " << config.latencySeconds * 1000.f << "+" << config.jitterSeconds * 1000.f << " ms\n"
+        << std::setw(8) << "player" << std::setw(20) << "final hash" << std::setw(10) << "stalls"
+        << std::setw(10) << "sent" << std::setw(10) << "dropped" << std::setw(10) << "resends" << std::setw(12) << "desync" << "\n";
+    uint64_t reference = peers[0]->getArena().stateHash();
+    bool identical = true;
+    bool detected = false;
+    // Замолкший узел в сверке не участвует, но все остальные должны его исключить
+    int survivors = dropAt >= 0 ? config.players - 1 : config.players;
+    bool allDropped = true;
+    for (int player = 0; player < survivors; ++player) allDropped = allDropped && peers[player]->isDropped(config.players - 1);
+    for (int player = 0; player < survivors; ++player) {
+        const LockstepSession& peer = *peers[player];
+        uint64_t hash = peer.getArena().stateHash();
+        identical = identical && hash == reference;
+        detected = detected || peer.isDesynced();
+        std::cout << std::setw(8) << player << std::setw(20) << std::hex << hash << std::dec
+            << std::setw(10) << peer.getStats().stalls << std::setw(10) << peer.packetsSent()
+            << std::setw(10) << peer.packetsDropped() << std::setw(10) << peer.getStats().resends
+            << std::setw(12) << (peer.isDesynced() ? "tick " + std::to_string(peer.getDesyncTick()) : "-") << "\n";
+    }
+    std::cout << "Ticks/sec per peer: " << std::fixed << std::setprecision(0) << ticks / seconds << "\n"
+        << (identical && !detected ? "All peers in sync\n" : "DESYNC detected\n");
+    if (dropAt >= 0) std::cout << (allDropped ? "Silent peer dropped by all survivors\n" : "Silent peer NOT dropped\n");
+    if (desyncAt >= 0) return detected ? 0 : 1;
+    if (dropAt >= 0 && !allDropped) return 1;
+    return identical && !detected ? 0 : 1;
+}
+
+// Сервер и клиент в одном процессе без сети: каждый тик кадр либо доходит,
+// либо теряется (--drop). После потери клиент ждёт ключевой кадр, как на сервере.
+// После каждого принятого кадра реплика сверяется с ареной бит в бит.
+static int runReplicate(int argc, char** argv) {
+    int snakes = 100;
+    int ticks = 5000;
+    int world = 0;
+    int keyframeTicks = 100;
+    double drop = 0.0;
+    uint64_t seed = 7;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--snakes") snakes = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--ticks") ticks = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--world") world = std::min(32767, std::max(0, std::atoi(value.c_str())));
+        else if (option == "--keyframe") keyframeTicks = std::max(0, std::atoi(value.c_str()));
+        else if (option == "--drop") drop = std::atof(value.c_str());
+        else if (option == "--seed") seed = std::strtoull(value.c_str(), nullptr, 10);
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    int side = world > 0 ? world : std::max(40, static_cast<int>(std::sqrt(snakes * 300.0)));
+    Arena arena(side, side, snakes, seed, GameRules(), world > 0 ? 40 : 0);
+    ArenaEncoder encoder(arena);
+    ArenaReplica replica(side, side);
+    Rng loss;
+    loss.seed(seed ^ 0x5EED);
+
+    BitWriter bits;
+    uint64_t deltaBytes = 0, deltaCount = 0, keyframeBytes = 0, keyframeCount = 0, dropped = 0;
+    int mismatchTick = -1;
+    bool needsKeyframe = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < ticks && mismatchTick < 0; ++t) {
+        arena.step();
+        bits.clear();
+        encoder.writeDelta(bits);
+        size_t deltaSize = bits.finish().size();
+
+        bool keyframe = needsKeyframe || (keyframeTicks > 0 && arena.getTick() % keyframeTicks == 0);
+        if (keyframe) {
+            bits.clear();
+            encoder.writeKeyframe(bits);
+        }
+        const std::vector<uint8_t>& frame = bits.finish();
+        if (keyframe) { keyframeBytes += frame.size(); ++keyframeCount; }
+        else { deltaBytes += deltaSize; ++deltaCount; }
+
+        if (loss.next() < drop * 4294967296.0) {
+            ++dropped;
+            needsKeyframe = true;
+            continue;
+        }
+        BitReader reader(frame.data(), frame.size());
+        bool applied = keyframe ? replica.readKeyframe(reader) : replica.readDelta(reader);
+        needsKeyframe = !applied;
+        if (!applied || !replica.matches(arena)) mismatchTick = static_cast<int>(arena.getTick());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Прежний MSG_STATE: тип, тик и по змейке alive/x/y/score, без тел и предметов
+    size_t legacyBytes = 5 + static_cast<size_t>(snakes) * 9;
+    std::cout << "Snakes: " << snakes << ", board " << side << "x" << side << ", ticks: " << ticks
+        << ", keyframe every " << keyframeTicks << ", drop: " << drop << "\n"
+        << std::fixed << std::setprecision(1)
+        << "Delta frames:    " << deltaCount << ", avg " << (deltaCount ? static_cast<double>(deltaBytes) / deltaCount : 0.0) << " bytes\n"
+        << "Keyframes:       " << keyframeCount << ", avg " << (keyframeCount ? static_cast<double>(keyframeBytes) / keyframeCount : 0.0) << " bytes\n"
+        << "Dropped frames:  " << dropped << "\n"
+        << "Bytes/tick:      " << static_cast<double>(deltaBytes + keyframeBytes) / ticks
+        << " (old MSG_STATE " << legacyBytes << " without bodies and items)\n"
+        << "Encode+decode:   " << std::setprecision(2) << seconds / ticks * 1e6 << " us/tick\n";
+    if (mismatchTick >= 0) {
+        std::cout << "MISMATCH at tick " << mismatchTick << "\n";
+        return 1;
+    }
+    std::cout << "Replica matched the arena on every received frame\n";
+    return 0;
+}
+
+// Для каждого размера истории: двоичный файл на N результатов, разбор того же
+// в текстовом виде (для сравнения), первая загрузка со сборкой индекса и
+// обычный старт. Затем добавления по одному, как после конца игры.
+// Места, топы и личные рекорды сверяются с полным перебором.
+// --async 1 - запись через PersistenceWorker, как в игре.
+static int runScoreBoardBench(int argc, char** argv) {
+    std::vector<int> sizes = { 10000, 1000000, 10000000 };
+    int adds = 2000;
+    int users = 50;
+    int textMax = 1000000;
+    std::string path = "scoreboard-bench.bin";
+    bool async = false;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--entries") {
+            sizes.clear();
+            size_t start = 0;
+            while (start < value.size()) {
+                size_t comma = value.find(',', start);
+                if (comma == std::string::npos) comma = value.size();
+                sizes.push_back(std::max(0, std::atoi(value.substr(start, comma - start).c_str())));
+                start = comma + 1;
+            }
+        }
+        else if (option == "--adds") adds = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--users") users = std::min(65535, std::max(1, std::atoi(value.c_str())));
+        else if (option == "--text-max") textMax = std::max(0, std::atoi(value.c_str()));
+        else if (option == "--file") path = value;
+        else if (option == "--async") async = std::atoi(value.c_str()) != 0;
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // Компактная копия истории для перебора
+    struct Sample {
+        int32_t score;
+        uint16_t user;
+        uint8_t difficulty;
+    };
+    auto elapsedMs = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+
+    // Огромный счёт из битой строки не раздувает дерево мест
+    ScoreRankIndex huge;
+    huge.add(2000000000);
+    huge.add(5);
+    bool ok = huge.rankOf(5) == 2 && huge.rankOf(2000000000) == 1 && huge.scoreAt(1) == 5;
+    std::cout << std::setw(10) << "entries" << std::setw(12) << "text ms" << std::setw(14) << "index ms"
+        << std::setw(12) << "start ms" << std::setw(10) << "rank ns" << std::setw(10) << "top ns"
+        << std::setw(10) << "best ns" << std::setw(10) << "add us" << "  check\n";
+    for (int entries : sizes) {
+        Rng rng;
+        rng.seed(11);
+        std::vector<Sample> all;
+        all.reserve(static_cast<size_t>(entries) + adds);
+        auto randomSample = [&]() {
+            Sample sample;
+            sample.user = static_cast<uint16_t>(rng.nextInt(users));
+            sample.difficulty = static_cast<uint8_t>(rng.nextInt(DIFFICULTY_COUNT));
+            sample.score = rng.nextInt(rng.nextInt(4) == 0 ? 300 : 60);
+            return sample;
+        };
+        std::string indexPath = ScoreBoard(path).getIndexPath();
+        std::string textPath = path + ".txt";
+        std::remove(indexPath.c_str());
+        {
+            ScoreFileHeader header = { { 'S', 'N', 'K', 'B' }, 1, sizeof(ScoreRecord), 0 };
+            std::ofstream binary(path, std::ios::binary | std::ios::trunc);
+            std::ofstream text;
+            if (entries <= textMax) text.open(textPath, std::ios::trunc);
+            binary.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            std::vector<ScoreRecord> chunk;
+            for (int i = 0; i < entries; ++i) {
+                all.push_back(randomSample());
+                ScoreRecord record;
+                std::memset(&record, 0, sizeof(record));
+                std::snprintf(record.name, sizeof(record.name), "user%d", all.back().user);
+                record.difficulty = all.back().difficulty;
+                record.score = all.back().score;
+                record.timestamp = 1700000000 + i;
+                chunk.push_back(record);
+                if (text.is_open()) text << record.name << " " << record.score << " " << static_cast<int>(record.difficulty) << " " << record.timestamp << "\n";
+                if (chunk.size() == 65536 || i + 1 == entries) {
+                    binary.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(ScoreRecord));
+                    chunk.clear();
+                }
+            }
+        }
+
+        // Старый путь: разбор текста операторами >>
+        double textMs = -1.0;
+        if (entries <= textMax) {
+            auto start = std::chrono::steady_clock::now();
+            size_t imported = 0;
+            ScoreBoard::importText(textPath, path + ".import", &imported);
+            textMs = elapsedMs(start);
+            ok = ok && imported == static_cast<size_t>(entries);
+            std::remove(textPath.c_str());
+            std::remove((path + ".import").c_str());
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            ScoreBoard first(path);
+            first.load();
+            ok = ok && (first.getIndexedCount() == static_cast<size_t>(entries) || entries <= 50000);
+        }
+        double indexMs = elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        std::unique_ptr<ScoreBoard> opened = std::make_unique<ScoreBoard>(path);
+        ScoreBoard& board = *opened;
+        board.load();
+        double startMs = elapsedMs(start);
+
+        // Перебор: места по видам, топы, личные рекорды на сложном
+        auto brutalRank = [&](int score, int view, size_t count) {
+            size_t better = 0;
+            for (size_t i = 0; i < count; ++i) {
+                better += (view == ALL_DIFFICULTIES || all[i].difficulty == view) && all[i].score > score ? 1 : 0;
+            }
+            return better + 1;
+        };
+        auto check = [&]() {
+            bool good = true;
+            for (int view = ALL_DIFFICULTIES; view < DIFFICULTY_COUNT; ++view) {
+                std::vector<int> scores;
+                for (const Sample& sample : all) {
+                    if (view == ALL_DIFFICULTIES || sample.difficulty == view) scores.push_back(sample.score);
+                }
+                good = good && board.size(view) == scores.size();
+                size_t topSize = std::min<size_t>(10, scores.size());
+                std::partial_sort(scores.begin(), scores.begin() + topSize, scores.end(), std::greater<int>());
+                good = good && board.top(view).size() == topSize;
+                for (size_t k = 0; good && k < topSize; ++k) good = board.top(view)[k].score == scores[k];
+                if (scores.size() > 10) {
+                    size_t k = scores.size() / 3;
+                    std::nth_element(scores.begin(), scores.begin() + k, scores.end(), std::greater<int>());
+                    good = good && board.scoreAt(k, view) == scores[k];
+                }
+                for (int score : { 0, 7, 59, 150, 299 }) good = good && board.rankOf(score, view) == brutalRank(score, view, all.size());
+            }
+            std::vector<int> best(users, -1);
+            for (const Sample& sample : all) {
+                if (sample.difficulty == HARD) best[sample.user] = std::max(best[sample.user], sample.score);
+            }
+            for (int u = 0; u < users; ++u) {
+                ScoreEntry found;
+                bool played = board.personalBest("user" + std::to_string(u), HARD, found);
+                good = good && (played ? found.score : -1) == best[u];
+            }
+            return good;
+        };
+        bool good = check();
+
+        const int queries = 200000;
+        size_t sink = 0;
+        auto timed = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i) sink += board.rankOf(i % 300, i % DIFFICULTY_COUNT);
+        double rankNs = elapsedMs(timed) * 1e6 / queries;
+        timed = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i) sink += board.top(i % DIFFICULTY_COUNT).size();
+        double topNs = elapsedMs(timed) * 1e6 / queries;
+        std::vector<std::string> names;
+        for (int u = 0; u < users; ++u) names.push_back("user" + std::to_string(u));
+        timed = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i) {
+            ScoreEntry found;
+            if (board.personalBest(names[i % users], i % DIFFICULTY_COUNT, found)) sink += static_cast<size_t>(found.score);
+        }
+        double bestNs = elapsedMs(timed) * 1e6 / queries;
+
+        // Добавления после конца игры: ложатся в хвост
+        std::unique_ptr<PersistenceWorker> worker;
+        if (async) {
+            worker = std::make_unique<PersistenceWorker>();
+            board.setWriter(worker.get());
+        }
+        std::vector<size_t> ranks;
+        timed = std::chrono::steady_clock::now();
+        for (int i = 0; i < adds; ++i) {
+            all.push_back(randomSample());
+            const Sample& sample = all.back();
+            ranks.push_back(board.add(names[sample.user], sample.score, sample.difficulty, 1800000000 + i));
+        }
+        double addUs = elapsedMs(timed) * 1e3 / adds;
+        for (int i = 0; i < adds; i += 499) {
+            size_t count = static_cast<size_t>(entries) + i + 1;
+            good = good && ranks[i] == brutalRank(all[count - 1].score, all[count - 1].difficulty, count);
+        }
+        if (worker) worker->flush();
+        good = good && check();
+
+        // Хвост с диска подхватывается при следующем старте
+        board.load();
+        good = good && board.getIndexedCount() + board.getTailCount() == all.size() && check();
+
+        // Падение посреди записи: обрывок отрезается, следующие записи ложатся ровно
+        PersistenceWorker::appendFile(path, std::string(sizeof(ScoreRecord) / 2, '\x7f'));
+        board.load();
+        all.push_back(randomSample());
+        board.add(names[all.back().user], all.back().score, all.back().difficulty, 1900000000);
+        if (worker) worker->flush();
+        board.load();
+        good = good && board.getIndexedCount() + board.getTailCount() == all.size() && check();
+        ok = ok && good;
+
+        std::cout << std::setw(10) << entries << std::fixed << std::setprecision(1)
+            << std::setw(12) << (textMs < 0 ? std::string("-") : std::to_string(static_cast<long long>(textMs)))
+            << std::setw(14) << indexMs << std::setw(12) << std::setprecision(2) << startMs
+            << std::setw(10) << std::setprecision(1) << rankNs << std::setw(10) << topNs << std::setw(10) << bestNs
+            << std::setw(10) << std::setprecision(2) << addUs << "  " << (good ? "ok" : "MISMATCH") << "\n";
+        volatile size_t keep = sink; // чтобы запросы не выбросил оптимизатор
+        (void)keep;
+        opened.reset();
+        std::remove(path.c_str());
+        std::remove(indexPath.c_str());
+    }
+    std::cout << "text: parsing the same history as text; index: first load that builds the sorted index;\n"
+        << "start: later loads (map files, read the tail)\n"
+        << (ok ? "Ranks, tops and personal bests match a full scan\n" : "MISMATCH against a full scan\n");
+    return ok ? 0 : 1;
+}
+
+static int runUserStoreBench(int argc, char** argv) {
+    std::vector<int> sizes = { 10000, 1000000 };
+    int adds = 2000;
+    int textMax = 1000000;
+    std::string path = "userstore-bench.txt";
+    bool async = false;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--users") {
+            sizes.clear();
+            size_t start = 0;
+            while (start < value.size()) {
+                size_t comma = value.find(',', start);
+                if (comma == std::string::npos) comma = value.size();
+                sizes.push_back(std::max(0, std::atoi(value.substr(start, comma - start).c_str())));
+                start = comma + 1;
+            }
+        }
+        else if (option == "--adds") adds = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--text-max") textMax = std::max(0, std::atoi(value.c_str()));
+        else if (option == "--file") path = value;
+        else if (option == "--async") async = std::atoi(value.c_str()) != 0;
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    auto elapsedMs = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+    auto passwordOf = [](int user) { return "pw" + std::to_string(static_cast<long long>(user) * 7919 % 100003); };
+
+    bool ok = true;
+    std::cout << std::setw(10) << "users" << std::setw(12) << "text ms" << std::setw(12) << "rewrite ms"
+        << std::setw(12) << "index ms" << std::setw(12) << "start ms" << std::setw(10) << "hit ns"
+        << std::setw(10) << "miss ns" << std::setw(10) << "add us" << "  check\n";
+    for (int count : sizes) {
+        std::string indexPath = path.substr(0, path.find_last_of('.')) + ".idx";
+        std::remove(indexPath.c_str());
+        {
+            // Как старый users.txt: строка "name password", часть паролей сменена позже
+            std::ofstream journal(path, std::ios::binary | std::ios::trunc);
+            for (int i = 0; i < count; ++i) journal << "user" << i << " " << (i % 10 == 0 ? "old" : passwordOf(i)) << "\n";
+            for (int i = 0; i < count; i += 10) journal << "user" << i << " " << passwordOf(i) << "\n";
+        }
+
+        // Старый путь: весь файл в unordered_map при старте и полная перезапись на регистрацию
+        double textMs = -1.0;
+        double rewriteMs = -1.0;
+        if (count <= textMax) {
+            auto start = std::chrono::steady_clock::now();
+            std::unordered_map<std::string, std::string> users;
+            {
+                std::ifstream file(path);
+                std::string username, password;
+                while (file >> username >> password) users[username] = password;
+            }
+            textMs = elapsedMs(start);
+            ok = ok && users.size() == static_cast<size_t>(count);
+            start = std::chrono::steady_clock::now();
+            std::ostringstream file;
+            for (const auto& user : users) file << user.first << " " << user.second << "\n";
+            PersistenceWorker::commitFile(path + ".rewrite", file.str());
+            rewriteMs = elapsedMs(start);
+            std::remove((path + ".rewrite").c_str());
+        }
+
+        // Первый вход: журнал без индекса, длинный хвост - сжатие и построение индекса
+        auto start = std::chrono::steady_clock::now();
+        {
+            UserStore first(path);
+            first.contains("user0");
+        }
+        double indexMs = elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        std::unique_ptr<UserStore> opened = std::make_unique<UserStore>(path);
+        UserStore& store = *opened;
+        bool good = store.contains("user0");
+        double startMs = elapsedMs(start);
+        good = good && store.size() == static_cast<size_t>(count) &&
+            (store.getIndexedCount() == static_cast<size_t>(count) || count <= 50000);
+
+        auto checkUsers = [&](int total) {
+            bool matches = store.size() == static_cast<size_t>(total);
+            std::string password;
+            for (int i = 0; matches && i < total; i += std::max(1, total / 5000)) {
+                matches = store.find("user" + std::to_string(i), password) && password == passwordOf(i);
+            }
+            matches = matches && store.find("user" + std::to_string(total - 1), password) && password == passwordOf(total - 1);
+            return matches && !store.contains("user" + std::to_string(total)) && !store.contains("user");
+        };
+        good = good && checkUsers(count);
+
+        const int queries = 200000;
+        std::vector<std::string> hits;
+        std::vector<std::string> misses;
+        Rng rng;
+        rng.seed(5);
+        for (int i = 0; i < 4096; ++i) {
+            hits.push_back("user" + std::to_string(rng.nextInt(std::max(1, count))));
+            misses.push_back("guest" + std::to_string(rng.nextInt(1 << 30)));
+        }
+        size_t sink = 0;
+        std::string password;
+        auto timed = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i) sink += store.find(hits[i & 4095], password) ? password.size() : 0;
+        double hitNs = elapsedMs(timed) * 1e6 / queries;
+        timed = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i) sink += store.find(misses[i & 4095], password) ? 1 : 0;
+        double missNs = elapsedMs(timed) * 1e6 / queries;
+
+        // Регистрации дописывают по строке в журнал
+        std::unique_ptr<PersistenceWorker> worker;
+        if (async) {
+            worker = std::make_unique<PersistenceWorker>();
+            store.setWriter(worker.get());
+        }
+        timed = std::chrono::steady_clock::now();
+        for (int i = count; i < count + adds; ++i) good = store.add("user" + std::to_string(i), passwordOf(i)) && good;
+        double addUs = elapsedMs(timed) * 1e3 / adds;
+        good = good && !store.add("user0", "again") && !store.add("with space", "x") && checkUsers(count + adds);
+        if (worker) worker->flush();
+
+        // Новые строки подхватываются хвостом при следующем старте
+        store.load();
+        good = good && store.getIndexedCount() + store.getTailCount() >= static_cast<size_t>(count + adds) && checkUsers(count + adds);
+        ok = ok && good;
+
+        std::cout << std::setw(10) << count << std::fixed << std::setprecision(1)
+            << std::setw(12) << (textMs < 0 ? std::string("-") : std::to_string(static_cast<long long>(textMs)))
+            << std::setw(12) << (rewriteMs < 0 ? std::string("-") : std::to_string(static_cast<long long>(rewriteMs)))
+            << std::setw(12) << indexMs << std::setw(12) << std::setprecision(2) << startMs
+            << std::setw(10) << std::setprecision(1) << hitNs << std::setw(10) << missNs
+            << std::setw(10) << std::setprecision(2) << addUs << "  " << (good ? "ok" : "MISMATCH") << "\n";
+        volatile size_t keep = sink; // чтобы запросы не выбросил оптимизатор
+        (void)keep;
+        opened.reset();
+        std::remove(path.c_str());
+        std::remove(indexPath.c_str());
+    }
+    std::cout << "text: old load of the whole file into a hash map; rewrite: old full rewrite per registration;\n"
+        << "index: first login that compacts the journal and builds the index; start: later first login (map files)\n"
+        << (ok ? "Lookups and registrations match the generated users\n" : "MISMATCH against the generated users\n");
+    return ok ? 0 : 1;
+}
+
+static int runPasswordBench(int argc, char** argv) {
+    std::vector<int> costs = { 10000, 50000, 200000, 600000 };
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    double seconds = 1.0;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--iterations") {
+            costs.clear();
+            size_t start = 0;
+            while (start < value.size()) {
+                size_t comma = value.find(',', start);
+                if (comma == std::string::npos) comma = value.size();
+                costs.push_back(credentials::clampIterations(std::atoi(value.substr(start, comma - start).c_str())));
+                start = comma + 1;
+            }
+        }
+        else if (option == "--threads") threads = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--seconds") seconds = std::max(0.05, std::atof(value.c_str()));
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // Эталоны PBKDF2-HMAC-SHA256 (RFC 7914 и общеизвестные векторы), запись туда и обратно
+    struct Vector {
+        const char* password;
+        const char* salt;
+        int iterations;
+        const char* hash;
+    };
+    const Vector vectors[] = {
+        { "password", "salt", 1, "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b" },
+        { "password", "salt", 2, "ae4d0c95af6b46d32d0adff928f06dd02a303f8ef3c251dfd6e2d85a95474c43" },
+        { "password", "salt", 4096, "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a" },
+        { "passwd", "salt", 1, "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc" }
+    };
+    bool ok = true;
+    for (const Vector& vector : vectors) {
+        uint8_t hash[credentials::HASH_BYTES];
+        credentials::pbkdf2(vector.password, reinterpret_cast<const uint8_t*>(vector.salt), std::strlen(vector.salt), vector.iterations, hash);
+        ok = ok && credentials::toHex(hash, credentials::HASH_BYTES) == vector.hash;
+    }
+    std::string record = credentials::makeRecord("secret", credentials::MIN_ITERATIONS);
+    ok = ok && credentials::verifyRecord(record, "secret") && !credentials::verifyRecord(record, "secreT") &&
+        record != credentials::makeRecord("secret", credentials::MIN_ITERATIONS) &&
+        credentials::verifyRecord("plain", "plain") && !credentials::verifyRecord("plain", "plain2") &&
+        credentials::needsRehash("plain", credentials::MIN_ITERATIONS) && !credentials::needsRehash(record, credentials::MIN_ITERATIONS);
+    std::cout << "PBKDF2-SHA256 test vectors and records: " << (ok ? "ok" : "MISMATCH") << "\n";
+
+    std::cout << std::setw(12) << "iterations" << std::setw(12) << "ms/verify" << std::setw(14) << "verify/s"
+        << std::setw(14) << "verify/s x" << threads << "\n";
+    for (int cost : costs) {
+        std::string stored = credentials::makeRecord("correct horse", cost);
+        auto measure = [&](int workers) {
+            std::atomic<long long> done{ 0 };
+            std::atomic<bool> stop{ false };
+            std::vector<std::thread> pool;
+            auto start = std::chrono::steady_clock::now();
+            for (int t = 0; t < workers; ++t) {
+                pool.emplace_back([&] {
+                    while (!stop) {
+                        credentials::verifyRecord(stored, "correct horse");
+                        ++done;
+                    }
+                });
+            }
+            while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds || done == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            stop = true;
+            for (std::thread& thread : pool) thread.join();
+            return done / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+        double single = measure(1);
+        double parallel = threads > 1 ? measure(threads) : single;
+        std::cout << std::setw(12) << cost << std::fixed << std::setprecision(2) << std::setw(12) << 1000.0 / single
+            << std::setprecision(1) << std::setw(14) << single << std::setw(14) << parallel << "\n";
+    }
+    std::cout << "Login hashes on its own thread, so ms/verify is login latency, not a frame stall.\n"
+        << "verify/s x" << threads << ": guesses per second an offline attacker gets from this CPU.\n";
+    return ok ? 0 : 1;
+}
+
+static int runAudioBench(int argc, char** argv) {
+    int rounds = 5;
+    int dwellMs = 600;
+    int crossfadeMs = 400;
+    double startDelayMs = 50.0;
+    double budgetMs = 1000.0 / 60.0;
+    bool prime = true;
+    int sfxPerSecond = 40;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--rounds") rounds = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--dwell") dwellMs = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--crossfade") crossfadeMs = std::max(0, std::atoi(value.c_str()));
+        else if (option == "--start-delay") startDelayMs = std::max(0.0, std::atof(value.c_str()));
+        else if (option == "--budget") budgetMs = std::atof(value.c_str());
+        else if (option == "--prime") prime = std::atoi(value.c_str()) != 0;
+        else if (option == "--sfx") sfxPerSecond = std::max(0, std::atoi(value.c_str()));
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // Звук без устройства, дорожки и переходы - как в игре
+    RecordingAudio audio(300.0, 120000.0, startDelayMs);
+    SoundManager apple(audio, 70.f);
+    std::vector<int16_t> samples(synth::sampleCount(synth::APPLE));
+    synth::render(synth::APPLE, 1.0f, synth::SAMPLE_RATE, 0, samples.data(), samples.size());
+    apple.setClip(audio.createClip("apple", samples.data(), samples.size(), synth::SAMPLE_RATE));
+    synth::ComboPitch combo;
+    MusicManager music(audio);
+    music.setCrossfade(crossfadeMs);
+    for (int track = 0; track < MUSIC_TRACK_COUNT; ++track) {
+        MusicTrack type = static_cast<MusicTrack>(track);
+        music.install(type, music.openTrack(type));
+    }
+    if (prime) {
+        music.setNext(MUSIC_MENU, { MUSIC_GAME, MUSIC_SETTINGS });
+        music.setNext(MUSIC_GAME, { MUSIC_GAMEOVER });
+        music.setNext(MUSIC_GAMEOVER, { MUSIC_GAME, MUSIC_MENU });
+        music.setNext(MUSIC_SETTINGS, { MUSIC_MENU });
+    }
+
+    // Старт меню из тишины - не переход, в замеры не входит. Дальше по кругу
+    // игра -> конец игры -> игра -> меню -> настройки -> меню; на каждом
+    // экране dwell мс, звук яблока с частотой --sfx в секунду
+    music.play(MUSIC_MENU);
+    std::this_thread::sleep_for(std::chrono::milliseconds(dwellMs));
+    music.resetStats();
+    const MusicTrack route[] = { MUSIC_GAME, MUSIC_GAMEOVER, MUSIC_GAME, MUSIC_MENU, MUSIC_SETTINGS, MUSIC_MENU };
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (MusicTrack type : route) {
+            music.play(type);
+            auto screenStart = std::chrono::steady_clock::now();
+            auto nextSfx = screenStart;
+            while (std::chrono::steady_clock::now() - screenStart < std::chrono::milliseconds(dwellMs)) {
+                if (sfxPerSecond > 0 && std::chrono::steady_clock::now() >= nextSfx) {
+                    apple.play(false, combo.hit());
+                    nextSfx += std::chrono::microseconds(1000000 / sfxPerSecond);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+    music.stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(crossfadeMs + 50));
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(2) << rounds * 6 << " music transitions in " << totalMs << " ms"
+        << " (crossfade " << crossfadeMs << " ms, stream start delay " << startDelayMs << " ms, priming "
+        << (prime ? "on" : "off") << ")\n";
+    music.printReport(std::cout);
+    audio.printReport(std::cout);
+    bool ok = music.getTransitions() == static_cast<size_t>(rounds * 6) && music.getMaxLatencyMs() <= budgetMs;
+    std::cout << (ok ? "Transition latency within " : "Transition latency OVER ") << budgetMs << " ms budget\n";
+    return ok ? 0 : 1;
+}
+
+static int runSfxBench(int argc, char** argv) {
+    int chunk = 256;
+    int repeats = 200;
+    std::string wavDir;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--chunk") chunk = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--repeats") repeats = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--wav") wavDir = value;
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    struct Sound {
+        const char* name;
+        synth::Patch patch;
+    };
+    const Sound sounds[] = { { "click", synth::CLICK }, { "apple", synth::APPLE }, { "bonus", synth::BONUS }, { "antibonus", synth::ANTIBONUS } };
+    // Серия яблок: основной тон и три ступени вверх
+    const float pitches[] = { 1.0f, 1.0594631f, 1.4983071f, 2.0f };
+
+    bool ok = true;
+    std::cout << std::fixed << std::setprecision(2)
+        << "sound       pitch   samples   render us   peak   chunked\n";
+    for (const Sound& sound : sounds) {
+        size_t count = synth::sampleCount(sound.patch);
+        std::vector<int16_t> whole(count);
+        std::vector<int16_t> pieces(count);
+        for (float pitch : pitches) {
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeats; ++r) synth::render(sound.patch, pitch, synth::SAMPLE_RATE, 0, whole.data(), count);
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+            // Кусками, как колбэк SoundStream
+            for (size_t offset = 0; offset < count; offset += chunk) {
+                synth::render(sound.patch, pitch, synth::SAMPLE_RATE, offset, pieces.data() + offset,
+                    std::min(static_cast<size_t>(chunk), count - offset));
+            }
+            bool same = whole == pieces;
+            ok = ok && same && count > 0;
+            int peak = 0;
+            for (int16_t sample : whole) peak = std::max(peak, std::abs(static_cast<int>(sample)));
+            std::cout << std::left << std::setw(12) << sound.name << std::right << std::setw(5) << pitch
+                << std::setw(10) << count << std::setw(12) << us << std::setw(7) << peak * 100 / 32767 << "%"
+                << std::setw(10) << (same ? "same" : "DIFFERS") << "\n";
+        }
+        if (!wavDir.empty()) {
+            // Для прослушивания: PCM WAV, моно 16 бит
+            synth::render(sound.patch, 1.0f, synth::SAMPLE_RATE, 0, whole.data(), count);
+            std::ofstream wav(wavDir + "/" + sound.name + ".wav", std::ios::binary);
+            auto put32 = [&wav](uint32_t value) { wav.write(reinterpret_cast<const char*>(&value), 4); };
+            auto put16 = [&wav](uint16_t value) { wav.write(reinterpret_cast<const char*>(&value), 2); };
+            uint32_t bytes = static_cast<uint32_t>(count * 2);
+            wav.write("RIFF", 4);
+            put32(36 + bytes);
+            wav.write("WAVEfmt ", 8);
+            put32(16);
+            put16(1);
+            put16(1);
+            put32(synth::SAMPLE_RATE);
+            put32(synth::SAMPLE_RATE * 2);
+            put16(2);
+            put16(16);
+            wav.write("data", 4);
+            put32(bytes);
+            wav.write(reinterpret_cast<const char*>(whole.data()), bytes);
+        }
+    }
+    std::cout << (ok ? "Chunked rendering matches whole-buffer rendering\n" : "MISMATCH between chunked and whole rendering\n");
+    return ok ? 0 : 1;
+}
+
+static int runPcmCache(int argc, char** argv) {
+    std::string dir = "pcmcache-test";
+    double seconds = 60.0;
+    double jingle = 3.0;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--dir") dir = value;
+        else if (option == "--seconds") seconds = std::max(1.0, std::atof(value.c_str()));
+        else if (option == "--jingle") jingle = std::max(0.1, std::atof(value.c_str()));
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // Вместо ogg - описание дорожки: длительность и частота тона. "Декодер"
+    // синтезирует стерео 22050 Гц, так что кэш заодно передискретизирует
+    struct Source {
+        double seconds;
+        float hz;
+    };
+    PcmCache::Decoder decode = [](const void* data, size_t size, std::vector<int16_t>& samples,
+        unsigned int& rate, unsigned int& channels) {
+        if (size != sizeof(Source)) return false;
+        Source source;
+        std::memcpy(&source, data, sizeof(source));
+        rate = 22050;
+        channels = 2;
+        synth::Patch tone = { synth::WAVE_SAW, source.hz, source.hz * 2.0f, static_cast<float>(source.seconds * 1000.0),
+            5.0f, 50.0f, 0.5f };
+        std::vector<int16_t> mono(synth::sampleCount(tone, rate));
+        synth::render(tone, 1.0f, rate, 0, mono.data(), mono.size());
+        samples.resize(mono.size() * 2);
+        for (size_t i = 0; i < mono.size(); ++i) samples[i * 2] = samples[i * 2 + 1] = mono[i];
+        return true;
+    };
+
+    std::error_code error;
+    std::filesystem::remove_all(dir, error);
+    Source music = { seconds, 220.0f };
+    Source gameover = { jingle, 330.0f };
+    const std::string MUSIC = "assets/sounds/GameMode.ogg";
+    const std::string GAMEOVER = "assets/sounds/GameOver.ogg";
+
+    bool ok = true;
+    auto check = [&ok](bool condition, const char* what) {
+        if (!condition) {
+            std::cout << "FAILED: " << what << "\n";
+            ok = false;
+        }
+    };
+    auto timed = [&decode](PcmCache& cache, const std::string& name, const Source& source, PcmTrack& track) {
+        auto start = std::chrono::steady_clock::now();
+        bool loaded = cache.get(name, &source, sizeof(source), decode, track);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::left << std::setw(30) << name << std::right << std::setprecision(3) << std::setw(10) << ms << " ms  "
+            << (track.mapping ? "mapped" : track.memory ? "memory" : "-") << "\n";
+        return loaded;
+    };
+    auto same = [](const PcmTrack& a, const PcmTrack& b) {
+        return a.sampleCount == b.sampleCount && a.channels == b.channels &&
+            std::memcmp(a.samples, b.samples, a.sampleCount * sizeof(int16_t)) == 0;
+    };
+
+    std::cout << std::fixed << std::setprecision(3);
+    PcmTrack decodedMusic, decodedJingle;
+    {
+        std::cout << "First run (empty cache):\n";
+        PcmCache cache(dir);
+        check(timed(cache, MUSIC, music, decodedMusic), "decode music");
+        check(timed(cache, GAMEOVER, gameover, decodedJingle), "decode jingle");
+        check(cache.getDecodes() == 2, "both tracks decoded");
+        check(decodedMusic.sampleRate == PcmCache::SAMPLE_RATE && decodedMusic.channels == 2, "resampled to 44100 stereo");
+        check(decodedMusic.mapping != nullptr, "long track mapped from disk");
+        check(decodedJingle.memory != nullptr, "jingle kept in memory");
+        cache.printReport(std::cout);
+    }
+    {
+        std::cout << "Restart:\n";
+        PcmCache cache(dir);
+        PcmTrack track;
+        check(timed(cache, MUSIC, music, track) && same(track, decodedMusic), "music from disk matches decode");
+        check(timed(cache, GAMEOVER, gameover, track) && same(track, decodedJingle), "jingle from disk matches decode");
+        check(timed(cache, GAMEOVER, gameover, track) && same(track, decodedJingle), "jingle from memory matches decode");
+        check(cache.getDecodes() == 0 && cache.getDiskHits() == 2 && cache.getMemoryHits() == 1, "no decodes after restart");
+        // Копию в памяти держат только потоки: отпустили - следующий раз снова с диска
+        track = PcmTrack();
+        check(timed(cache, GAMEOVER, gameover, track) && cache.getDiskHits() == 3, "released jingle is not kept by the cache");
+        cache.printReport(std::cout);
+    }
+    {
+        std::cout << "Source changed:\n";
+        PcmCache cache(dir);
+        PcmTrack track;
+        Source changed = music;
+        changed.hz = 247.0f;
+        check(timed(cache, MUSIC, changed, track), "decode changed music");
+        check(cache.getDecodes() == 1 && !same(track, decodedMusic), "changed source invalidates the cache");
+        check(timed(cache, MUSIC, changed, track) && cache.getDiskHits() == 1, "rebuilt cache is hit");
+        cache.printReport(std::cout);
+    }
+    {
+        std::cout << "Concurrent first load:\n";
+        std::filesystem::remove_all(dir, error);
+        PcmCache cache(dir);
+        const int THREADS = 8;
+        std::vector<PcmTrack> loaded(THREADS);
+        std::vector<char> results(THREADS, 0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < THREADS; ++i) {
+            threads.emplace_back([&, i] { results[i] = cache.get(MUSIC, &music, sizeof(music), decode, loaded[i]); });
+        }
+        for (std::thread& thread : threads) thread.join();
+        bool all = true;
+        for (int i = 0; i < THREADS; ++i) all = all && results[i] && same(loaded[i], decodedMusic);
+        check(all, "every thread gets the decoded track");
+        check(cache.getDecodes() == 1, "one decode for concurrent requests");
+        bool leftovers = false;
+        for (const auto& file : std::filesystem::directory_iterator(dir, error)) {
+            leftovers = leftovers || file.path().extension() == ".tmp";
+        }
+        check(!leftovers, "no temporary files left");
+        cache.printReport(std::cout);
+    }
+    std::filesystem::remove_all(dir, error);
+    std::cout << (ok ? "PCM cache OK\n" : "PCM cache FAILED\n");
+    return ok ? 0 : 1;
+}
+
+static int runPack(int argc, char** argv) {
+    std::string out = "assets.pack";
+    std::string root = ".";
+    uint32_t alignment = 64;
+    std::vector<std::string> names;
+    for (int i = 0; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option.compare(0, 2, "--") != 0) {
+            names.push_back(option);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (option == "--out") out = value;
+        else if (option == "--root") root = value;
+        else if (option == "--align") alignment = static_cast<uint32_t>(std::max(1, std::atoi(value.c_str())));
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // По умолчанию - то, что игра грузит при старте: шрифт и всё под assets/
+    namespace fs = std::filesystem;
+    if (names.empty()) {
+        names.push_back("font1.ttf");
+        std::error_code error;
+        for (fs::recursive_directory_iterator it(fs::path(root) / "assets", error), end; !error && it != end; it.increment(error)) {
+            if (it->is_regular_file()) names.push_back(it->path().lexically_relative(root).generic_string());
+        }
+    }
+    std::vector<std::pair<std::string, std::string>> files;
+    for (const std::string& name : names) files.emplace_back(name, (fs::path(root) / name).string());
+
+    std::string error;
+    if (!AssetPack::build(out, files, alignment, error)) {
+        std::cerr << "Pack failed: " << error << std::endl;
+        return 1;
+    }
+
+    // Проверка: пакет открывается, каждый ресурс байт в байт равен файлу
+    auto elapsedMs = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> loose;
+    for (const auto& file : files) {
+        std::ifstream in(file.second, std::ios::binary);
+        loose.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    double looseMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    AssetPack pack;
+    bool ok = pack.open(out) && pack.size() == files.size();
+    std::vector<std::string> packed;
+    for (const auto& file : files) {
+        std::unique_ptr<AssetStream> stream = ok ? pack.openStream(file.first) : nullptr;
+        std::string data(stream ? static_cast<size_t>(stream->getSize()) : 0, '\0');
+        if (stream) ok = stream->read(&data[0], stream->getSize()) == stream->getSize() && ok;
+        else ok = false;
+        packed.push_back(std::move(data));
+    }
+    double packMs = elapsedMs(start);
+
+    std::cout << std::left << std::setw(48) << "asset" << std::right << std::setw(12) << "bytes" << std::setw(12) << "offset" << "\n";
+    for (uint32_t i = 0; ok && i < pack.size(); ++i) {
+        const AssetPackEntry& entry = pack.entry(i);
+        std::cout << std::left << std::setw(48) << entry.name << std::right << std::setw(12) << entry.size
+            << std::setw(12) << entry.offset << "\n";
+    }
+    for (size_t i = 0; ok && i < files.size(); ++i) ok = packed[i] == loose[i];
+    std::cout << std::fixed << std::setprecision(2) << files.size() << " files -> " << out
+        << "; read loose: " << looseMs << " ms, read from pack: " << packMs << " ms\n"
+        << (ok ? "Pack contents match the source files\n" : "MISMATCH between pack and source files\n");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    if (command == "simulate") return runSimulate(argc - 2, argv + 2);
+    if (command == "vecenv-bench") return runVecEnvBench(argc - 2, argv + 2);
+    if (command == "capi-bench") return runCApiBench(argc - 2, argv + 2);
+    if (command == "arena-bench") return runArenaBench(argc - 2, argv + 2);
+    if (command == "lockstep") return runLockstep(argc - 2, argv + 2);
+    if (command == "replicate") return runReplicate(argc - 2, argv + 2);
+    if (command == "scoreboard-bench") return runScoreBoardBench(argc - 2, argv + 2);
+    if (command == "userstore-bench") return runUserStoreBench(argc - 2, argv + 2);
+    if (command == "password-bench") return runPasswordBench(argc - 2, argv + 2);
+    if (command == "audio-bench") return runAudioBench(argc - 2, argv + 2);
+    if (command == "sfx-bench") return runSfxBench(argc - 2, argv + 2);
+    if (command == "pcm-cache") return runPcmCache(argc - 2, argv + 2);
+    if (command == "pack") return runPack(argc - 2, argv + 2);
+
+    printUsage();
+    return 1;
+}
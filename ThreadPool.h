@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с кражей работы: у каждого потока своя очередь, свои задачи
+// берутся с конца (LIFO, тёплый кэш), чужие - с начала.
+class ThreadPool {
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending{ 0 };
+    std::atomic<unsigned> nextQueue{ 0 };
+    bool stopping = false;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::condition_variable allDone;
+
+    struct WorkerSlot {
+        const ThreadPool* pool = nullptr;
+        int index = -1;
+    };
+
+    static WorkerSlot& currentWorker() {
+        static thread_local WorkerSlot slot;
+        return slot;
+    }
+
+    bool popLocal(unsigned index, std::function<void()>& task) {
+        WorkQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned thief, std::function<void()>& task) {
+        for (size_t i = 1; i < queues.size(); ++i) {
+            WorkQueue& queue = *queues[(thief + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void finishTask() {
+        if (pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            allDone.notify_all();
+        }
+    }
+
+    void workerLoop(unsigned index) {
+        currentWorker() = { this, static_cast<int>(index) };
+        std::function<void()> task;
+        while (true) {
+            if (popLocal(index, task) || steal(index, task)) {
+                task();
+                task = nullptr;
+                finishTask();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            if (stopping) return;
+            if (pending.load() == 0) {
+                wakeUp.wait(lock);
+            }
+            else {
+                // Задачи есть, но уже разобраны другими - коротко подождём
+                wakeUp.wait_for(lock, std::chrono::microseconds(200));
+            }
+        }
+    }
+
+public:
+    explicit ThreadPool(unsigned threadCount = 0) {
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < threadCount; ++i) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (unsigned i = 0; i < threadCount; ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Задача из рабочего потока попадает в его же очередь, извне - по кругу
+    void submit(std::function<void()> task) {
+        const WorkerSlot& self = currentWorker();
+        unsigned index = self.pool == this ? static_cast<unsigned>(self.index)
+            : nextQueue.fetch_add(1) % static_cast<unsigned>(queues.size());
+        pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeUp.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        allDone.wait(lock, [this] { return pending.load() == 0; });
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Хэшированное колесо таймеров: срок попадает в слот (due / resolution) % slots.
+// Планирование - O(1), продвижение - O(пройденных слотов + сработавших таймеров),
+// от общего числа таймеров не зависит. Время - в микросекундах.
+class TimerWheel {
+public:
+    struct Timer {
+        int64_t due;
+        int id;
+    };
+
+private:
+    int64_t resolution;
+    std::vector<std::vector<Timer>> slots;
+    int64_t current;            // абсолютный номер слота, который ещё не пройден до конца
+    size_t pending = 0;
+    std::vector<Timer> fired;
+
+public:
+    TimerWheel(int64_t resolutionMicros = 1000, int slotCount = 256, int64_t start = 0)
+        : resolution(resolutionMicros), slots(slotCount), current(start / resolutionMicros) {
+    }
+
+    void schedule(int id, int64_t due) {
+        int64_t slot = std::max(due / resolution, current);
+        slots[static_cast<size_t>(slot % static_cast<int64_t>(slots.size()))].push_back({ due, id });
+        ++pending;
+    }
+
+    // Вызывает f(id, due) для всех таймеров со сроком <= now. Внутри f можно
+    // планировать новые таймеры - они не сработают в этом же вызове.
+    template <typename F>
+    void advance(int64_t now, F f) {
+        int64_t last = now / resolution;
+        int64_t count = static_cast<int64_t>(slots.size());
+        // После долгой паузы достаточно одного оборота: срабатывает всё, что просрочено
+        if (last - current >= count) current = last - count + 1;
+
+        fired.clear();
+        for (;;) {
+            std::vector<Timer>& slot = slots[static_cast<size_t>(current % count)];
+            size_t kept = 0;
+            for (size_t i = 0; i < slot.size(); ++i) {
+                if (slot[i].due <= now) fired.push_back(slot[i]);
+                else slot[kept++] = slot[i];
+            }
+            slot.resize(kept);
+            if (current == last) break;
+            ++current;
+        }
+        pending -= fired.size();
+        // Раньше срок - раньше вызов, чтобы просроченные матчи не обгоняли друг друга
+        std::sort(fired.begin(), fired.end(), [](const Timer& a, const Timer& b) { return a.due < b.due; });
+        for (size_t i = 0; i < fired.size(); ++i) f(fired[i].id, fired[i].due);
+    }
+
+    // Начало следующего слота: раньше него ничего сработать не может
+    int64_t nextSlotTime() const { return (current + 1) * resolution; }
+
+    size_t size() const { return pending; }
+};
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MappedFile.h"
+#include "PersistenceWorker.h"
+
+// Учётные записи: журнал users.txt, в который только дописывают строку
+// "name password" на запись (позже записанная строка с тем же именем главнее;
+// вместо пароля обычно запись хэша из PasswordHash.h),
+// и хэш-индекс users.idx с открытой адресацией: по имени - смещение строки в
+// журнале. Оба файла отображаются в память при первом обращении, так что
+// поиск и регистрация - O(1) и по процессору, и по диску при любом числе
+// пользователей. Строки после построения индекса ("хвост") держатся в памяти.
+// При загрузке длинный хвост или много перекрытых строк - повод сжать журнал
+// и перестроить индекс.
+//
+// users.idx: UserIndexHeader, затем slotCount ячеек UserIndexSlot
+// (offset + 1, 0 - пусто), число ячеек - степень двойки, линейное пробирование.
+
+struct UserIndexHeader {
+    char magic[4];             // "SNKU"
+    uint32_t version;
+    uint64_t journalBytes;     // сколько байт журнала покрыто индексом
+    uint64_t slotCount;
+    uint64_t users;
+};
+
+struct UserIndexSlot {
+    uint64_t hash;
+    uint64_t offset;           // смещение строки + 1; 0 - свободно
+};
+
+static_assert(sizeof(UserIndexHeader) == 32, "user index header layout is part of the file format");
+static_assert(sizeof(UserIndexSlot) == 16, "user index slot layout is part of the file format");
+
+class UserStore {
+private:
+    static const uint32_t INDEX_VERSION = 1;
+    static const size_t REBUILD_TAIL = 50000; // строк после индекса; больше - перестроить
+
+    std::string path;
+    std::string indexPath;
+    PersistenceWorker* writer = nullptr;
+    bool loaded = false;
+
+    MappedFile journal;
+    MappedFile index;
+    const char* text = nullptr;
+    size_t journalBytes = 0;   // отображённая часть журнала
+    const UserIndexSlot* slots = nullptr;
+    size_t slotMask = 0;
+    size_t indexedBytes = 0;
+    size_t indexedUsers = 0;
+
+    std::unordered_map<std::string, std::string> tail; // имя -> пароль
+    size_t tailNew = 0;        // имён из хвоста, которых нет в индексе
+    size_t superseded = 0;     // строк, перекрытых более поздними
+    bool needsNewline = false; // журнал оборван посреди строки
+
+    static uint64_t hashName(const char* name, size_t length) {
+        uint64_t hash = 1469598103934665603ull; // FNV-1a
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<uint8_t>(name[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Разбор строки журнала с offset (последняя может быть без '\n');
+    // false - в строке нет имени или пароля. next - начало следующей строки
+    static bool parseLine(const char* data, size_t size, size_t offset, size_t& nameLength,
+        size_t& passwordStart, size_t& passwordLength, size_t& next) {
+        const char* end = static_cast<const char*>(std::memchr(data + offset, '\n', size - offset));
+        size_t lineEnd = end ? static_cast<size_t>(end - data) : size;
+        next = end ? lineEnd + 1 : size;
+        if (lineEnd > offset && data[lineEnd - 1] == '\r') --lineEnd;
+        const char* space = static_cast<const char*>(std::memchr(data + offset, ' ', lineEnd - offset));
+        if (!space || space == data + offset) return false;
+        nameLength = static_cast<size_t>(space - (data + offset));
+        passwordStart = nameLength + 1 + offset;
+        while (passwordStart < lineEnd && data[passwordStart] == ' ') ++passwordStart;
+        passwordLength = lineEnd - passwordStart;
+        while (passwordLength > 0 && data[passwordStart + passwordLength - 1] == ' ') --passwordLength;
+        return passwordLength > 0;
+    }
+
+    // Ячейка индекса с этим именем; nullptr - нет
+    const UserIndexSlot* findIndexed(const std::string& name) const {
+        if (!slots) return nullptr;
+        uint64_t hash = hashName(name.data(), name.size());
+        for (size_t i = static_cast<size_t>(hash) & slotMask;; i = (i + 1) & slotMask) {
+            const UserIndexSlot& slot = slots[i];
+            if (slot.offset == 0) return nullptr;
+            if (slot.hash != hash) continue;
+            size_t offset = static_cast<size_t>(slot.offset - 1);
+            if (offset + name.size() < journalBytes && std::memcmp(text + offset, name.data(), name.size()) == 0 &&
+                text[offset + name.size()] == ' ') {
+                return &slot;
+            }
+        }
+    }
+
+    bool openIndex() {
+        slots = nullptr;
+        slotMask = 0;
+        indexedBytes = 0;
+        indexedUsers = 0;
+        if (!index.open(indexPath) || index.size() < sizeof(UserIndexHeader)) {
+            index.close();
+            return false;
+        }
+        const UserIndexHeader* header = reinterpret_cast<const UserIndexHeader*>(index.data());
+        bool valid = std::memcmp(header->magic, "SNKU", 4) == 0 && header->version == INDEX_VERSION &&
+            header->journalBytes <= journalBytes &&
+            (header->journalBytes == 0 || text[header->journalBytes - 1] == '\n') && header->slotCount > 0 &&
+            (header->slotCount & (header->slotCount - 1)) == 0 && header->users < header->slotCount &&
+            index.size() == sizeof(UserIndexHeader) + header->slotCount * sizeof(UserIndexSlot);
+        if (!valid) {
+            index.close();
+            return false;
+        }
+        slots = reinterpret_cast<const UserIndexSlot*>(index.data() + sizeof(UserIndexHeader));
+        slotMask = static_cast<size_t>(header->slotCount - 1);
+        indexedBytes = static_cast<size_t>(header->journalBytes);
+        indexedUsers = static_cast<size_t>(header->users);
+        return true;
+    }
+
+    void load(bool allowCompaction) {
+        loaded = true;
+        index.close();
+        journal.close();
+        text = nullptr;
+        journalBytes = 0;
+        tail.clear();
+        tailNew = 0;
+        superseded = 0;
+
+        if (journal.open(path)) {
+            text = reinterpret_cast<const char*>(journal.data());
+            journalBytes = journal.size();
+        }
+        needsNewline = journalBytes > 0 && text[journalBytes - 1] != '\n';
+        openIndex();
+
+        size_t lines = 0;
+        size_t nameLength, passwordStart, passwordLength, next;
+        for (size_t offset = indexedBytes; offset < journalBytes; offset = next) {
+            if (!parseLine(text, journalBytes, offset, nameLength, passwordStart, passwordLength, next)) continue;
+            std::string name(text + offset, nameLength);
+            bool known = tail.count(name) != 0 || findIndexed(name) != nullptr;
+            if (known) ++superseded;
+            else ++tailNew;
+            tail[name].assign(text + passwordStart, passwordLength);
+            ++lines;
+        }
+        if (allowCompaction && (lines > REBUILD_TAIL || superseded > size() / 2 + 1000)) compact();
+    }
+
+    void append(const std::string& name, const std::string& password) {
+        std::string line = (needsNewline ? "\n" : "") + name + " " + password + "\n";
+        needsNewline = false;
+        if (writer) writer->append(path, line);
+        else PersistenceWorker::appendFile(path, line);
+        tail[name] = password;
+    }
+
+    void ensureLoaded() {
+        if (!loaded) load(true);
+    }
+
+public:
+    explicit UserStore(const std::string& path) : path(path) {
+        size_t dot = path.find_last_of('.');
+        indexPath = (dot == std::string::npos ? path : path.substr(0, dot)) + ".idx";
+    }
+
+    // Имя и пароль - одно слово: строка журнала делится по пробелу
+    static bool isValidField(const std::string& value) {
+        if (value.empty()) return false;
+        for (char c : value) {
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') return false;
+        }
+        return true;
+    }
+
+    // nullptr - писать синхронно
+    void setWriter(PersistenceWorker* worker) { writer = worker; }
+
+    // Файлы отображаются при первом обращении; load() - перечитать явно
+    // (с фоновой записью - после flush())
+    void load() { load(true); }
+
+    bool find(const std::string& name, std::string& password) {
+        ensureLoaded();
+        auto recent = tail.find(name);
+        if (recent != tail.end()) {
+            password = recent->second;
+            return true;
+        }
+        const UserIndexSlot* slot = findIndexed(name);
+        if (!slot) return false;
+        size_t nameLength, passwordStart, passwordLength, next;
+        if (!parseLine(text, journalBytes, static_cast<size_t>(slot->offset - 1), nameLength, passwordStart, passwordLength, next)) return false;
+        password.assign(text + passwordStart, passwordLength);
+        return true;
+    }
+
+    bool contains(const std::string& name) {
+        std::string password;
+        return find(name, password);
+    }
+
+    // false - имя занято или имя/пароль пустые либо с пробелами
+    bool add(const std::string& name, const std::string& password) {
+        if (!isValidField(name) || !isValidField(password) || contains(name)) return false;
+        append(name, password);
+        ++tailNew;
+        return true;
+    }
+
+    // Новая строка для существующего имени перекрывает прежнюю
+    bool update(const std::string& name, const std::string& password) {
+        if (!isValidField(password) || !contains(name)) return false;
+        append(name, password);
+        ++superseded;
+        return true;
+    }
+
+    // Переписывает журнал без перекрытых строк и строит индекс заново.
+    // С фоновой записью - только после flush()
+    bool compact() {
+        ensureLoaded();
+        // Последняя строка каждого имени: сначала индекс, поверх - хвост
+        std::string contents;
+        contents.reserve(journalBytes);
+        size_t nameLength, passwordStart, passwordLength, next;
+        if (slots) {
+            for (size_t i = 0; i <= slotMask; ++i) {
+                if (slots[i].offset == 0) continue;
+                size_t offset = static_cast<size_t>(slots[i].offset - 1);
+                if (!parseLine(text, journalBytes, offset, nameLength, passwordStart, passwordLength, next)) continue;
+                if (tail.count(std::string(text + offset, nameLength))) continue;
+                contents.append(text + offset, nameLength);
+                contents += ' ';
+                contents.append(text + passwordStart, passwordLength);
+                contents += '\n';
+            }
+        }
+        for (const auto& user : tail) contents += user.first + " " + user.second + "\n";
+
+        // Индекс по новому журналу: степень двойки не меньше 2n, заполнение <= 1/2
+        size_t users = 0;
+        for (size_t offset = 0; offset < contents.size(); offset = next) {
+            if (parseLine(contents.data(), contents.size(), offset, nameLength, passwordStart, passwordLength, next)) ++users;
+        }
+        size_t slotCount = 16;
+        while (slotCount < users * 2) slotCount *= 2;
+        UserIndexHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "SNKU", 4);
+        header.version = INDEX_VERSION;
+        header.journalBytes = contents.size();
+        header.slotCount = slotCount;
+        header.users = users;
+        std::vector<UserIndexSlot> table(slotCount, UserIndexSlot{ 0, 0 });
+        for (size_t offset = 0; offset < contents.size(); offset = next) {
+            if (!parseLine(contents.data(), contents.size(), offset, nameLength, passwordStart, passwordLength, next)) continue;
+            uint64_t hash = hashName(contents.data() + offset, nameLength);
+            size_t i = static_cast<size_t>(hash) & (slotCount - 1);
+            while (table[i].offset != 0) i = (i + 1) & (slotCount - 1);
+            table[i] = UserIndexSlot{ hash, offset + 1 };
+        }
+        std::string indexContents(reinterpret_cast<const char*>(&header), sizeof(header));
+        indexContents.append(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(UserIndexSlot));
+
+        // Отображения держат файлы - на Windows их нельзя подменить
+        index.close();
+        journal.close();
+        text = nullptr;
+        slots = nullptr;
+        // Старый индекс не должен пережить замену журнала: при падении между
+        // двумя записями без индекса весь журнал просто читается как хвост
+        std::remove(indexPath.c_str());
+        bool ok = PersistenceWorker::commitFile(path, contents) && PersistenceWorker::commitFile(indexPath, indexContents);
+        load(false);
+        return ok;
+    }
+
+    size_t size() const { return indexedUsers + tailNew; }
+    size_t getIndexedCount() const { return indexedUsers; }
+    size_t getTailCount() const { return tail.size(); }
+    size_t getSuperseded() const { return superseded; }
+    bool isLoaded() const { return loaded; }
+};
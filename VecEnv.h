@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "SnakeCore.h"
+#include "ThreadPool.h"
+
+// Векторизованное окружение для обучения: N досок шагают синхронно,
+// закончившиеся эпизоды сразу перезапускаются. Наблюдения пишутся прямо в
+// буфер вызывающей стороны ([N][3][rows][cols], uint8), без выделений памяти на шаге.
+class VecEnv {
+public:
+    static const int8_t ACTION_KEEP = -1; // не менять направление
+    static const int PLANES = SnakeBoards::OBSERVATION_PLANES;
+
+private:
+    SnakeBoards boards;
+    std::vector<int32_t> lastScore;
+
+public:
+    VecEnv(int count, int cols, int rows, uint64_t seed = 1,
+        Difficulty difficulty = NORMAL, const GameRules& rules = GameRules())
+        : boards(count, cols, rows, seed, rules), lastScore(count, 0) {
+        boards.setDifficulty(difficulty);
+    }
+
+    int size() const { return boards.getCount(); }
+    int getCols() const { return boards.getCols(); }
+    int getRows() const { return boards.getRows(); }
+    size_t observationSize() const { return static_cast<size_t>(PLANES) * boards.getCells(); }
+
+    // Буфер размером size() * observationSize() принадлежит вызывающей стороне
+    // и должен жить, пока не будет отвязан bindObservations(nullptr).
+    void bindObservations(uint8_t* buffer) { boards.bindObservations(buffer); }
+
+    void observe(int env, uint8_t* out) const { boards.writeObservation(env, out); }
+
+    void reset(int env) {
+        boards.reset(env);
+        lastScore[env] = 0;
+    }
+
+    void reset() {
+        for (int env = 0; env < size(); ++env) reset(env);
+    }
+
+    void reseed(int env, uint64_t seed) { boards.reseed(env, seed); }
+
+    static bool validAction(int action) { return action >= ACTION_KEEP && action <= RIGHT; }
+
+    // Шаг одной доски. action: 0..3 - Direction, ACTION_KEEP и любое другое - без поворота.
+    // reward - изменение счёта (-1 при смерти), done - 1 если эпизод закончился
+    // и доска уже перезапущена; finalScore (может быть nullptr) - счёт завершённого эпизода.
+    void stepOne(int env, int8_t action, float& reward, uint8_t& done, int32_t* finalScore = nullptr) {
+        if (action != ACTION_KEEP && validAction(action)) boards.changeDirection(env, static_cast<Direction>(action));
+        if (boards.move(env) == STEP_DIED) {
+            reward = -1.f;
+            done = 1;
+            if (finalScore) *finalScore = boards.getScore(env);
+            reset(env);
+        }
+        else {
+            int score = boards.getScore(env);
+            reward = static_cast<float>(score - lastScore[env]);
+            lastScore[env] = score;
+            done = 0;
+        }
+    }
+
+    // Шаг досок [first, last); массивы индексируются номером доски
+    void stepRange(int first, int last, const int8_t* actions, float* rewards,
+        uint8_t* dones, int32_t* finalScores = nullptr) {
+        for (int env = first; env < last; ++env) {
+            stepOne(env, actions[env], rewards[env], dones[env], finalScores ? &finalScores[env] : nullptr);
+        }
+    }
+
+    void step(const int8_t* actions, float* rewards, uint8_t* dones, int32_t* finalScores = nullptr) {
+        stepRange(0, size(), actions, rewards, dones, finalScores);
+    }
+
+    // То же, но доски делятся на куски между потоками пула
+    void step(ThreadPool& pool, const int8_t* actions, float* rewards, uint8_t* dones,
+        int32_t* finalScores = nullptr, int chunk = 1024) {
+        for (int first = 0; first < size(); first += chunk) {
+            int last = std::min(size(), first + chunk);
+            pool.submit([this, first, last, actions, rewards, dones, finalScores] {
+                stepRange(first, last, actions, rewards, dones, finalScores);
+            });
+        }
+        pool.wait();
+    }
+
+    const SnakeBoards& getBoards() const { return boards; }
+};